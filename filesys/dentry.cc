@@ -0,0 +1,204 @@
+// dentry.cc
+//	Routines to manage the directory entry ("dentry") cache.
+//
+//	An entry is found through a hash table, chained through the
+//	entries themselves, with one bucket per entry.  The entries are
+//	also on a list in order of use, as in the disk's buffer cache
+//	(see synchdisk.cc), so that the one to reuse is at the end.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "utility.h"
+#include "debug.h"
+#include "dentry.h"
+
+//----------------------------------------------------------------------
+// DentryCache::DentryCache
+// 	Initialize an empty dentry cache.
+//
+//	"size" -- how many path names it remembers
+//----------------------------------------------------------------------
+
+DentryCache::DentryCache(int size)
+{
+    ASSERT(size > 0);
+    numEntries = size;
+    entries = new Dentry[numEntries];
+    buckets = new Dentry *[numEntries];
+    for (int i = 0; i < numEntries; i++) {
+	entries[i].sector = -1;
+	entries[i].next = NULL;
+	entries[i].newer = (i + 1 < numEntries) ? &entries[i + 1] : NULL;
+	entries[i].older = (i > 0) ? &entries[i - 1] : NULL;
+	buckets[i] = NULL;
+    }
+    oldest = &entries[0];
+    newest = &entries[numEntries - 1];
+}
+
+//----------------------------------------------------------------------
+// DentryCache::~DentryCache
+// 	De-allocate the dentry cache.
+//----------------------------------------------------------------------
+
+DentryCache::~DentryCache()
+{
+    delete [] buckets;
+    delete [] entries;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Find
+// 	Look up a path name.  If it is in the cache, set "sector" and
+//	"isDirectory" from its entry, and return TRUE.
+//
+//	"path" -- the path name to look up
+//	"sector" -- set to where the file's header is
+//	"isDirectory" -- set to whether the file is a directory
+//----------------------------------------------------------------------
+
+bool
+DentryCache::Find(char *path, int *sector, bool *isDirectory)
+{
+    Dentry *entry = Lookup(path);
+
+    if (entry == NULL) {
+	return FALSE;
+    }
+    *sector = entry->sector;
+    *isDirectory = entry->isDirectory;
+    MakeNewest(entry);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Insert
+// 	Remember where a path name leads, in place of the least
+//	recently used entry.  Path names that are too long aren't
+//	remembered.
+//
+//	"path" -- the path name
+//	"sector" -- where the file's header is
+//	"isDirectory" -- whether the file is a directory
+//----------------------------------------------------------------------
+
+void
+DentryCache::Insert(char *path, int sector, bool isDirectory)
+{
+    Dentry *entry = Lookup(path);
+    int bucket;
+
+    if (entry == NULL) {
+	if (strlen(path) > PathNameMaxLen) {
+	    return;
+	}
+	entry = oldest;
+	if (entry->sector != -1) {
+	    Unhash(entry);
+	}
+	strcpy(entry->path, path);
+	bucket = HashName(path) % numEntries;
+	entry->next = buckets[bucket];
+	buckets[bucket] = entry;
+    }
+    entry->sector = sector;
+    entry->isDirectory = isDirectory;
+    MakeNewest(entry);
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Remove
+// 	Forget about a path name, if it is in the cache.  Its entry is
+//	the first to be reused.
+//
+//	"path" -- the path name
+//----------------------------------------------------------------------
+
+void
+DentryCache::Remove(char *path)
+{
+    Dentry *entry = Lookup(path);
+
+    if (entry == NULL) {
+	return;
+    }
+    Unhash(entry);
+    entry->sector = -1;
+    if (entry == oldest) {
+	return;
+    }
+    if (entry == newest) {			// take it out...
+	newest = entry->older;
+    } else {
+	entry->newer->older = entry->older;
+    }
+    entry->older->newer = entry->newer;
+    entry->newer = oldest;			// ...and put it at the back
+    entry->older = NULL;
+    oldest->older = entry;
+    oldest = entry;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Lookup
+// 	Return the entry for a path name, or NULL if it isn't in the
+//	cache.
+//----------------------------------------------------------------------
+
+Dentry *
+DentryCache::Lookup(char *path)
+{
+    Dentry *entry;
+
+    for (entry = buckets[HashName(path) % numEntries]; entry != NULL;
+				entry = entry->next) {
+	if (!strcmp(entry->path, path)) {
+	    return entry;
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Unhash
+// 	Take an entry out of its hash chain.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Unhash(Dentry *entry)
+{
+    Dentry **link = &buckets[HashName(entry->path) % numEntries];
+
+    while (*link != entry) {
+	ASSERT(*link != NULL);
+	link = &(*link)->next;
+    }
+    *link = entry->next;
+    entry->next = NULL;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::MakeNewest
+// 	Move an entry to the most recently used end of the list.
+//----------------------------------------------------------------------
+
+void
+DentryCache::MakeNewest(Dentry *entry)
+{
+    if (entry == newest) {
+	return;
+    }
+    entry->newer->older = entry->older;		// take it out...
+    if (entry->older != NULL) {
+	entry->older->newer = entry->newer;
+    } else {
+	oldest = entry->newer;
+    }
+    entry->older = newest;			// ...and put it at the front
+    entry->newer = NULL;
+    newest->newer = entry;
+    newest = entry;
+}
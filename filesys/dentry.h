@@ -0,0 +1,66 @@
+// dentry.h 
+//	Data structures for the directory entry ("dentry") cache, which
+//	remembers where recently used path names lead, so looking them 
+//	up again doesn't need to go through each directory on the way.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef DENTRY_H
+#define DENTRY_H
+
+#include "directory.h"
+
+const int DentryCacheSize = 1024;	// path names to remember
+
+// The following class defines one remembered path name: where the
+// file's header is, and whether it is a directory.
+
+class Dentry {
+  public:
+    int sector;			// the file's header, or -1 if unused
+    bool isDirectory;		// is the file a directory?
+    Dentry *next;		// the next entry in the same hash bucket
+    Dentry *newer;		// the entries used just after and
+    Dentry *older;		// just before this one (LRU order)
+    char path[PathNameMaxLen + 1];	// the path name
+};
+
+// The following class defines the dentry cache.  It holds a fixed 
+// number of entries; when it is full, the least recently used one 
+// makes way for a new one.  Path names are in the form FileSystem 
+// gives them (see FileSystem::Lookup), so that the same file always
+// has the same name.
+//
+// The cache knows nothing about the file system: the file system must
+// Remove a path name when the file goes away.  We assume mutual
+// exclusion is provided by the caller.
+
+class DentryCache {
+  public:
+    DentryCache(int size);		// Initialize an empty cache
+    ~DentryCache();			// De-allocate it
+
+    bool Find(char *path, int *sector, bool *isDirectory);
+					// Where does "path" lead, if we
+					// know?
+    void Insert(char *path, int sector, bool isDirectory);
+					// Remember where "path" leads
+    void Remove(char *path);		// Forget about "path"
+
+  private:
+    int numEntries;			// how many entries there are
+    Dentry *entries;			// the entries themselves
+    Dentry **buckets;			// hash chains, one per entry
+    Dentry *newest;			// the most recently used entry
+    Dentry *oldest;			// the least recently used
+
+    Dentry *Lookup(char *path);		// Find the entry for "path"
+    void Unhash(Dentry *entry);		// Take it out of its hash chain
+    void MakeNewest(Dentry *entry);	// Move it to the newest end
+};
+
+#endif // DENTRY_H
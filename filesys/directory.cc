@@ -7,14 +7,20 @@
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	The table is a hash table with open addressing: a name is
+//	put in the entry its hash value picks, or if that is taken, 
+//	in the next free one after it (wrapping around).  To find a 
+//	name, we look from the same place until we find it, or an 
+//	entry that has never been used.  So that this stays quick, 
+//	the table is kept at most three quarters full, counting the
+//	entries of removed files.  When it would get fuller, it is 
+//	rebuilt without them, and only made twice as big if the files 
+//	still in it would fill it.
+//
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -24,6 +30,24 @@
 #include "filehdr.h"
 #include "directory.h"
 
+//----------------------------------------------------------------------
+// HashName
+// 	Return a hash value for a file name, to pick where in the 
+//	table to start looking for it.  (The dentry cache uses it for 
+//	whole path names.)
+//----------------------------------------------------------------------
+
+unsigned int
+HashName(char *name)
+{
+    unsigned int hash = 5381;
+
+    for (; *name != '\0'; name++) {
+	hash = hash * 33 + (unsigned char) *name;
+    }
+    return hash;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
@@ -36,10 +60,13 @@
 
 Directory::Directory(int size)
 {
+    ASSERT(size > 0);
     table = new DirectoryEntry[size];
     tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    bzero(table, tableSize * sizeof(DirectoryEntry));
+    numUsed = 0;				// (all not inUse)
+    changed = new ::List<int>;	// (not our List method)
+    writeAll = TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -49,12 +76,17 @@ Directory::Directory(int size)
 
 Directory::~Directory()
 { 
+    while (!changed->IsEmpty()) {
+	(void) changed->RemoveFront();	// not written back after all
+    }
+    delete changed;
     delete [] table;
 } 
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table is as
+//	big as the file.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -62,12 +94,28 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
+    delete [] table;
+    tableSize = file->Length() / sizeof(DirectoryEntry);
+    table = new DirectoryEntry[tableSize];
     (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    numUsed = 0;
+    for (int i = 0; i < tableSize; i++) {
+	if (table[i].inUse || table[i].removed) {
+	    numUsed++;
+	}
+    }
+    while (!changed->IsEmpty()) {
+	(void) changed->RemoveFront();
+    }
+    writeAll = FALSE;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk: just the
+//	entries that have changed, unless the table is new or has been
+//	rebuilt, in which case all of it.  The file must be big enough (see 
+//	FileSize).
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -75,7 +123,32 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    if (writeAll) {
+	ASSERT(file->Length() >= FileSize());
+	(void) file->WriteAt((char *)table, FileSize(), 0);
+	writeAll = FALSE;	// (and nothing is in "changed")
+    }
+    while (!changed->IsEmpty()) {
+	int i = changed->RemoveFront();
+
+	(void) file->WriteAt((char *)&table[i], sizeof(DirectoryEntry), 
+				i * sizeof(DirectoryEntry));
+    }
+}
+
+//----------------------------------------------------------------------
+// Directory::Changed
+// 	Remember that an entry has changed, so WriteBack writes it.
+//
+//	"index" -- which entry
+//----------------------------------------------------------------------
+
+void
+Directory::Changed(int index)
+{
+    if (!writeAll && !changed->IsInList(index)) {
+	changed->Append(index);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -89,9 +162,18 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
+    int i = HashName(name) % tableSize;
+
+    for (int probes = 0; probes < tableSize; probes++) {
+	if (table[i].inUse) {
+	    if (!strcmp(table[i].name, name)) {
+		return i;
+	    }
+	} else if (!table[i].removed) {
+	    break;		// never used, so the name can't be further on
+	}
+	i = (i + 1) % tableSize;
+    }
     return -1;		// name not in directory
 }
 
@@ -114,31 +196,56 @@ Directory::Find(char *name)
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::IsDirectory
+// 	Return TRUE if "name" is in the directory, and is a directory 
+//	itself.
+//
+//	"name" -- the file name to look up
+//----------------------------------------------------------------------
+
+bool
+Directory::IsDirectory(char *name)
+{
+    int i = FindIndex(name);
+
+    return (i != -1) && table[i].isDirectory;
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory, or 
+//	is too long, or if the directory is full, and has to grow first.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDirectory" -- is the file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDirectory)
 { 
-    if (FindIndex(name) != -1)
+    int i;
+
+    if ((strlen(name) > FileNameMaxLen) || (FindIndex(name) != -1) ||
+		IsFull())
 	return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    for (i = HashName(name) % tableSize; table[i].inUse; 
+				i = (i + 1) % tableSize) {
+	;			// there is a free one, since we aren't full
+    }
+    if (!table[i].removed) {
+	numUsed++;
+    }
+    table[i].inUse = TRUE;
+    table[i].removed = FALSE;
+    table[i].isDirectory = isDirectory;
+    table[i].sector = newSector;
+    strncpy(table[i].name, name, FileNameMaxLen + 1); 
+    Changed(i);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -157,12 +264,138 @@ Directory::Remove(char *name)
     if (i == -1)
 	return FALSE; 		// name not in directory
     table[i].inUse = FALSE;
+    table[i].removed = TRUE;
+    Changed(i);
     return TRUE;	
 }
 
+//----------------------------------------------------------------------
+// Directory::IsEmpty
+// 	Return TRUE if there are no files in the directory.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    for (int i = 0; i < tableSize; i++) {
+	if (table[i].inUse) {
+	    return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::IsFull
+// 	Return TRUE if adding another file would make the table more 
+//	than three quarters full (counting removed entries, which slow 
+//	searches down as much as ones in use), so it must be rebuilt 
+//	first: by Compact, or if MustGrow says so, by Grow.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsFull()
+{
+    return (numUsed + 1) * 4 > tableSize * 3;
+}
+
+//----------------------------------------------------------------------
+// Directory::MustGrow
+// 	Return TRUE if the files in the table, not counting removed 
+//	ones, would make it more than three quarters full with another 
+//	file, so that clearing out the removed entries is not enough.
+//----------------------------------------------------------------------
+
+bool
+Directory::MustGrow()
+{
+    int numFiles = 0;
+
+    for (int i = 0; i < tableSize; i++) {
+	if (table[i].inUse) {
+	    numFiles++;
+	}
+    }
+    return (numFiles + 1) * 4 > tableSize * 3;
+}
+
+//----------------------------------------------------------------------
+// Directory::Grow
+// 	Double the size of the table, leaving out the removed entries.
+//	The caller must make the file holding the directory big enough 
+//	for it (see FileSize) before writing it back.
+//----------------------------------------------------------------------
+
+void
+Directory::Grow()
+{
+    Rebuild(2 * tableSize);
+}
+
+//----------------------------------------------------------------------
+// Directory::Compact
+// 	Clear the removed entries out of the table, without changing 
+//	its size, so that the file holding it can stay as it is.
+//----------------------------------------------------------------------
+
+void
+Directory::Compact()
+{
+    Rebuild(tableSize);
+}
+
+//----------------------------------------------------------------------
+// Directory::Rebuild
+// 	Put the files back in a new, empty table, leaving out the 
+//	removed entries, and remember to write all of it back.
+//
+//	"size" -- the number of entries in the new table
+//----------------------------------------------------------------------
+
+void
+Directory::Rebuild(int size)
+{
+    DirectoryEntry *oldTable = table;
+    int oldSize = tableSize;
+
+    tableSize = size;
+    table = new DirectoryEntry[tableSize];
+    bzero(table, tableSize * sizeof(DirectoryEntry));
+    numUsed = 0;
+    for (int i = 0; i < oldSize; i++) {
+	if (oldTable[i].inUse) {
+	    int j;
+
+	    for (j = HashName(oldTable[i].name) % tableSize; table[j].inUse;
+				j = (j + 1) % tableSize) {
+		;
+	    }
+	    table[j] = oldTable[i];
+	    numUsed++;
+	}
+    }
+    delete [] oldTable;
+    while (!changed->IsEmpty()) {
+	(void) changed->RemoveFront();	// it will all be written
+    }
+    writeAll = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::FileSize
+// 	Return the number of bytes it takes to store the table.
+//----------------------------------------------------------------------
+
+int
+Directory::FileSize()
+{
+    return tableSize * sizeof(DirectoryEntry);
+}
+
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory; directories have a "/"
+//	after their names.
 //----------------------------------------------------------------------
 
 void
@@ -170,7 +403,8 @@ Directory::List()
 {
    for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+	    printf("%s%s\n", table[i].name, 
+			table[i].isDirectory ? "/" : "");
 }
 
 //----------------------------------------------------------------------
@@ -187,7 +421,8 @@ Directory::Print()
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+	    printf("Name: %s%s, Sector: %d\n", table[i].name, 
+			table[i].isDirectory ? "/" : "", table[i].sector);
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
 	}
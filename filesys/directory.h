@@ -4,7 +4,11 @@
 //      A directory is a table of pairs: <file name, sector #>,
 //	giving the name of each file in the directory, and 
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry can
+//	also name another directory, so directories form a tree.
+//
+//	The table is a hash table, so a name is found without looking
+//	at every entry, and it grows when it gets full.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
@@ -18,20 +22,32 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "list.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		23	// for simplicity, we assume
+					// file names are <= 23 characters
+					// long, so an entry is 32 bytes, and
+					// never straddles two sectors
+#define PathNameMaxLen		127	// and that a whole path name, with
+					// the directories it goes through, 
+					// is <= 127 characters long
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
 // the file's header is to be found on disk.
 //
+// An entry whose file has been removed is marked "removed" rather than
+// just not in use, so that a search for a name that hashed to the same
+// place, and was put in a later entry, knows to keep looking.
+//
 // Internal data structures kept public so that Directory operations can
 // access them directly.
 
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
+    bool removed;			// Was it in use, once?
+    bool isDirectory;			// Is the file a directory?
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
@@ -42,11 +58,15 @@ class DirectoryEntry {
 // the directory describes a file, and where to find it on disk.
 //
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file, whose
+// length is the size of the table.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  WriteBack writes only the entries that have changed,
+// unless the table is new or has been rebuilt.  The table grows only
+// when the caller asks (see IsFull and MustGrow), since the caller has
+// to make the file bigger too.
 
 class Directory {
   public:
@@ -60,11 +80,21 @@ class Directory {
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
+    bool IsDirectory(char *name);	// Is "name" a directory?
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
-
+    bool Add(char *name, int newSector, bool isDirectory);
+					// Add a file name into the directory
     bool Remove(char *name);		// Remove a file from the directory
 
+    bool IsEmpty();			// Are there no files in it?
+    bool IsFull();			// Must it be rebuilt before an Add?
+    bool MustGrow();			// Must it be bigger, or is clearing
+					// out the removed entries enough?
+    void Grow();			// Double the size of the table
+    void Compact();			// Rebuild it at the same size, without
+					// the removed entries
+    int FileSize();			// How big a file the table needs
+
     void List();			// Print the names of all the files
 					//  in the directory
     void Print();			// Verbose print of the contents
@@ -75,9 +105,19 @@ class Directory {
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
+    int numUsed;			// Entries in use, or removed
+    ::List<int> *changed;		// Entries to write back
+    bool writeAll;			// Is the table new, or has it been
+					// rebuilt, since it was last written
+					// back?
 
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
+    void Changed(int index);		// Remember to write an entry back
+    void Rebuild(int size);		// Put the files in a new table
 };
 
+extern unsigned int HashName(char *name);
+					// Hash a file or path name
+
 #endif // DIRECTORY_H
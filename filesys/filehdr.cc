@@ -3,12 +3,13 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a list of
+//	extents -- each one a run of consecutive sectors holding 
+//	the next part of the file data.  The first few extents are
+//	in the file header's own sector; the rest, if there are any,
+//	are in a chain of indirect sectors.  Since the free map hands
+//	out runs of sectors, most files need only a few extents, and a 
+//	sector is found by a binary search of them.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -29,37 +30,226 @@
 #include "synchdisk.h"
 #include "main.h"
 
+// How a file header, and each of its indirect sectors, is laid out 
+// on disk: a few ints at the start of the sector, then the extents,
+// filling the rest of it, so how many there are depends on the sector
+// size (see NumHeaderExtents and NumIndirectExtents).  These say which
+// int is which; "next sector" is the next indirect sector, or -1.
+
+enum { HdrNumBytes, HdrNumSectors, HdrNumExtents, HdrNextSector,
+	HeaderInts };			// a file header's own sector
+enum { IndNextSector, IndirectInts };	// an indirect sector
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header, to be filled in by Allocate
+//	or FetchFrom.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    ASSERT(NumHeaderExtents >= 1);	// the sector size is big enough
+    extents = NULL;
+    extentFirst = NULL;
+    indirectSectors = NULL;
+    Clear();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::~FileHeader
+// 	De-allocate the in-memory copy of a file header.
+//----------------------------------------------------------------------
+
+FileHeader::~FileHeader()
+{
+    Clear();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Clear
+// 	Make the file header empty again, de-allocating its tables.
+//----------------------------------------------------------------------
+
+void
+FileHeader::Clear()
+{
+    delete [] extents;
+    delete [] extentFirst;
+    delete [] indirectSectors;
+    extents = NULL;
+    extentFirst = NULL;
+    indirectSectors = NULL;
+    numBytes = numSectors = numExtents = numIndirect = 0;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
-//	Return FALSE if there are not enough free blocks to accomodate
-//	the new file.
+//	Allocate data blocks for the file out of the map of free disk 
+//	blocks, and as many indirect sectors as it takes to list them
+//	(see AddSectors).  Return FALSE if there are not enough free 
+//	blocks to accomodate the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the size of the file, in bytes
+//	"hint" is where to look for the data blocks: usually just after 
+//		the file header's own sector
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
+FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize, int hint)
 { 
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    Clear();
+    return AddSectors(freeMap, fileSize, hint);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Make a file bigger, allocating data blocks for the new part just
+//	after the old part if there is room.  The new part's contents are
+//	whatever was on the disk; the caller must write the header back.
+//	Return FALSE, and leave the file as it was, if there are not 
+//	enough free blocks.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the new size of the file, in bytes
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(PersistentBitmap *freeMap, int newSize)
+{
+    int hint = 0;
+
+    ASSERT(newSize >= numBytes);
+    if (numExtents > 0) {
+	hint = extents[numExtents - 1].start + extents[numExtents - 1].length;
+    }
+    return AddSectors(freeMap, newSize, hint);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::AddSectors
+// 	Allocate data blocks for a file to grow to "newSize" bytes -- in
+//	one run, if there is one long enough, or else in the gaps after 
+//	"hint", in order (see AllocateRun) -- and then any more indirect
+//	sectors it takes to list the runs.  Return FALSE, without 
+//	changing anything, if there are not enough free blocks for the 
+//	most indirect sectors it could take.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the size of the file, in bytes
+//	"hint" is where to look for the first run
+//----------------------------------------------------------------------
+
+bool
+FileHeader::AddSectors(PersistentBitmap *freeMap, int newSize, int hint)
+{
+    int wanted = divRoundUp(newSize, SectorSize) - numSectors;
+    int mostIndirect = divRoundUp(max(numExtents + wanted - NumHeaderExtents,
+					0), NumIndirectExtents);
+    Extent *oldExtents = extents;
+    int *oldIndirect = indirectSectors;
+    int oldNumIndirect = numIndirect;
+    int start, length;
+
+    if (freeMap->NumClear() < wanted + mostIndirect - numIndirect)
 	return FALSE;		// not enough space
+    numBytes = newSize;
 
-    for (int i = 0; i < numSectors; i++) {
-	dataSectors[i] = freeMap->FindAndSet();
+    extents = new Extent[numExtents + wanted];	// more than enough, since
+						// no extent is empty
+    if (numExtents > 0) {
+	bcopy(oldExtents, extents, numExtents * sizeof(Extent));
+    }
+    delete [] oldExtents;
+    if (wanted > 0) {
+	start = freeMap->FindAndSetRun(wanted, hint);
+	if (start != -1) {
+	    AddExtent(start, wanted);
+	    hint = start + wanted;
+	    wanted = 0;
+	}
+    }
+    while (wanted > 0) {
+	length = freeMap->AllocateRun(wanted, hint, &start);
 	// since we checked that there was enough free space,
 	// we expect this to succeed
-	ASSERT(dataSectors[i] >= 0);
+	ASSERT(length > 0);
+	AddExtent(start, length);
+	hint = start + length;
+	wanted -= length;
+    }
+    Index();
+
+    indirectSectors = new int[numIndirect];
+    if (oldNumIndirect > 0) {
+	bcopy(oldIndirect, indirectSectors, oldNumIndirect * sizeof(int));
+    }
+    delete [] oldIndirect;
+    for (int i = oldNumIndirect; i < numIndirect; i++) {
+	indirectSectors[i] = freeMap->FindAndSetRun(1, hint);
+	ASSERT(indirectSectors[i] >= 0);
+	hint = indirectSectors[i] + 1;
     }
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::AddExtent
+// 	Add a run of sectors to the end of the file, merging it with the
+//	last extent if it carries straight on from it.  There must be room
+//	in "extents".
+//
+//	"start" -- the first sector of the run
+//	"length" -- the number of sectors in it
+//----------------------------------------------------------------------
+
+void
+FileHeader::AddExtent(int start, int length)
+{
+    if ((numExtents > 0) && 
+	    (extents[numExtents - 1].start + extents[numExtents - 1].length 
+		== start)) {
+	extents[numExtents - 1].length += length;
+    } else {
+	extents[numExtents].start = start;
+	extents[numExtents].length = length;
+	numExtents++;
+    }
+    numSectors += length;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Index
+// 	Work out where in the file each extent starts, for ByteToSector,
+//	and how many indirect sectors it takes to hold the extents that 
+//	don't fit in the header.
+//----------------------------------------------------------------------
+
+void
+FileHeader::Index()
+{
+    int first = 0;
+
+    delete [] extentFirst;
+    extentFirst = new int[numExtents];
+    for (int i = 0; i < numExtents; i++) {
+	extentFirst[i] = first;
+	first += extents[i].length;
+    }
+    ASSERT(first == numSectors);
+    if (numExtents > NumHeaderExtents) {
+	numIndirect = divRoundUp(numExtents - NumHeaderExtents, 
+					NumIndirectExtents);
+    } else {
+	numIndirect = 0;
+    }
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for its indirect sectors.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -67,15 +257,24 @@ FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(PersistentBitmap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    for (int i = 0; i < numExtents; i++) {
+	for (int j = 0; j < extents[i].length; j++) {
+	    int sector = extents[i].start + j;
+
+	    ASSERT(freeMap->Test(sector));  // ought to be marked!
+	    freeMap->Clear(sector);
+	}
+    }
+    for (int i = 0; (indirectSectors != NULL) && (i < numIndirect); i++) {
+	ASSERT(freeMap->Test(indirectSectors[i]));
+	freeMap->Clear(indirectSectors[i]);
     }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk, following the chain
+//	of indirect sectors to find all of the extents.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -83,12 +282,41 @@ FileHeader::Deallocate(PersistentBitmap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    kernel->synchDisk->ReadSector(sector, (char *)this);
+    char *buffer = new char[SectorSize];
+    int *ints = (int *) buffer;
+    Extent *headerExtents = (Extent *) &ints[HeaderInts];
+    Extent *indirectExtents = (Extent *) &ints[IndirectInts];
+    int i, n, next;
+
+    Clear();
+    kernel->synchDisk->ReadSector(sector, buffer);
+    numBytes = ints[HdrNumBytes];
+    numSectors = ints[HdrNumSectors];
+    numExtents = ints[HdrNumExtents];
+    extents = new Extent[numExtents];
+    n = min(numExtents, NumHeaderExtents);
+    bcopy(headerExtents, extents, n * sizeof(Extent));
+    next = ints[HdrNextSector];
+
+    numIndirect = divRoundUp(max(numExtents - NumHeaderExtents, 0),
+				NumIndirectExtents);
+    indirectSectors = new int[numIndirect];
+    for (i = n; i < numExtents; i += n) {
+	ASSERT(next >= 0);
+	indirectSectors[(i - NumHeaderExtents) / NumIndirectExtents] = next;
+	kernel->synchDisk->ReadSector(next, buffer);
+	n = min(numExtents - i, NumIndirectExtents);
+	bcopy(indirectExtents, &extents[i], n * sizeof(Extent));
+	next = ints[IndNextSector];
+    }
+    Index();				// now that we have all the extents
+    delete [] buffer;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with its indirect sectors. 
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -96,7 +324,32 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    kernel->synchDisk->WriteSector(sector, (char *)this); 
+    char *buffer = new char[SectorSize];
+    int *ints = (int *) buffer;
+    Extent *headerExtents = (Extent *) &ints[HeaderInts];
+    Extent *indirectExtents = (Extent *) &ints[IndirectInts];
+    int i, n;
+
+    bzero(buffer, SectorSize);
+    ints[HdrNumBytes] = numBytes;
+    ints[HdrNumSectors] = numSectors;
+    ints[HdrNumExtents] = numExtents;
+    ints[HdrNextSector] = (numIndirect > 0) ? indirectSectors[0] : -1;
+    n = min(numExtents, NumHeaderExtents);
+    bcopy(extents, headerExtents, n * sizeof(Extent));
+    kernel->synchDisk->WriteSector(sector, buffer); 
+
+    for (i = 0; i < numIndirect; i++) {
+	int first = NumHeaderExtents + i * NumIndirectExtents;
+
+	bzero(buffer, SectorSize);
+	ints[IndNextSector] = 
+		(i + 1 < numIndirect) ? indirectSectors[i + 1] : -1;
+	n = min(numExtents - first, NumIndirectExtents);
+	bcopy(&extents[first], indirectExtents, n * sizeof(Extent));
+	kernel->synchDisk->WriteSector(indirectSectors[i], buffer);
+    }
+    delete [] buffer;
 }
 
 //----------------------------------------------------------------------
@@ -104,7 +357,8 @@ FileHeader::WriteBack(int sector)
 // 	Return which disk sector is storing a particular byte within the file.
 //      This is essentially a translation from a virtual address (the
 //	offset in the file) to a physical address (the sector where the
-//	data at the offset is stored).
+//	data at the offset is stored).  The extent holding it is found by 
+//	binary search.
 //
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
@@ -112,7 +366,20 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    int sector = offset / SectorSize;
+    int low = 0, high = numExtents - 1;
+
+    ASSERT((sector >= 0) && (sector < numSectors));
+    while (low < high) {		// find the last extent starting
+	int middle = (low + high + 1) / 2;	// at or before "sector"
+
+	if (extentFirst[middle] <= sector) {
+	    low = middle;
+	} else {
+	    high = middle - 1;
+	}
+    }
+    return extents[low].start + (sector - extentFirst[low]);
 }
 
 //----------------------------------------------------------------------
@@ -139,11 +406,12 @@ FileHeader::Print()
     char *data = new char[SectorSize];
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+    for (i = 0; i < numExtents; i++)
+	printf("%d-%d ", extents[i].start, 
+		extents[i].start + extents[i].length - 1);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	kernel->synchDisk->ReadSector(dataSectors[i], data);
+	kernel->synchDisk->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
@@ -17,29 +17,50 @@
 #include "disk.h"
 #include "pbitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+// The following class defines an "extent": a run of consecutive disk 
+// sectors, holding consecutive sectors of a file's data.
+
+class Extent {
+  public:
+    int start;			// the first sector of the run
+    int length;			// how many sectors are in it
+};
+
+#define NumHeaderExtents \
+	((SectorSize - 4 * (int) sizeof(int)) / (int) sizeof(Extent))
+					// extents that fit in the header's 
+					// own sector
+#define NumIndirectExtents \
+	((SectorSize - (int) sizeof(int)) / (int) sizeof(Extent))
+					// extents that fit in each of the 
+					// sectors holding the rest
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a list of extents, in the order of
+// the data in the file.  A file whose data is all in one run of sectors 
+// needs only one extent, however big it is.
 //
-// The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// On disk, the file header is stored in a single sector, which holds 
+// the first NumHeaderExtents extents.  If there are more, they are in 
+// a chain of "indirect" sectors, each holding NumIndirectExtents of 
+// them and the number of the next.  In memory, all of the extents are
+// kept in one array.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// The file header can be initialized by allocating blocks for the file 
+// (if it is a new file), or by reading it from disk.
 
 class FileHeader {
   public:
-    bool Allocate(PersistentBitmap *bitMap, int fileSize);// Initialize a file header, 
+    FileHeader();			// Create an empty file header
+    ~FileHeader();			// De-allocate it
+
+    bool Allocate(PersistentBitmap *bitMap, int fileSize, int hint);
+						// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
+    bool Extend(PersistentBitmap *bitMap, int newSize);
+						// Make the file bigger
     void Deallocate(PersistentBitmap *bitMap);  // De-allocate this file's 
 						//  data blocks
 
@@ -59,8 +80,21 @@ class FileHeader {
   private:
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int numExtents;			// Number of extents
+    Extent *extents;			// The extents, in file order
+    int *extentFirst;			// For each extent, the number of its
+					// first sector within the file
+    int numIndirect;			// Number of indirect sectors
+    int *indirectSectors;		// Where they are on disk
+
+    void Clear();			// Forget all of the above
+    bool AddSectors(PersistentBitmap *bitMap, int newSize, int hint);
+					// Allocate space for the file to grow
+    void AddExtent(int start, int length);
+					// Add a run of sectors to the end
+					// of the file
+    void Index();			// Set up extentFirst and 
+					// numIndirect from extents
 };
 
 #endif // FILEHDR_H
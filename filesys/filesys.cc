@@ -7,19 +7,31 @@
 //		(the size of the file header data structure is arranged
 //		to be precisely the size of 1 disk sector)
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in the directory it is in
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers, 
+//	     starting from the root directory
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them 
-//	on bootup.
+//      Both the bitmap and the directories are represented as normal
+//	files.  The file headers of the bitmap and the root directory are
+//	located in specific sectors (sector 0 and sector 1), so that the
+//	file system can find them on bootup.  So is the file header of 
+//	the journal's log (sector 2), which is a file too, but never
+//	in a directory.
 //
-//	The file system assumes that the bitmap and directory files are
-//	kept "open" continuously while Nachos is running.
+//	The file system assumes that the bitmap file is kept "open"
+//	continuously while Nachos is running.  So is each directory,
+//	once it has been looked in, and where each recently used path
+//	name leads is remembered in a dentry cache (see dentry.h), so 
+//	that opening a file seldom has to search a directory, let alone
+//	read one from disk.  Nor does opening a file that is already 
+//	open read its header: every OpenFile for a file shares one copy.
+//
+//	A path name is resolved from the root; "/"s at the start or end,
+//	or doubled, are ignored.  There is no current directory, and no
+//	"." or "..".
 //
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
@@ -28,16 +40,17 @@
 //	modified part of the directory and/or bitmap, we simply discard
 //	the changed version, without writing it back to disk.
 //
+//	"Written back" means written to the journal (see journal.h), 
+//	which holds the changes until the whole operation is finished, 
+//	and then logs them together.  If Nachos stops in the middle of 
+//	an operation, the next FileSystem finishes it, or else it never 
+//	happened.  Operations are done one at a time, under a lock.
+//
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   only the file system's own data is journaled, not what is in
+//	    the files
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -51,54 +64,153 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "dentry.h"
+#include "journal.h"
+#include "synch.h"
+#include "main.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known 
-// sectors, so that they can be located on boot-up.
+// the root directory, and the journal's log.  These file headers are 
+// placed in well-known sectors, so that they can be located on boot-up.
 #define FreeMapSector 		0
 #define DirectorySector 	1
+#define JournalSector 		2
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and a directory; a directory's file
+// is made bigger when its table has to grow (see GrowDirectory).
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
+#define NumDirEntries 		16
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+#define JournalFileSize 	(JournalSectors * SectorSize)
+
+//----------------------------------------------------------------------
+// DirectoryKey, HeaderKey, SectorHash
+//	Functions for the tables of directories and file headers in 
+//	memory: each is found by the sector of its file header, and 
+//	sector numbers are already spread out well enough.
+//----------------------------------------------------------------------
+
+static int
+DirectoryKey(OpenDirectory *openDir)
+{
+    return openDir->sector;
+}
+
+static int
+HeaderKey(OpenHeader *openHdr)
+{
+    return openHdr->sector;
+}
+
+static unsigned int
+SectorHash(int sector)
+{
+    return (unsigned int) sector;
+}
+
+//----------------------------------------------------------------------
+// CloseDirectory
+//	Forget about a directory that was kept in memory.
+//----------------------------------------------------------------------
+
+static void
+CloseDirectory(OpenDirectory *openDir)
+{
+    delete openDir->directory;
+    delete openDir->file;
+    delete openDir;
+}
+
+//----------------------------------------------------------------------
+// CanonicalPath
+//	Copy a path name into "canon", in the form the file system uses:
+//	the names on the way down from the root, separated by single
+//	"/"s, with none at the start or end.  The root itself is "".
+//	Return FALSE if the path, or a name in it, is too long.
+//
+//	"path" -- the path name as given
+//	"canon" -- where to put it; room for PathNameMaxLen characters
+//		and the trailing '\0'
+//----------------------------------------------------------------------
+
+static bool
+CanonicalPath(char *path, char *canon)
+{
+    int length = 0;
+    int nameLength = 0;
+
+    for (; *path != '\0'; path++) {
+	if (*path == '/') {
+	    nameLength = 0;
+	    continue;
+	}
+	if (nameLength == 0 && length > 0) {	// a name after the first
+	    if (length >= PathNameMaxLen) {
+		return FALSE;
+	    }
+	    canon[length++] = '/';
+	}
+	if (length >= PathNameMaxLen || ++nameLength > FileNameMaxLen) {
+	    return FALSE;
+	}
+	canon[length++] = *path;
+    }
+    canon[length] = '\0';
+    return TRUE;
+}
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 // 	Initialize the file system.  If format = TRUE, the disk has
 //	nothing on it, and we need to initialize the disk to contain
-//	an empty directory, and a bitmap of free sectors (with almost but
-//	not all of the sectors marked as free).  
+//	an empty root directory, and a bitmap of free sectors (with 
+//	almost but not all of the sectors marked as free).  
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we just have to open the file
+//	representing the bitmap; the root directory is read in when
+//	it is first needed.  First, though, the journal finishes any
+//	operations that Nachos was in the middle of last time.
 //
 //	"format" -- should we initialize the disk?
+//	"journal" -- should changes go through the journal?
 //----------------------------------------------------------------------
 
-FileSystem::FileSystem(bool format)
+FileSystem::FileSystem(bool format, bool journal)
 { 
+    FileHeader *logHdr = new FileHeader;
+    int firstLogSector;
+
     //DEBUG(dbgFile, "Initializing the file system.");
+    directories = new HashTable<int, OpenDirectory *>(DirectoryKey,
+							SectorHash);
+    openHeaders = new HashTable<int, OpenHeader *>(HeaderKey, SectorHash);
+    dentries = new DentryCache(DentryCacheSize);
+    lock = new Lock("file system lock");
     if (format) {
         PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
+	OpenDirectory *root;
 
         //DEBUG(dbgFile, "Formatting the file system.");
 
-    // First, allocate space for FileHeaders for the directory and bitmap
-    // (make sure no one else grabs these!)
+    // First, allocate space for FileHeaders for the directory, bitmap
+    // and log (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	freeMap->Mark(JournalSector);
 
     // Second, allocate space for the data blocks containing the contents
-    // of the directory and bitmap files.  There better be enough space!
+    // of the directory and bitmap files, and the log, which must be in 
+    // one piece.  There better be enough space!
 
-	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize, 
+					JournalSector + 1));
+	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize, 
+					JournalSector + 1));
+	ASSERT(logHdr->Allocate(freeMap, JournalFileSize, 
+					JournalSector + 1));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -108,13 +220,14 @@ FileSystem::FileSystem(bool format)
         //DEBUG(dbgFile, "Writing headers back to disk.");
 	mapHdr->WriteBack(FreeMapSector);    
 	dirHdr->WriteBack(DirectorySector);
+	logHdr->WriteBack(JournalSector);
 
     // OK to open the bitmap and directory files now
     // The file system operations assume these two files are left open
     // while Nachos is running.
 
         freeMapFile = new OpenFile(FreeMapSector);
-        directoryFile = new OpenFile(DirectorySector);
+	root = CacheDirectory(DirectorySector, directory);
      
     // Once we have the files "open", we can write the initial version
     // of each file back to disk.  The directory at this point is completely
@@ -124,22 +237,100 @@ FileSystem::FileSystem(bool format)
 
         //DEBUG(dbgFile, "Writing bitmap and directory back to disk.");
 	freeMap->WriteBack(freeMapFile);	 // flush changes to disk
-	directory->WriteBack(directoryFile);
+	directory->WriteBack(root->file);
 
 	if (debug->IsEnabled('f')) {
 	    freeMap->Print();
 	    directory->Print();
         }
         delete freeMap; 
-	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
     } else {
-    // if we are not formatting the disk, just open the files representing
-    // the bitmap and directory; these are left open while Nachos is running
+	logHdr->FetchFrom(JournalSector);
+    }
+
+    // The log's sectors follow one another, so the journal only needs
+    // to know where the first one is.  It starts out empty, or else 
+    // with the operations to finish, which have to be written back 
+    // before anything reads the bitmap or a directory.
+    firstLogSector = logHdr->ByteToSector(0);
+    ASSERT(logHdr->ByteToSector(JournalFileSize - 1) == 
+				firstLogSector + JournalSectors - 1);
+    delete logHdr;
+    this->journal = new Journal(firstLogSector, journal);
+    if (format) {
+	this->journal->Format();
+    } else {
+	this->journal->Recover();
+
+    // if we are not formatting the disk, just open the file representing
+    // the bitmap; it is left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
-        directoryFile = new OpenFile(DirectorySector);
     }
+    kernel->synchDisk->SetJournal(this->journal);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Close the bitmap, and the directories kept in memory.  Every
+//	change has already been written back, and is in the log.  Any
+//	files still open belong to user programs that will never run 
+//	again, so their headers are freed too.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    kernel->synchDisk->SetJournal(NULL);
+    delete journal;
+    delete lock;
+    while (!directories->IsEmpty()) {
+	HashIterator<int, OpenDirectory *> iter(directories);
+
+	CloseDirectory(directories->Remove(iter.Item()->sector));
+    }
+    delete directories;
+    while (!openHeaders->IsEmpty()) {
+	HashIterator<int, OpenHeader *> iter(openHeaders);
+	OpenHeader *openHdr = openHeaders->Remove(iter.Item()->sector);
+
+	delete openHdr->hdr;
+	delete openHdr;
+    }
+    delete openHeaders;
+    delete dentries;
+    delete freeMapFile;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::BeginOp
+// 	Start an operation that changes the file system: wait for any
+//	other operation to finish, then tell the journal, so that what
+//	we write goes to the running transaction.
+//----------------------------------------------------------------------
+
+void
+FileSystem::BeginOp()
+{
+    lock->Acquire();
+    journal->Begin();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::EndOp
+// 	Finish an operation.  Other operations can go ahead as soon as
+//	the journal knows we are done; meanwhile, wait until our changes
+//	are in the log, along with those of any operations that finish
+//	while we wait (see Journal::Commit).
+//----------------------------------------------------------------------
+
+void
+FileSystem::EndOp()
+{
+    int seq = journal->End();
+
+    lock->Release();
+    journal->Commit(seq);
 }
 
 //----------------------------------------------------------------------
@@ -149,9 +340,11 @@ FileSystem::FileSystem(bool format)
 //	to give Create the initial size of the file.
 //
 //	The steps to create a file are:
+//	  Make sure the directory it goes in exists
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
+//	  Make room in the directory, if it is full
 //	  Add the name to the directory
 //	  Store the new file header on disk 
 //	  Flush the changes to the bitmap and the directory back to disk
@@ -159,57 +352,108 @@ FileSystem::FileSystem(bool format)
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		the path name is too long, or has a name too long in it
+//		the directory it goes in doesn't exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
+//	 	no free space for the directory to grow
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
+//	"name" -- path name of file to be created
 //	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Create(char *name, int initialSize)
 {
-    Directory *directory;
-    PersistentBitmap *freeMap;
-    FileHeader *hdr;
-    int sector;
     bool success;
 
     //DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
+    BeginOp();
+    success = Make(name, initialSize, FALSE);
+    EndOp();
+    return success;
+}
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+//----------------------------------------------------------------------
+// FileSystem::Mkdir
+// 	Create an empty directory (similar to UNIX mkdir).  This is
+//	done as Create does it, and fails for the same reasons.
+//
+//	"name" -- path name of directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Mkdir(char *name)
+{
+    bool success;
+
+    //DEBUG(dbgFile, "Creating directory " << name);
+    BeginOp();
+    success = Make(name, DirectoryFileSize, TRUE);
+    EndOp();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Make
+// 	Create a file or a directory, for Create and Mkdir.
+//
+//	"name" -- path name of file to be created
+//	"initialSize" -- size of file to be created
+//	"isDirectory" -- is it to be a directory?
+//----------------------------------------------------------------------
 
-    if (directory->Find(name) != -1)
-      success = FALSE;			// file is already in directory
+bool
+FileSystem::Make(char *name, int initialSize, bool isDirectory)
+{
+    char path[PathNameMaxLen + 1];
+    char *fileName;
+    OpenDirectory *parent;
+    PersistentBitmap *freeMap;
+    FileHeader *hdr;
+    int sector;
+    bool success;
+
+    if (!CanonicalPath(name, path)) {
+	return FALSE;			// name too long
+    }
+    parent = FindParent(path, &fileName);
+    if (parent == NULL) {
+	return FALSE;			// no directory to put it in
+    }
+    if (parent->directory->Find(fileName) != -1) {
+	return FALSE;			// file is already in directory
+    }
+    freeMap = new PersistentBitmap(freeMapFile,NumSectors);
+    // find a sector to hold the file header: just before the data,
+    // if there is room for both together, so they are read together
+    sector = freeMap->FindRun(1 + divRoundUp(initialSize, SectorSize), 0);
+    sector = freeMap->FindAndSetRun(1, max(sector, 0));
+    hdr = new FileHeader;
+    if (sector == -1) 		
+	success = FALSE;		// no free block for file header 
+    else if (!hdr->Allocate(freeMap, initialSize, sector + 1))
+	success = FALSE;		// no space on disk for data
+    else if (parent->directory->IsFull() && 
+				!GrowDirectory(parent, freeMap))
+	success = FALSE;		// no space for directory to grow
     else {	
-        freeMap = new PersistentBitmap(freeMapFile,NumSectors);
-        sector = freeMap->FindAndSet();	// find a sector to hold the file header
-    	if (sector == -1) 		
-            success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = FALSE;	// no space in directory
-	else {
-    	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
-            	success = FALSE;	// no space on disk for data
-	    else {	
-	    	success = TRUE;
-		// everthing worked, flush all changes back to disk
-    	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
-    	    	freeMap->WriteBack(freeMapFile);
-	    }
-            delete hdr;
+	success = parent->directory->Add(fileName, sector, isDirectory);
+	ASSERT(success);
+	// everthing worked, flush all changes back to disk
+	hdr->WriteBack(sector); 		
+	if (isDirectory) {
+	    Directory *directory = new Directory(NumDirEntries);
+
+	    directory->WriteBack(CacheDirectory(sector, directory)->file);
 	}
-        delete freeMap;
+	parent->directory->WriteBack(parent->file);
+	freeMap->WriteBack(freeMapFile);
+	dentries->Insert(path, sector, isDirectory);
     }
-    delete directory;
+    delete hdr;
+    delete freeMap;
     return success;
 }
 
@@ -217,27 +461,66 @@ FileSystem::Create(char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
-//	  Bring the header into memory
+//	  Find the location of the file's header, using the dentry
+//	    cache, or else the directories on the path
+//	  Bring the header into memory, unless the file is open 
+//	    already, in which case share the header that is there
+//
+//	Directories can't be opened, since writing one would break it.
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
-    OpenFile *openFile = NULL;
+    char path[PathNameMaxLen + 1];
+    bool isDirectory;
     int sector;
+    OpenHeader *openHdr;
+    OpenFile *openFile = NULL;
 
     //DEBUG(dbgFile, "Opening file" << name);
-    //cout << directoryFile << endl;
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
-    if (sector >= 0) 		
-	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
-    return openFile;				// return NULL if not found
+    if (!CanonicalPath(name, path)) {
+	return NULL;			// name too long
+    }
+    lock->Acquire();
+    sector = Lookup(path, &isDirectory);
+    if (sector != -1 && !isDirectory) {	// name was found in directory 
+	if (!openHeaders->Find(sector, &openHdr)) {
+	    openHdr = new OpenHeader;
+	    openHdr->sector = sector;
+	    openHdr->refCount = 0;
+	    openHdr->hdr = new FileHeader;
+	    openHdr->hdr->FetchFrom(sector);
+	    openHeaders->Insert(openHdr);
+	}
+	openHdr->refCount++;
+	openFile = new OpenFile(openHdr);
+    }
+    lock->Release();
+    return openFile;			// NULL if not found
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CloseHeader
+// 	Note that an OpenFile sharing a file header has been closed.  If
+//	it was the last one, the header is no longer needed in memory.
+//
+//	"openHdr" -- the shared header
+//----------------------------------------------------------------------
+
+void
+FileSystem::CloseHeader(OpenHeader *openHdr)
+{
+    lock->Acquire();
+    ASSERT(openHdr->refCount > 0);
+    if (--openHdr->refCount == 0) {
+	(void) openHeaders->Remove(openHdr->sector);
+	delete openHdr->hdr;
+	delete openHdr;
+    }
+    lock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -247,27 +530,68 @@ FileSystem::Open(char *name)
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
+//	    Forget where its name leads
+//
+//	A directory can be removed only if it is empty, as in UNIX.
+//	Unlike UNIX, a file can't be removed while it is open, since
+//	its sectors would be freed while they were still being used.
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, is open, or is a directory with files in it.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path name of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name)
+{
+    bool success;
+
+    BeginOp();
+    success = Unlink(name);
+    EndOp();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Unlink
+// 	Delete a file or a directory, for Remove.  The sectors freed may
+//	have old contents in the journal's log, which mustn't be copied
+//	back over whatever they are used for next, so the journal is 
+//	told about them.
+//
+//	"name" -- the path name of the file to be removed
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Unlink(char *name)
 { 
-    Directory *directory;
+    char path[PathNameMaxLen + 1];
+    char *fileName;
+    OpenDirectory *parent;
     PersistentBitmap *freeMap;
     FileHeader *fileHdr;
     int sector;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
+    if (!CanonicalPath(name, path)) {
+	return FALSE;			// name too long
+    }
+    parent = FindParent(path, &fileName);
+    if (parent == NULL) {
+	return FALSE;			// directory not found
+    }
+    sector = parent->directory->Find(fileName);
     if (sector == -1) {
-       delete directory;
-       return FALSE;			 // file not found 
+	return FALSE;			// file not found 
+    }
+    if (openHeaders->IsInTable(sector)) {
+	return FALSE;			// file is open
+    }
+    if (parent->directory->IsDirectory(fileName)) {
+	if (!GetDirectory(sector)->directory->IsEmpty()) {
+	    return FALSE;		// directory not empty
+	}
+	CloseDirectory(directories->Remove(sector));
     }
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
@@ -276,36 +600,202 @@ FileSystem::Remove(char *name)
 
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
+    journal->Revoke(freeMap);
+    parent->directory->Remove(fileName);
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
+    parent->directory->WriteBack(parent->file);	// flush to disk
+    dentries->Remove(path);
     delete fileHdr;
-    delete directory;
     delete freeMap;
     return TRUE;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Find where the file header of a file or directory is, and
+//	whether it is a directory.  Return -1 if there is no such file.
+//
+//	A path that was looked up recently is found in the dentry cache;
+//	otherwise the directories on the way to it are searched, and
+//	the answer is remembered.
+//
+//	"path" -- the path name, in canonical form (see CanonicalPath)
+//	"isDirectory" -- set to whether it is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::Lookup(char *path, bool *isDirectory)
+{
+    char fileName[FileNameMaxLen + 1];
+    Directory *directory;
+    int sector = DirectorySector;
+    int length;
+    char *p;
+
+    *isDirectory = TRUE;
+    if (*path == '\0') {
+	return DirectorySector;			// the root
+    }
+    if (dentries->Find(path, &sector, isDirectory)) {
+	return sector;
+    }
+    sector = DirectorySector;
+    for (p = path; *p != '\0'; p += length) {
+	if (!*isDirectory) {
+	    return -1;				// a file on the way
+	}
+	if (*p == '/') {
+	    p++;
+	}
+	for (length = 0; p[length] != '\0' && p[length] != '/'; length++) {
+	    fileName[length] = p[length];
+	}
+	fileName[length] = '\0';
+	directory = GetDirectory(sector)->directory;
+	sector = directory->Find(fileName);
+	if (sector == -1) {
+	    return -1;				// not there
+	}
+	*isDirectory = directory->IsDirectory(fileName);
+    }
+    dentries->Insert(path, sector, *isDirectory);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindParent
+// 	Find the directory that a file or directory is in, or would be
+//	if it existed.  Return NULL if there is no such directory.
+//
+//	"path" -- the path name, in canonical form (see CanonicalPath)
+//	"name" -- set to the last name in the path, the one the 
+//		directory would list
+//----------------------------------------------------------------------
+
+OpenDirectory *
+FileSystem::FindParent(char *path, char **name)
+{
+    char *slash = strrchr(path, '/');
+    bool isDirectory;
+    int sector;
+
+    if (*path == '\0') {
+	return NULL;				// the root has no parent
+    }
+    if (slash == NULL) {
+	*name = path;
+	return GetDirectory(DirectorySector);
+    }
+    *slash = '\0';
+    sector = Lookup(path, &isDirectory);
+    *slash = '/';
+    *name = slash + 1;
+    if (sector == -1 || !isDirectory) {
+	return NULL;
+    }
+    return GetDirectory(sector);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::GetDirectory
+// 	Return a directory, reading it in from disk if it isn't already
+//	in memory.
+//
+//	"sector" -- where the directory's file header is
+//----------------------------------------------------------------------
+
+OpenDirectory *
+FileSystem::GetDirectory(int sector)
+{
+    OpenDirectory *openDir;
+    Directory *directory;
+
+    if (directories->Find(sector, &openDir)) {
+	return openDir;
+    }
+    directory = new Directory(NumDirEntries);
+    openDir = CacheDirectory(sector, directory);
+    directory->FetchFrom(openDir->file);
+    return openDir;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CacheDirectory
+// 	Open a directory's file, and keep it in memory along with its
+//	contents.
+//
+//	"sector" -- where the directory's file header is
+//	"directory" -- its contents
+//----------------------------------------------------------------------
+
+OpenDirectory *
+FileSystem::CacheDirectory(int sector, Directory *directory)
+{
+    OpenDirectory *openDir = new OpenDirectory;
+
+    openDir->sector = sector;
+    openDir->file = new OpenFile(sector);
+    openDir->directory = directory;
+    directories->Insert(openDir);
+    return openDir;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::GrowDirectory
+// 	Make room in a full directory.  If it is full mostly of removed
+//	files, just clear them out of its table.  Otherwise make its 
+//	file twice as big, and then its table; return FALSE, with 
+//	nothing changed, if there is not enough space on disk.
+//
+//	A new file header is written back at once; the caller writes
+//	back "freeMap", and the directory.
+//
+//	"parent" -- the directory
+//	"freeMap" -- the bitmap of free sectors to take space from
+//----------------------------------------------------------------------
+
+bool
+FileSystem::GrowDirectory(OpenDirectory *parent, PersistentBitmap *freeMap)
+{
+    FileHeader *hdr;
+
+    if (!parent->directory->MustGrow()) {
+	parent->directory->Compact();
+	return TRUE;
+    }
+    hdr = new FileHeader;
+    hdr->FetchFrom(parent->sector);
+    if (!hdr->Extend(freeMap, 2 * parent->directory->FileSize())) {
+	delete hdr;
+	return FALSE;
+    }
+    hdr->WriteBack(parent->sector);
+    delete hdr;
+    delete parent->file;			// it has a new header
+    parent->file = new OpenFile(parent->sector);
+    parent->directory->Grow();
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the root directory.
 //----------------------------------------------------------------------
 
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
-    directory->List();
-    delete directory;
+    lock->Acquire();
+    GetDirectory(DirectorySector)->directory->List();
+    lock->Release();
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Print
 // 	Print everything about the file system:
 //	  the contents of the bitmap
-//	  the contents of the directory
+//	  the contents of the root directory
 //	  for each file in the directory,
 //	      the contents of the file header
 //	      the data in the file
@@ -316,9 +806,10 @@ FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile,NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
+    PersistentBitmap *freeMap;
 
+    lock->Acquire();
+    freeMap = new PersistentBitmap(freeMapFile,NumSectors);
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
@@ -329,13 +820,12 @@ FileSystem::Print()
 
     freeMap->Print();
 
-    directory->FetchFrom(directoryFile);
-    directory->Print();
+    GetDirectory(DirectorySector)->directory->Print();
+    lock->Release();
 
     delete bitHdr;
     delete dirHdr;
     delete freeMap;
-    delete directory;
 } 
 
 #endif // FILESYS_STUB
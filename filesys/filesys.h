@@ -18,14 +18,18 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
+//	in the file system.  There is a "root" directory, listing the
+//	files and directories at the top of the tree; as in UNIX, a file
+//	is named by the path of directories leading to it, as in "a/b/c".
 //	In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
 //	bootstrap problem when the simulated disk is initialized. 
 //
+//	Changes to the file system's own data go through a journal (see
+//	journal.h), so that each operation either happens completely or
+//	not at all, even if Nachos stops in the middle of it.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -36,6 +40,7 @@
 #include "copyright.h"
 #include "sysdep.h"
 #include "openfile.h"
+#include "hash.h"
 
 #ifdef FILESYS_STUB 		// Temporarily implement file system calls as 
 				// calls to UNIX, until the real file system
@@ -64,31 +69,99 @@ class FileSystem {
 };
 
 #else // FILESYS
+class Directory;
+class DentryCache;
+class PersistentBitmap;
+class Journal;
+class Lock;
+class FileHeader;
+
+// A directory that has been looked in, kept in memory along with its
+// open file until it is removed, since it will probably be looked in
+// again.
+
+class OpenDirectory {
+  public:
+    int sector;				// Where its file header is
+    OpenFile *file;			// The directory, as a file
+    Directory *directory;		// Its contents
+};
+
+// A file header kept in memory because the file is open, shared by
+// every OpenFile for it (see FileSystem::Open), and freed when the last
+// one is closed.
+
+class OpenHeader {
+  public:
+    int sector;				// Where it is on disk
+    int refCount;			// How many OpenFiles share it
+    FileHeader *hdr;			// The header itself
+};
+
 class FileSystem {
   public:
-    FileSystem(bool format);		// Initialize the file system.
+    FileSystem(bool format, bool journal);
+					// Initialize the file system.
 					// Must be called *after* "synchDisk" 
 					// has been initialized.
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
     					// and the bitmap of free blocks.
+					// If "journal", log each change
+					// before making it.
+    ~FileSystem();			// Close everything that is open
 
     bool Create(char *name, int initialSize);  	
 					// Create a file (UNIX creat)
+    bool Mkdir(char *name);		// Create a directory (UNIX mkdir)
 
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
+    void CloseHeader(OpenHeader *openHdr);
+					// An OpenFile sharing "openHdr" has
+					// been closed
 
-    bool Remove(char *name);  		// Delete a file (UNIX unlink)
+    bool Remove(char *name);  		// Delete a file, or an empty
+					// directory (UNIX unlink, rmdir)
 
-    void List();			// List all the files in the file system
+    void List();			// List all the files in the root
+					// directory
 
     void Print();			// List all the files and their contents
 
+    Journal *GetJournal() { return journal; }
+
   private:
    OpenFile* freeMapFile;		// Bit map of free disk blocks,
 					// represented as a file
-   OpenFile* directoryFile;		// "Root" directory -- list of 
-					// file names, represented as a file
+   HashTable<int, OpenDirectory *> *directories;
+					// Directories in memory, by the
+					// sector of their file header;
+					// the root is always here
+   DentryCache *dentries;		// Where recently used path names
+					// lead
+   HashTable<int, OpenHeader *> *openHeaders;
+					// Headers of the files that are
+					// open, by sector
+   Journal *journal;			// Where changes go first
+   Lock *lock;				// One operation at a time
+
+   void BeginOp();			// Start an operation that changes
+					// the file system
+   void EndOp();			// Finish it, and wait for the changes
+					// to be safely in the journal
+   bool Make(char *name, int initialSize, bool isDirectory);
+					// Create a file or a directory
+   bool Unlink(char *name);		// Delete a file or a directory
+   int Lookup(char *path, bool *isDirectory);
+					// Find the file header for a path
+   OpenDirectory *FindParent(char *path, char **name);
+					// Find the directory a path is in
+   OpenDirectory *GetDirectory(int sector);
+					// Bring a directory into memory
+   OpenDirectory *CacheDirectory(int sector, Directory *directory);
+					// Keep a directory in memory
+   bool GrowDirectory(OpenDirectory *parent, PersistentBitmap *freeMap);
+					// Make room for another entry
 };
 
 #endif // FILESYS
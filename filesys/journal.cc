@@ -0,0 +1,646 @@
+// journal.cc
+//	Routines to manage the file system's journal.
+//
+//	The log is a run of sectors next to each other on disk.  Its
+//	first sector holds JournalMagic and the sequence number of the
+//	first transaction after it.  Each transaction follows the last
+//	one, and is:
+//
+//	   one or more descriptors, each listing up to TagsPerDescriptor
+//	     sectors changed, with the new contents of each one after
+//	     the descriptor; or sectors revoked, given as -1 - sector
+//	   a commit sector, with the number of sectors in the
+//	     transaction, and a checksum of all of them
+//
+//	A transaction is written with one disk request per track, so a
+//	torn write is possible, but recovery only believes a transaction
+//	whose commit sector is there and whose checksum is right.  It
+//	stops at the first one that isn't.
+//
+//	Recovery copies the changes in every committed transaction to
+//	where they belong, in order, except for sectors revoked by the
+//	same or a later transaction.  Copying a change that had already
+//	reached the disk does no harm.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "journal.h"
+#include "synchdisk.h"
+
+static const int JournalMagic = 0x4a524e4c;	// the log's first sector
+static const int DescriptorMagic = 0x4a445343;
+static const int CommitMagic = 0x4a434d54;
+#define IntsPerSector	(SectorSize / (int) sizeof(int))
+#define TagsPerDescriptor (IntsPerSector - 3)
+					// after magic, sequence, and count
+
+//----------------------------------------------------------------------
+// RecordKey, RecordHash
+//	Functions for a transaction's hash table: a record is found by
+//	the number of the sector it changes.
+//----------------------------------------------------------------------
+
+static int
+RecordKey(JournalRecord *record)
+{
+    return record->sector;
+}
+
+static unsigned int
+RecordHash(int sector)
+{
+    return (unsigned int) sector;
+}
+
+//----------------------------------------------------------------------
+// Checksum
+//	Return the sum of the words in some sectors, to tell whether
+//	they all made it to the log.
+//----------------------------------------------------------------------
+
+static unsigned int
+Checksum(char *data, int numSectors)
+{
+    unsigned int *words = (unsigned int *) data;
+    unsigned int sum = 0;
+
+    for (int i = 0; i < numSectors * IntsPerSector; i++) {
+	sum = sum * 31 + words[i];
+    }
+    return sum;
+}
+
+//----------------------------------------------------------------------
+// ReadLog
+//	Make sure the first "upTo" sectors of the log have been read
+//	into "buffer", reading the ones that haven't in one go.  Only as
+//	much of the log as recovery needs is read, which, once the log
+//	has been emptied, is very little.
+//
+//	"firstSector" -- where the log is on disk
+//	"buffer" -- room for the whole log
+//	"numRead" -- how many sectors are already in "buffer"
+//	"upTo" -- how many sectors are needed
+//----------------------------------------------------------------------
+
+static void
+ReadLog(int firstSector, char *buffer, int *numRead, int upTo)
+{
+    upTo = min(upTo, JournalSectors);
+    if (upTo > *numRead) {
+	kernel->synchDisk->ReadSectors(firstSector + *numRead, 
+		upTo - *numRead, &buffer[*numRead * SectorSize]);
+	*numRead = upTo;
+    }
+}
+
+//----------------------------------------------------------------------
+// Transaction::Transaction
+// 	Initialize an empty transaction.
+//
+//	"seq" -- its sequence number
+//----------------------------------------------------------------------
+
+Transaction::Transaction(int seq)
+{
+    this->seq = seq;
+    numOps = 0;
+    records = new List<JournalRecord *>;
+    index = new HashTable<int, JournalRecord *>(RecordKey, RecordHash);
+    revoked = new List<int>;
+}
+
+//----------------------------------------------------------------------
+// Transaction::~Transaction
+// 	De-allocate a transaction, and the changes in it.
+//----------------------------------------------------------------------
+
+Transaction::~Transaction()
+{
+    while (!records->IsEmpty()) {
+	JournalRecord *record = records->RemoveFront();
+
+	index->Remove(record->sector);
+	delete record;
+    }
+    while (!revoked->IsEmpty()) {
+	(void) revoked->RemoveFront();
+    }
+    delete records;
+    delete index;
+    delete revoked;
+}
+
+//----------------------------------------------------------------------
+// Transaction::Find
+// 	Return the new contents of a sector, or NULL if the transaction
+//	doesn't change it.
+//----------------------------------------------------------------------
+
+JournalRecord *
+Transaction::Find(int sector)
+{
+    JournalRecord *record;
+
+    return index->Find(sector, &record) ? record : NULL;
+}
+
+//----------------------------------------------------------------------
+// Transaction::IsRevoked
+// 	Return whether the transaction frees a sector.
+//----------------------------------------------------------------------
+
+bool
+Transaction::IsRevoked(int sector)
+{
+    return revoked->IsInList(sector);
+}
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize a journal.  Before it is used, the log must be
+//	emptied, with Format or Recover.
+//
+//	"firstSector" -- where the log is on disk
+//	"enabled" -- if FALSE, operations change the disk directly, as
+//		if there were no journal; Recover still works
+//----------------------------------------------------------------------
+
+Journal::Journal(int firstSector, bool enabled)
+{
+    this->firstSector = firstSector;
+    this->enabled = enabled;
+    head = 1;
+    running = NULL;
+    committing = NULL;
+    committedSeq = 0;
+    owner = NULL;
+    changed = FALSE;
+    logged = new Bitmap(NumSectors);
+    lock = new Lock("journal lock");
+    opDone = new Condition("journal operation done");
+    commitDone = new Condition("journal commit done");
+    numCommits = numOps = 0;
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the journal.  Every operation has been committed.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    delete running;
+    delete logged;
+    delete lock;
+    delete opDone;
+    delete commitDone;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Start with an empty log, on a newly formatted disk.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    char *buffer = new char[JournalSectors * SectorSize];
+
+    bzero(buffer, JournalSectors * SectorSize);	// so nothing left on the
+    kernel->synchDisk->WriteThrough(firstSector, JournalSectors, buffer);
+    delete [] buffer;				// disk looks like a
+    Checkpoint(1);				// transaction
+    running = new Transaction(1);
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Read the log, and copy the changes in each committed transaction
+//	to where they belong, then empty the log.  This finishes the
+//	operations that had committed when Nachos last stopped, whether
+//	or not their changes had reached the disk; the ones that hadn't
+//	committed leave no trace.
+//----------------------------------------------------------------------
+
+void
+Journal::Recover()
+{
+    char *buffer = new char[JournalSectors * SectorSize];
+    int *words = (int *) buffer;
+    List<Transaction *> *found = new List<Transaction *>;
+    int seq, pos = 1;
+    int numRead = 0;
+    bool recovered = FALSE;
+
+    ReadLog(firstSector, buffer, &numRead, 2);
+    ASSERT(words[0] == JournalMagic);	// else the disk was formatted
+					// before there was a journal
+    for (seq = words[1]; ; seq++) {	// find the committed transactions
+	Transaction *transaction = new Transaction(seq);
+	int start = pos;
+
+	while (pos < JournalSectors) {
+	    ReadLog(firstSector, buffer, &numRead, pos + 1);
+	    words = (int *) &buffer[pos * SectorSize];
+	    if ((words[1] != seq) || (words[0] != DescriptorMagic) ||
+			(words[2] > TagsPerDescriptor)) {
+		break;
+	    }
+	    pos++;
+	    ReadLog(firstSector, buffer, &numRead, pos + words[2] + 1);
+					// its data, and what comes next
+	    for (int i = 0; i < words[2]; i++) {
+		int tag = words[3 + i];
+
+		if (tag < 0) {
+		    transaction->revoked->Append(-1 - tag);
+		} else if (pos < JournalSectors) {
+		    JournalRecord *record = new JournalRecord;
+
+		    record->sector = tag;
+		    bcopy(&buffer[pos++ * SectorSize], record->data, SectorSize);
+		    if ((tag < NumSectors) && (transaction->Find(tag) == NULL)) {
+			transaction->records->Append(record);
+			transaction->index->Insert(record);
+		    } else {
+			delete record;	// corrupt; the checksum will fail
+		    }
+		}
+	    }
+	}
+	if ((pos < JournalSectors) && (words[0] == CommitMagic) &&
+		(words[1] == seq) && (words[2] == pos - start + 1) &&
+		((unsigned int) words[3] ==
+		    Checksum(&buffer[start * SectorSize], pos - start))) {
+	    found->Append(transaction);
+	    pos++;
+	} else {
+	    delete transaction;		// not committed: the end of the log
+	    break;
+	}
+    }
+
+    while (!found->IsEmpty()) {		// copy the changes, in order
+	Transaction *transaction = found->RemoveFront();
+
+	recovered = TRUE;
+	ListIterator<JournalRecord *> records(transaction->records);
+
+	for (; !records.IsDone(); records.Next()) {
+	    int sector = records.Item()->sector;
+	    ListIterator<Transaction *> later(found);
+	    bool revoked = transaction->IsRevoked(sector);
+
+	    for (; !later.IsDone() && !revoked; later.Next()) {
+		revoked = later.Item()->IsRevoked(sector);
+	    }
+	    if (!revoked) {
+		kernel->synchDisk->WriteSector(sector, records.Item()->data);
+	    }
+	}
+	DEBUG(dbgFile, "Recovered transaction " << transaction->seq);
+	delete transaction;
+    }
+    delete found;
+    delete [] buffer;
+
+    if (recovered) {
+	Checkpoint(seq);
+    }					// else the log is empty already
+    running = new Transaction(seq);
+    committedSeq = seq - 1;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Note that the current thread is starting an operation, so that
+//	the sectors it writes are logged.  The caller makes sure no
+//	other operation is going on.
+//
+//	If the running transaction already fills a quarter of the log,
+//	commit it first, so that it doesn't get too big to fit.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    if (!enabled) {
+	return;
+    }
+    lock->Acquire();
+    ASSERT(owner == NULL);
+    if (running->records->NumInList() > JournalSectors / 4) {
+	int seq = running->seq;
+
+	lock->Release();
+	Commit(seq);
+	lock->Acquire();
+    }
+    owner = kernel->currentThread;
+    changed = FALSE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Note that the operation has finished.  Return the sequence
+//	number of the transaction it is in, for Commit, or 0 if it
+//	didn't change anything, so there is nothing to wait for.
+//----------------------------------------------------------------------
+
+int
+Journal::End()
+{
+    int seq = 0;
+
+    if (!enabled) {
+	return 0;
+    }
+    lock->Acquire();
+    ASSERT(owner == kernel->currentThread);
+    owner = NULL;
+    if (changed) {
+	running->numOps++;
+	seq = running->seq;
+    }
+    opDone->Broadcast(lock);
+    lock->Release();
+    return seq;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Wait until a transaction is in the log on disk.
+//
+//	If another thread is writing to the log, wait for it; then, if
+//	our transaction still isn't there, write the running one, with
+//	the operations that have joined it in the meantime.  An
+//	operation in progress is waited for, since its changes must
+//	all go in the same transaction.
+//
+//	"seq" -- the transaction to wait for, from End
+//----------------------------------------------------------------------
+
+void
+Journal::Commit(int seq)
+{
+    bool inLog;
+
+    if (seq == 0) {
+	return;
+    }
+    lock->Acquire();
+    while (committedSeq < seq) {
+	if (committing != NULL) {
+	    commitDone->Wait(lock);	// someone else is writing the log
+	} else if (owner != NULL) {
+	    opDone->Wait(lock);		// don't split an operation
+	} else {
+	    committing = running;
+	    running = new Transaction(committing->seq + 1);
+	    lock->Release();
+
+	    inLog = WriteLog(committing);
+	    Install(committing);
+	    if (!inLog) {
+		Checkpoint(committing->seq + 1);	// write it home now
+	    }
+
+	    lock->Acquire();
+	    committedSeq = committing->seq;
+	    numCommits++;
+	    numOps += committing->numOps;
+	    delete committing;
+	    committing = NULL;
+	    commitDone->Broadcast(lock);
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Revoke
+// 	Note that the operation has freed some sectors that the log may
+//	have old contents for, so that they aren't copied back, over
+//	whatever the sectors are used for next.
+//
+//	"freeMap" -- the bitmap of free sectors, after the operation
+//----------------------------------------------------------------------
+
+void
+Journal::Revoke(Bitmap *freeMap)
+{
+    if (owner != kernel->currentThread) {
+	return;
+    }
+    for (int sector = 0; sector < NumSectors; sector++) {
+	if (logged->Test(sector) && !freeMap->Test(sector)) {
+	    JournalRecord *record = running->Find(sector);
+
+	    if (record != NULL) {
+		running->records->Remove(record);
+		running->index->Remove(sector);
+		delete record;
+	    }
+	    running->revoked->Append(sector);
+	    logged->Clear(sector);
+	    changed = TRUE;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	If the current thread is doing an operation, add a sector it
+//	writes to the running transaction, and return TRUE.  Otherwise
+//	return FALSE, and SynchDisk writes it as usual.
+//
+//	"sector" -- the sector being written
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+bool
+Journal::Log(int sector, char *data)
+{
+    JournalRecord *record;
+
+    if ((owner == NULL) || (owner != kernel->currentThread)) {
+	return FALSE;
+    }
+    record = running->Find(sector);
+    if (record == NULL) {
+	record = new JournalRecord;
+	record->sector = sector;
+	running->records->Append(record);
+	running->index->Insert(record);
+    }
+    bcopy(data, record->data, SectorSize);
+    if (running->IsRevoked(sector)) {
+	running->revoked->Remove(sector);	// in use again
+    }
+    if (!logged->Test(sector)) {
+	logged->Mark(sector);
+    }
+    changed = TRUE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Overlay
+// 	Replace sectors just read from the disk, or its cache, with any
+//	new contents that haven't been written there yet: those in the
+//	running transaction, or the one being committed.
+//
+//	"sector" -- the first sector read
+//	"numSectors" -- how many
+//	"data" -- their contents
+//----------------------------------------------------------------------
+
+void
+Journal::Overlay(int sector, int numSectors, char *data)
+{
+    JournalRecord *record;
+
+    if (!enabled || (running == NULL)) {
+	return;
+    }
+    for (int i = 0; i < numSectors; i++) {
+	record = running->Find(sector + i);
+	if ((record == NULL) && (committing != NULL) &&
+		!running->IsRevoked(sector + i)) {
+	    record = committing->Find(sector + i);
+	}
+	if (record != NULL) {
+	    bcopy(record->data, &data[i * SectorSize], SectorSize);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteLog
+// 	Write a transaction to the log, as one run of sectors, and wait
+//	for it to reach the disk.  If the log hasn't room, empty it
+//	first.
+//
+//	Return FALSE if the transaction is too big for even an empty 
+//	log (a very big directory growing, say).  Then the caller has
+//	to write its changes straight to their places on disk; if 
+//	Nachos stops half way, some of them may be lost.
+//----------------------------------------------------------------------
+
+bool
+Journal::WriteLog(Transaction *transaction)
+{
+    ListIterator<JournalRecord *> records(transaction->records);
+    ListIterator<int> revoked(transaction->revoked);
+    int numRecords = transaction->records->NumInList();
+    int numTags = numRecords + transaction->revoked->NumInList();
+    int numSectors = divRoundUp(numTags, TagsPerDescriptor) + numRecords + 1;
+    char *buffer;
+    int *words;
+    int pos = 0;
+
+    if (numTags == 0) {
+	return TRUE;
+    }
+    if (numSectors > JournalSectors - 1) {
+	return FALSE;
+    }
+    if (head + numSectors > JournalSectors) {
+	Checkpoint(transaction->seq);
+    }
+
+    buffer = new char[numSectors * SectorSize];
+    bzero(buffer, numSectors * SectorSize);
+    while (!records.IsDone() || !revoked.IsDone()) {
+	words = (int *) &buffer[pos++ * SectorSize];	// a descriptor
+	words[0] = DescriptorMagic;
+	words[1] = transaction->seq;
+	for (; (words[2] < TagsPerDescriptor) && !records.IsDone();
+		records.Next()) {
+	    words[3 + words[2]++] = records.Item()->sector;
+	    bcopy(records.Item()->data, &buffer[pos++ * SectorSize],
+			SectorSize);
+	}
+	for (; (words[2] < TagsPerDescriptor) && !revoked.IsDone();
+		revoked.Next()) {
+	    words[3 + words[2]++] = -1 - revoked.Item();
+	}
+    }
+    words = (int *) &buffer[pos * SectorSize];		// the commit
+    words[0] = CommitMagic;
+    words[1] = transaction->seq;
+    words[2] = numSectors;
+    words[3] = (int) Checksum(buffer, pos);
+    ASSERT(pos + 1 == numSectors);
+
+    kernel->synchDisk->WriteThrough(firstSector + head, numSectors, buffer);
+    head += numSectors;
+    delete [] buffer;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Install
+// 	Write the changes in a committed transaction to the disk's
+//	cache, which will write them to their places on disk.  A sector
+//	that the running transaction has revoked in the meantime may
+//	already hold something else, so it is left alone.
+//----------------------------------------------------------------------
+
+void
+Journal::Install(Transaction *transaction)
+{
+    ListIterator<JournalRecord *> records(transaction->records);
+
+    for (; !records.IsDone(); records.Next()) {
+	if (!running->IsRevoked(records.Item()->sector)) {
+	    kernel->synchDisk->WriteSector(records.Item()->sector,
+						records.Item()->data);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Make sure every change in the log has reached its place on disk,
+//	by flushing the cache, and then empty the log.  From now on, 
+//	only the sectors in transactions not yet in the log can be in it.
+//
+//	"seq" -- the sequence number of the next transaction
+//----------------------------------------------------------------------
+
+void
+Journal::Checkpoint(int seq)
+{
+    char *buffer = new char[SectorSize];
+    int *words = (int *) buffer;
+
+    kernel->synchDisk->Flush();
+    bzero(buffer, SectorSize);
+    words[0] = JournalMagic;
+    words[1] = seq;
+    kernel->synchDisk->WriteThrough(firstSector, 1, buffer);
+    delete [] buffer;
+    head = 1;
+
+    delete logged;
+    logged = new Bitmap(NumSectors);
+    for (int i = 0; i < 2; i++) {
+	Transaction *transaction = (i == 0) ? committing : running;
+
+	if (transaction != NULL) {
+	    ListIterator<JournalRecord *> records(transaction->records);
+
+	    for (; !records.IsDone(); records.Next()) {
+		logged->Mark(records.Item()->sector);
+	    }
+	}
+    }
+    DEBUG(dbgFile, "Journal checkpoint, next transaction " << seq);
+}
@@ -0,0 +1,148 @@
+// journal.h
+//	Data structures for the file system's journal: a log on disk,
+//	written sequentially, of the sectors that each file system
+//	operation changes, so that the changes reach the disk together
+//	and in order, and can be finished if Nachos stops half way.
+//
+//	Only the file system's own data -- file headers, directories
+//	and the bitmap of free sectors -- is journaled.  The data in
+//	files goes through the disk's cache, as before.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "bitmap.h"
+#include "list.h"
+#include "hash.h"
+#include "synch.h"
+
+class Thread;
+
+const int JournalSectors = 128;		// size of the log on disk,
+					// including its first sector, which
+					// says where the log starts
+
+// The following class defines the new contents of one sector, as an
+// operation left it.
+
+class JournalRecord {
+  public:
+    JournalRecord() { data = new char[SectorSize]; }
+    ~JournalRecord() { delete [] data; }
+
+    int sector;			// the sector changed
+    char *data;			// its new contents
+};
+
+// The following class defines a transaction: the changes made by one
+// or more operations, which go to the log together.  A sector changed
+// twice has only its last contents here.
+//
+// "revoked" lists the sectors that held the file system's data, but
+// have been freed; the log may have old contents for them, which
+// must not be copied back after the sectors have been used for
+// something else.
+
+class Transaction {
+  public:
+    Transaction(int seq);		// An empty transaction
+    ~Transaction();
+
+    JournalRecord *Find(int sector);	// The changes to a sector, if any
+    bool IsRevoked(int sector);		// Was the sector freed?
+    bool IsEmpty() { return records->IsEmpty() && revoked->IsEmpty(); }
+
+    int seq;				// Sequence number, in the log
+    int numOps;				// Operations in the transaction
+    List<JournalRecord *> *records;	// The changes, in order
+    HashTable<int, JournalRecord *> *index;
+					// The changes, by sector
+    List<int> *revoked;			// Sectors that were freed
+};
+
+// The following class defines the journal.
+//
+// A file system operation calls Begin before it changes anything,
+// and End when it has finished.  In between, every sector the thread
+// writes is added to the running transaction instead of going to
+// the disk (see Log), and reading it gives the new contents (see
+// Overlay).  Once the file system is consistent for other threads
+// again, the operation calls Commit to wait until its changes are in
+// the log on disk.
+//
+// Operations that finish while a transaction is being written to the
+// log go into the next transaction, which the first of them to call
+// Commit writes on behalf of them all ("group commit").  Each
+// transaction is one disk write, of sectors next to each other.
+//
+// Once a transaction is in the log, its sectors are written to the
+// disk's cache, which writes them to their places on disk in its own
+// time.  When the log is full, the cache is flushed, and the log
+// starts again from the beginning ("checkpoint").
+//
+// Operations must be done one at a time -- the file system holds a
+// lock -- but Commit can be called by several threads at once.
+
+class Journal {
+  public:
+    Journal(int firstSector, bool enabled);
+					// A journal whose log starts at
+					// "firstSector"; if not "enabled",
+					// nothing is logged
+    ~Journal();
+
+    void Format();			// Start with an empty log
+    void Recover();			// Finish the changes in the log,
+					// then empty it
+
+    void Begin();			// An operation is starting
+    int End();				// It has finished; return the
+					// transaction to wait for
+    void Commit(int seq);		// Wait until transaction "seq" is
+					// in the log
+    void Revoke(Bitmap *freeMap);	// Sectors have been freed
+
+    bool Log(int sector, char *data);	// Write a sector, if we are in an
+					// operation; for SynchDisk
+    void Overlay(int sector, int numSectors, char *data);
+					// Apply changes not yet in the log
+					// to what was read from disk
+
+    bool IsEnabled() { return enabled; }
+    int NumCommits() { return numCommits; }
+    int NumOps() { return numOps; }	// For measuring group commit
+
+  private:
+    int firstSector;			// Where the log is on disk
+    bool enabled;			// Is anything logged?
+    int head;				// Where the next transaction goes,
+					// from the start of the log
+    Transaction *running;		// Being added to by operations
+    Transaction *committing;		// Being written to the log, or
+					// NULL
+    int committedSeq;			// The last transaction in the log
+    Thread *owner;			// The thread doing an operation
+    bool changed;			// Has the operation changed anything?
+    Bitmap *logged;			// Sectors in the log since the last
+					// checkpoint
+    Lock *lock;				// Protects the above
+    Condition *opDone;			// Signalled when an operation ends
+    Condition *commitDone;		// ...and when a commit ends
+    int numCommits, numOps;
+
+    bool WriteLog(Transaction *transaction);
+					// Write a transaction to the log
+    void Install(Transaction *transaction);
+					// Write its sectors to the cache
+    void Checkpoint(int seq);		// Flush the cache, and empty the
+					// log; "seq" is the next transaction
+};
+
+#endif // JOURNAL_H
@@ -5,7 +5,12 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  Files opened through the file 
+//	system share one copy of it, which the file system keeps track
+//	of; the file system's own files each have a copy to themselves.
+//
+//	We also keep track of where the last read ended, so that we 
+//	can tell when a file is being read sequentially, and read ahead.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -28,19 +33,46 @@
 
 OpenFile::OpenFile(int sector)
 { 
+    this->sector = sector;
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    shared = NULL;
     seekPosition = 0;
+    nextPosition = 0;			// reading from the start counts
+    readAheadTo = -1;			// as sequential
+}
+
+//----------------------------------------------------------------------
+// OpenFile::OpenFile
+// 	Open a Nachos file whose header the file system already has in
+//	memory.  The file system has counted us as one of its users.
+//
+//	"shared" -- the header, and how many OpenFiles share it
+//----------------------------------------------------------------------
+
+OpenFile::OpenFile(OpenHeader *shared)
+{ 
+    sector = shared->sector;
+    hdr = shared->hdr;
+    this->shared = shared;
+    seekPosition = 0;
+    nextPosition = 0;
+    readAheadTo = -1;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	A shared header is the file system's to free.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    if (shared != NULL) {
+	kernel->fileSystem->CloseHeader(shared);
+    } else {
+	delete hdr;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -98,7 +130,9 @@ OpenFile::Write(char *into, int numBytes)
 //
 //	For ReadAt:
 //	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   request, but we only copy the part we are interested in.  If the
+//	   request starts where the last one ended, we also ask for the
+//	   next few sectors to be read ahead.
 //	For WriteAt:
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
@@ -116,28 +150,38 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector, numSectors, run;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
-    if ((position + numBytes) > fileLength)		
-	numBytes = fileLength - position;
+    if (numBytes > fileLength - position)	// not position + numBytes,
+	numBytes = fileLength - position;	// which can overflow
     //DEBUG(dbgFile, "Reading " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
+    // read in all the full and partial sectors that we need, 
+    // as many at a time as are next to each other on the disk
     buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+    for (i = firstSector; i <= lastSector; i += run) {
+	run = ContiguousSectors(i, lastSector);
+        kernel->synchDisk->ReadSectors(hdr->ByteToSector(i * SectorSize), 
+				run, &buf[(i - firstSector) * SectorSize]);
+    }
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
     delete [] buf;
+
+    if (position == nextPosition) {	// sequential
+	ReadAhead(lastSector);
+    } else {
+	readAheadTo = lastSector;
+    }
+    nextPosition = position + numBytes;
     return numBytes;
 }
 
@@ -145,14 +189,14 @@ int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector, numSectors, run;
     bool firstAligned, lastAligned;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
 	return 0;				// check request
-    if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;
+    if (numBytes > fileLength - position)	// not position + numBytes,
+	numBytes = fileLength - position;	// which can overflow
     //DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
     firstSector = divRoundDown(position, SectorSize);
@@ -166,22 +210,70 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
 // read in first and last sector, if they are to be partially modified
     if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
+        kernel->synchDisk->ReadSector(hdr->ByteToSector(firstSector * 
+					SectorSize), buf);
     if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+        kernel->synchDisk->ReadSector(hdr->ByteToSector(lastSector * 
+		SectorSize), &buf[(lastSector - firstSector) * SectorSize]);
 
 // copy in the bytes we want to change 
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
 
 // write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+    for (i = firstSector; i <= lastSector; i += run) {
+	run = ContiguousSectors(i, lastSector);
+        kernel->synchDisk->WriteSectors(hdr->ByteToSector(i * SectorSize), 
+				run, &buf[(i - firstSector) * SectorSize]);
+    }
     delete [] buf;
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Ask the disk to read the sectors that follow a sequential read
+//	into its cache, so they are there by the time we want them.
+//	Sectors we have already asked for aren't asked for again.
+//
+//	"lastSector" -- the last sector of the file that was just read
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int lastSector)
+{
+    int last = min(lastSector + kernel->synchDisk->ReadAheadSectors(),
+			divRoundUp(hdr->FileLength(), SectorSize) - 1);
+
+    for (int i = max(lastSector, readAheadTo) + 1; i <= last; i++) {
+	kernel->synchDisk->ReadAhead(hdr->ByteToSector(i * SectorSize));
+    }
+    if (last > readAheadTo) {
+	readAheadTo = last;
+    }
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ContiguousSectors
+// 	Return how many of the file's sectors, starting with "from" and
+//	going no further than "to", are in consecutive sectors of the
+//	disk, so they can be transferred together.  Always at least one.
+//
+//	"from", "to" -- sectors of the file (not of the disk)
+//----------------------------------------------------------------------
+
+int
+OpenFile::ContiguousSectors(int from, int to)
+{
+    int first = hdr->ByteToSector(from * SectorSize);
+    int run = 1;
+
+    while ((from + run <= to) && 
+		(hdr->ByteToSector((from + run) * SectorSize) == first + run)) {
+	run++;
+    }
+    return run;
+}
+
 //----------------------------------------------------------------------
 // OpenFile::Length
 // 	Return the number of bytes in the file.
@@ -9,9 +9,12 @@
 //
 //	The other is the "real" implementation, that turns these
 //	operations into read and write disk sector requests. 
-//	In this baseline implementation of the file system, we don't 
-//	worry about concurrent accesses to the file system
-//	by different threads.
+//	Each OpenFile has its own position in the file, but the file
+//	system gives all the OpenFiles for one file the same header.
+//
+//	A read that starts where the last one left off suggests the 
+//	file is being read sequentially; the real implementation then
+//	has the disk read the next few sectors ahead of time.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -58,6 +61,8 @@ class OpenFile {
 		}
 
     int Length() { Lseek(file, 0, 2); return Tell(file); }
+
+    int FileId() { return FileNumber(file); }
     
   private:
     int file;
@@ -66,11 +71,15 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class OpenHeader;
 
 class OpenFile {
   public:
     OpenFile(int sector);		// Open a file whose header is located
 					// at "sector" on the disk
+    OpenFile(OpenHeader *shared);	// Open a file whose header is
+					// already in memory, shared with
+					// other OpenFiles (see filesys.h)
     ~OpenFile();			// Close the file
 
     void Seek(int position); 		// Set the position from which to 
@@ -91,10 +100,27 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    int FileId() { return sector; }	// A number that identifies the 
+					// file, while it exists: the same 
+					// for every OpenFile for it
     
   private:
+    int sector;				// Where the header is on disk
     FileHeader *hdr;			// Header for this file 
+    OpenHeader *shared;			// Where "hdr" came from, if it is
+					// shared; else NULL, and it's ours
     int seekPosition;			// Current position within the file
+    int nextPosition;			// Where the last read ended
+    int readAheadTo;			// Last sector of the file we have
+					// asked the disk to read ahead
+
+    void ReadAhead(int lastSector);	// Read ahead of a sequential read
+					// that ended in "lastSector"
+    int ContiguousSectors(int from, int to);
+					// How many of the file's sectors,
+					// starting at "from", follow each 
+					// other on the disk
 };
 
 #endif // FILESYS
@@ -77,3 +77,38 @@ PersistentBitmap::WriteBack(OpenFile *file)
 {
    file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
 }
+
+//----------------------------------------------------------------------
+// PersistentBitmap::AllocateRun
+// 	Find a run of clear bits, and set them -- for allocating disk
+//	sectors to a file that doesn't fit in one run.  Take the first 
+//	clear bits at or after "hint", however few, up to "wanted"; the
+//	caller can ask again for the rest, with the hint just after them.
+//	So on a fragmented disk a file fills the gaps along the tracks in
+//	order, on as few tracks as it can.  (Jumping to the longest gaps,
+//	wherever they are, costs more in seeks and rotations than it 
+//	saves in requests.)
+//
+//	Return the number of bits set (0 if none were clear).
+//
+//	"wanted" -- how many bits the caller would like
+//	"hint" -- where to start looking
+//	"start" -- set to the first bit of the run
+//----------------------------------------------------------------------
+
+int
+PersistentBitmap::AllocateRun(int wanted, int hint, int *start)
+{
+    int length;
+
+    ASSERT(wanted > 0);
+    *start = FindRun(1, hint);
+    if (*start == -1) {
+	return 0;			// full
+    }
+    length = min(RunLength(*start), wanted);
+    for (int i = *start; i < *start + length; i++) {
+	Mark(i);
+    }
+    return length;
+}
@@ -30,6 +30,11 @@ class PersistentBitmap : public Bitmap {
 
     void FetchFrom(OpenFile *file);     // read bitmap from the disk
     void WriteBack(OpenFile *file); 	// write bitmap contents to disk 
+
+    int AllocateRun(int wanted, int hint, int *start);
+					// Find and set the first run of up to
+					// "wanted" clear bits after "hint";
+					// return how many, and where they start
 };
 
 #endif // PBITMAP_H
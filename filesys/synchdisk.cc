@@ -5,10 +5,30 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Because the physical disk can only handle one operation at a 
+//	time, requests that come while it is busy wait in a queue.
+//	Each time the disk finishes, the interrupt handler wakes up the 
+//	thread whose request it was, and sends the disk the waiting 
+//	request the scheduling policy prefers.  A lock protects the cache.
+//
+//	In front of the disk is a buffer cache of whole sectors, found
+//	through a hash table and replaced in LRU order.  Metadata such
+//	as the free map, the directory and file headers is read over 
+//	and over, so it mostly comes from the cache.  Writes are only 
+//	copied into the cache; changed sectors go to the disk when they 
+//	are evicted, or when a "flusher" thread, which exists only while
+//	there are changed sectors, wakes up and writes them all back.
+//
+//	Sectors that are read ahead are read by a "read-ahead" thread,
+//	started the first time it is needed; it waits for more sectors
+//	to read, rather than finishing, since sequential reads ask for 
+//	them one by one.  Since there is only one disk, reading ahead 
+//	only helps if the thread that asked has something else to do in
+//	the meantime -- such as reading the sectors that are already in
+//	the cache, which is why this thread doesn't hold on to the cache
+//	while it waits for the disk.  Nor does a thread that missed in
+//	the cache, so several can be waiting for the disk at once, and
+//	the scheduling policy has a choice.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,39 +36,171 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "journal.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// ParseDiskSchedulingPolicy
+// 	Look up a disk scheduling policy by name, for the "-ds" flag.
+//
+//	"name" -- "fcfs", "sstf", "scan" or "clook"
+//	"policy" -- where to store the policy, if the name is known
+//----------------------------------------------------------------------
+
+bool
+ParseDiskSchedulingPolicy(char *name, DiskSchedulingPolicy *policy)
+{
+    if (strcmp(name, "fcfs") == 0) {
+	*policy = FCFSDiskScheduling;
+    } else if (strcmp(name, "sstf") == 0) {
+	*policy = SSTFDiskScheduling;
+    } else if (strcmp(name, "scan") == 0) {
+	*policy = ScanDiskScheduling;
+    } else if (strcmp(name, "clook") == 0) {
+	*policy = CLookDiskScheduling;
+    } else {
+	return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// CacheKey, CacheHash
+//	Functions for the cache's hash table: an entry is found by 
+//	the number of the sector it holds, and sector numbers are
+//	already spread out well enough.
+//----------------------------------------------------------------------
+
+static int
+CacheKey(CacheEntry *entry)
+{
+    return entry->sector;
+}
+
+static unsigned int
+CacheHash(int sector)
+{
+    return (unsigned int) sector;
+}
+
+//----------------------------------------------------------------------
+// RunFlushDaemon
+//	Start up the flusher thread.
+//----------------------------------------------------------------------
+
+static void
+RunFlushDaemon(int dummy)
+{
+    kernel->synchDisk->FlushDaemon();
+}
 
+//----------------------------------------------------------------------
+// RunReadAheadDaemon
+//	Start up the read-ahead thread.
+//----------------------------------------------------------------------
+
+static void
+RunReadAheadDaemon(int dummy)
+{
+    kernel->synchDisk->ReadAheadDaemon();
+}
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
-//	initializing the physical disk.
+//	initializing the physical disk.  The cache starts out empty.
 //
+//	"cacheSectors" -- how many sectors to cache; 0 turns caching off
+//	"readAheadSectors" -- how far ahead of a sequential reader to
+//		read, at most half the cache; 0 turns read-ahead off
+//	"policy" -- how to choose among requests waiting for the disk
+//	"mapDisk" -- map the disk's UNIX file into memory (see disk.h)
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk()
+SynchDisk::SynchDisk(int cacheSectors, int readAheadSectors,
+			DiskSchedulingPolicy policy, bool mapDisk)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(this);
+    ASSERT((cacheSectors >= 0) && (readAheadSectors >= 0));
+    this->policy = policy;
+    active = NULL;
+    waiting = new List<DiskRequest *>;
+    headSector = 0;			// where Disk starts out
+    headUp = TRUE;
+    lock = new Lock("disk cache lock");
+    readDone = new Condition("disk read done");
+    disk = new Disk(this, mapDisk);
+
+    numEntries = cacheSectors;
+    entries = new CacheEntry[numEntries];
+    cacheData = new char[numEntries * SectorSize];
+    index = new HashTable<int, CacheEntry *>(CacheKey, CacheHash);
+    newest = oldest = NULL;
+    for (int i = 0; i < numEntries; i++) {	// in any order, to start
+	entries[i].sector = -1;
+	entries[i].dirty = FALSE;
+	entries[i].busy = FALSE;
+	entries[i].data = &cacheData[i * SectorSize];
+	entries[i].newer = NULL;
+	entries[i].older = newest;
+	if (newest != NULL) {
+	    newest->newer = &entries[i];
+	} else {
+	    oldest = &entries[i];
+	}
+	newest = &entries[i];
+    }
+    numDirty = 0;
+    flusher = NULL;
+    this->readAheadSectors = min(readAheadSectors, cacheSectors / 2);
+					// else sectors read ahead would push
+					// each other out of the cache
+    readAheadList = new List<int>;
+    reader = NULL;
+    readerIdle = FALSE;
+    journal = NULL;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction.  The flusher, if any, is asleep or ready to run,
+//	so it belongs to the alarm or the scheduler; the read-ahead 
+//	thread is ours to delete, if it's idle.  Any requests still 
+//	waiting belong to threads that will never run again.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
 {
+    while (!waiting->IsEmpty()) {
+	(void) waiting->RemoveFront();
+    }
+    delete waiting;
+    if ((reader != NULL) && readerIdle) {
+	delete reader;
+    }
+    while (!readAheadList->IsEmpty()) {
+	(void) readAheadList->RemoveFront();
+    }
+    delete readAheadList;
+    for (int i = 0; i < numEntries; i++) {
+	if (entries[i].sector != -1) {
+	    index->Remove(entries[i].sector);
+	}
+    }
+    delete index;
+    delete [] entries;
+    delete [] cacheData;
     delete disk;
+    delete readDone;
     delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
-// 	Read the contents of a disk sector into a buffer.  Return only
-//	after the data has been read.
+// 	Read the contents of a disk sector into a buffer, from the cache
+//	if it's there.  Return only after the data has been read.  While
+//	a sector is read into the cache, its entry is busy (see 
+//	FindEntry), and other threads can use the rest of the cache.
 //
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
@@ -57,16 +209,42 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    CacheEntry *entry;
+    bool hit;
+
+    if (numEntries == 0) {
+	DiskRead(sectorNumber, 1, data);
+	if (journal != NULL) {
+	    journal->Overlay(sectorNumber, 1, data);
+	}
+	return;
+    }
+    lock->Acquire();
+    entry = FindEntry(sectorNumber, &hit);
+    if (hit) {
+	kernel->stats->numDiskCacheHits++;
+    } else {
+	kernel->stats->numDiskCacheMisses++;
+	entry->busy = TRUE;
+	lock->Release();
+	DiskRead(sectorNumber, 1, entry->data);
+	lock->Acquire();
+	entry->busy = FALSE;
+	readDone->Broadcast(lock);
+    }
+    bcopy(entry->data, data, SectorSize);
     lock->Release();
+    if (journal != NULL) {
+	journal->Overlay(sectorNumber, 1, data);
+    }
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
-// 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+// 	Write the contents of a buffer into a disk sector.  With the
+//	cache, this only changes the cached copy; the disk is written
+//	later.  Without it, return only after the data has been written.
+//	In a file system operation, the journal takes the sector instead.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -75,20 +253,637 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    CacheEntry *entry;
+    bool hit;
+
+    if ((journal != NULL) && journal->Log(sectorNumber, data)) {
+	return;
+    }
+    if (numEntries == 0) {
+	DiskWrite(sectorNumber, 1, data);
+	return;
+    }
+    lock->Acquire();
+    entry = FindEntry(sectorNumber, &hit);	// no need to read it in,
+    bcopy(data, entry->data, SectorSize);	// since we replace it all
+    if (!entry->dirty) {
+	entry->dirty = TRUE;
+	numDirty++;
+    }
+    if (flusher == NULL) {
+	flusher = new Thread("disk flusher");
+	flusher->Fork((VoidFunctionPtr) RunFlushDaemon, 0);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read the contents of a run of disk sectors into a buffer.  The
+//	ones in the cache come from there; the rest are read from the
+//	disk a run at a time (see ReadRun), and cached.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"numSectors" -- how many sectors to read
+//	"data" -- the buffer to hold their contents
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int numSectors, char *data)
+{
+    int run;
+
+    if (numEntries == 0) {
+	DiskRead(sectorNumber, numSectors, data);
+	if (journal != NULL) {
+	    journal->Overlay(sectorNumber, numSectors, data);
+	}
+	return;
+    }
+    for (int i = 0; i < numSectors; i += run) {
+	run = 0;
+	if (!index->IsInTable(sectorNumber + i)) {  // (no lock; see ReadAhead)
+	    run = ReadRun(sectorNumber + i, numSectors - i, 
+				data + i * SectorSize);
+	    kernel->stats->numDiskCacheMisses += run;
+	    if ((run > 0) && (journal != NULL)) {
+		journal->Overlay(sectorNumber + i, run, data + i * SectorSize);
+	    }
+	}
+	if (run == 0) {
+	    ReadSector(sectorNumber + i, data + i * SectorSize);
+	    run = 1;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadRun
+// 	Read a run of sectors that aren't in the cache, with one disk 
+//	request per track, into "data" and into the cache.  As in 
+//	ReadSector, their entries are busy until the data arrives.
+//
+//	Once we have one busy entry, we mustn't wait for another, or two
+//	threads could each wait for the other's.  So the run stops short 
+//	at a sector that is already in the cache, or when there is no 
+//	free entry; it is never more than half the cache, either.  Return 
+//	how many sectors were read -- none, if the first one turns out to
+//	be in the cache after all.
+//
+//	"sectorNumber" -- the first sector to read
+//	"numSectors" -- how many sectors the caller wants
+//	"data" -- the buffer to hold their contents
+//----------------------------------------------------------------------
+
+int
+SynchDisk::ReadRun(int sectorNumber, int numSectors, char *data)
+{
+    CacheEntry **run = new CacheEntry *[numSectors];
+    bool hit;
+    int n;
+
+    lock->Acquire();
+    run[0] = FindEntry(sectorNumber, &hit);
+    if (hit) {				// it got there before we did
+	lock->Release();
+	delete [] run;
+	return 0;
+    }
+    run[0]->busy = TRUE;
+    for (n = 1; n < min(numSectors, numEntries / 2); n++) {
+	if (index->IsInTable(sectorNumber + n) || !HaveFreeEntry()) {
+	    break;
+	}
+	run[n] = FindEntry(sectorNumber + n, &hit);  // won't have to wait
+	run[n]->busy = TRUE;
+    }
+    lock->Release();
+
+    DiskRead(sectorNumber, n, data);
+
+    lock->Acquire();
+    for (int i = 0; i < n; i++) {
+	bcopy(data + i * SectorSize, run[i]->data, SectorSize);
+	run[i]->busy = FALSE;
+    }
+    readDone->Broadcast(lock);
+    lock->Release();
+    delete [] run;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write the contents of a buffer into a run of disk sectors.  With
+//	the cache, this only changes the cached copies, and Flush writes
+//	them back together.
+//
+//	"sectorNumber" -- the first disk sector to write
+//	"numSectors" -- how many sectors to write
+//	"data" -- their new contents
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int numSectors, char *data)
+{
+    if ((numEntries == 0) && (journal == NULL)) {
+	DiskWrite(sectorNumber, numSectors, data);
+	return;
+    }
+    for (int i = 0; i < numSectors; i++) {	// any of them may be
+	WriteSector(sectorNumber + i, data + i * SectorSize);  // journaled
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteThrough
+// 	Write the contents of a buffer into a run of disk sectors, on
+//	the disk itself, and return only once they are there.  Copies
+//	in the cache are brought up to date, and no longer need writing
+//	back.  The caller makes sure that no one else is using these 
+//	sectors.
+//
+//	"sectorNumber" -- the first disk sector to write
+//	"numSectors" -- how many sectors to write
+//	"data" -- their new contents
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteThrough(int sectorNumber, int numSectors, char *data)
+{
+    CacheEntry *entry;
+
+    if (numEntries > 0) {
+	lock->Acquire();
+	for (int i = 0; i < numSectors; i++) {
+	    while (index->Find(sectorNumber + i, &entry) && entry->busy) {
+		readDone->Wait(lock);		// let the read finish first
+	    }
+	    if (index->Find(sectorNumber + i, &entry)) {
+		bcopy(data + i * SectorSize, entry->data, SectorSize);
+		if (entry->dirty) {
+		    entry->dirty = FALSE;
+		    numDirty--;
+		}
+	    }
+	}
+	lock->Release();
+    }
+    DiskWrite(sectorNumber, numSectors, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Arrange for a sector to be read into the cache by the read-ahead
+//	thread, unless it's there already.  Return straight away.
+//
+//	"sectorNumber" -- the disk sector that will probably be read soon
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAhead(int sectorNumber)
+{
+    if ((readAheadSectors == 0) || index->IsInTable(sectorNumber)) {
+	return;			// looking doesn't need the lock, since
+				// nothing else runs until we let it
+    }
+    lock->Acquire();
+    if (!index->IsInTable(sectorNumber) && 
+		!readAheadList->IsInList(sectorNumber)) {
+	readAheadList->Append(sectorNumber);
+	if (reader == NULL) {
+	    reader = new Thread("read-ahead");
+	    reader->Fork((VoidFunctionPtr) RunReadAheadDaemon, 0);
+	} else if (readerIdle) {
+	    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+	    readerIdle = FALSE;
+	    kernel->scheduler->ReadyToRun(reader);
+	    (void) kernel->interrupt->SetLevel(oldLevel);
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAheadDaemon
+// 	Read the sectors that ReadAhead asks for into the cache, forever;
+//	sleep whenever there are none to read, until ReadAhead wakes us
+//	up.  Sectors asked for one after another that are next to each
+//	other on the disk are read together (see ReadRun).  After each 
+//	read, let any thread that is waiting for the disk go first, since
+//	it needs its sector now.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAheadDaemon()
+{
+    char *buffer = new char[readAheadSectors * SectorSize];
+    int sector, numSectors;
+
+    for (;;) {
+	lock->Acquire();
+	while (readAheadList->IsEmpty()) {
+	    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+	    readerIdle = TRUE;
+	    lock->Release();
+	    kernel->currentThread->Sleep(FALSE);
+	    (void) kernel->interrupt->SetLevel(oldLevel);
+	    lock->Acquire();
+	}
+	sector = readAheadList->RemoveFront();
+	for (numSectors = 1; (numSectors < readAheadSectors) && 
+		!readAheadList->IsEmpty() &&
+		(readAheadList->Front() == sector + numSectors); 
+		numSectors++) {
+	    (void) readAheadList->RemoveFront();
+	}
+	lock->Release();
+	if (!index->IsInTable(sector)) {
+	    (void) ReadRun(sector, numSectors, buffer);
+	}
+	kernel->currentThread->Yield();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write every changed sector in the cache back to the disk, in
+//	sector order, with one request for each run of changed sectors
+//	on a track.  Return only after they have all been written.  
+//	Then, if the disk is mapped into memory, sync it with its file.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    if (numDirty == 0) {		// the usual case, at Halt
+	disk->Sync();
+	return;
+    }
+    lock->Acquire();
+    for (int i = 0; i < NumSectors && numDirty > 0; i++) {
+	if (IsDirty(i)) {
+	    CleanRun(i);
+	}
+    }
     lock->Release();
+    disk->Sync();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::IsDirty
+// 	Return whether a sector is in the cache, and has been changed
+//	since it was last written to the disk.  The caller must hold 
+//	"lock".
+//----------------------------------------------------------------------
+
+bool
+SynchDisk::IsDirty(int sectorNumber)
+{
+    CacheEntry *entry;
+
+    return index->Find(sectorNumber, &entry) && entry->dirty;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::CleanRun
+// 	Write a changed sector in the cache back to the disk, along with 
+//	the changed sectors on either side of it on the same track, in
+//	one request.  The caller must hold "lock", so no one else can 
+//	change them while they are being written.
+//
+//	"sectorNumber" -- a sector for which IsDirty is TRUE
+//----------------------------------------------------------------------
+
+void
+SynchDisk::CleanRun(int sectorNumber)
+{
+    int trackStart = sectorNumber - sectorNumber % SectorsPerTrack;
+    int first = sectorNumber, last = sectorNumber;
+    char *buffer;
+    CacheEntry *entry;
+
+    ASSERT(IsDirty(sectorNumber));
+    while ((first > trackStart) && IsDirty(first - 1)) {
+	first--;
+    }
+    while ((last < trackStart + SectorsPerTrack - 1) && IsDirty(last + 1)) {
+	last++;
+    }
+    buffer = new char[(last - first + 1) * SectorSize];
+    for (int i = first; i <= last; i++) {
+	(void) index->Find(i, &entry);
+	bcopy(entry->data, &buffer[(i - first) * SectorSize], SectorSize);
+	entry->dirty = FALSE;
+	numDirty--;
+    }
+    DiskWrite(first, last - first + 1, buffer);
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Invalidate
+// 	Write back every changed sector, then forget what is in the
+//	cache, so that every sector has to come from the disk again.
+//	For measuring how things perform with a cold cache.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Invalidate()
+{
+    Flush();
+    lock->Acquire();
+    for (int i = 0; i < numEntries; i++) {
+	while (entries[i].busy) {
+	    readDone->Wait(lock);
+	}
+	if (entries[i].sector != -1) {
+	    index->Remove(entries[i].sector);
+	    entries[i].sector = -1;
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FlushDaemon
+// 	Every CacheFlushInterval ticks, write back the changed sectors,
+//	so they don't sit in the cache indefinitely.  Once there are
+//	none left, the thread finishes; WriteSector starts another one
+//	when it needs to.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::FlushDaemon()
+{
+    lock->Acquire();
+    while (numDirty > 0) {
+	lock->Release();
+	kernel->alarm->WaitUntil(CacheFlushInterval);
+	Flush();
+	lock->Acquire();
+    }
+    flusher = NULL;			// we're about to finish
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::DiskRead, SynchDisk::DiskWrite
+// 	Read or write sectors on the disk itself, bypassing the cache,
+//	and wait for it to finish.
+//
+//	"sectorNumber" -- the first disk sector to read or write
+//	"numSectors" -- how many sectors
+//	"data" -- the buffer to read into, or write from
+//----------------------------------------------------------------------
+
+void
+SynchDisk::DiskRead(int sectorNumber, int numSectors, char *data)
+{
+    Request(sectorNumber, numSectors, data, FALSE);
+}
+
+void
+SynchDisk::DiskWrite(int sectorNumber, int numSectors, char *data)
+{
+    Request(sectorNumber, numSectors, data, TRUE);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Request
+// 	Read or write a run of sectors, one track's worth at a time,
+//	since that is as much as the disk can do at once.  Send each 
+//	request to the disk if it's free, or else queue it, and sleep 
+//	until the interrupt handler says it's done.
+//
+//	"sectorNumber" -- the first disk sector to read or write
+//	"numSectors" -- how many sectors
+//	"data" -- the buffer to read into, or write from
+//	"writing" -- TRUE to write, FALSE to read
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Request(int sectorNumber, int numSectors, char *data, 
+			bool writing)
+{
+    DiskRequest request;
+    IntStatus oldLevel;
+
+    while (numSectors > 0) {
+	request.sector = sectorNumber;
+	request.numSectors = min(numSectors, 
+			SectorsPerTrack - sectorNumber % SectorsPerTrack);
+	request.data = data;
+	request.writing = writing;
+	request.thread = kernel->currentThread;
+
+	oldLevel = kernel->interrupt->SetLevel(IntOff);
+	if (active == NULL) {
+	    StartRequest(&request);
+	} else {
+	    waiting->Append(&request);
+	}
+	kernel->currentThread->Sleep(FALSE);	// until CallBack
+	(void) kernel->interrupt->SetLevel(oldLevel);
+
+	sectorNumber += request.numSectors;
+	numSectors -= request.numSectors;
+	data += request.numSectors * SectorSize;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartRequest
+// 	Send a request to the disk, which must be free.  Interrupts are 
+//	disabled.
+//
+//	"request" -- the read or write to do
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartRequest(DiskRequest *request)
+{
+    ASSERT(active == NULL);
+    active = request;
+    headSector = request->sector + request->numSectors - 1;
+    if (request->writing) {
+	disk->WriteRequest(request->sector, request->numSectors, 
+				request->data);
+    } else {
+	disk->ReadRequest(request->sector, request->numSectors, 
+				request->data);
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::NextRequest
+// 	Choose the waiting request the disk should do next, according to
+//	the scheduling policy, and take it off the queue.  Among requests 
+//	that are equally good, the one that has waited longest goes 
+//	first.  Interrupts are disabled.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::NextRequest()
+{
+    ListIterator<DiskRequest *> iter(waiting);
+    DiskRequest *best = NULL, *lowest = NULL;
+    int bestTime = 0;
+
+    ASSERT(!waiting->IsEmpty());
+    switch (policy) {
+      case FCFSDiskScheduling:
+	return waiting->RemoveFront();
+
+      case SSTFDiskScheduling:
+	for (; !iter.IsDone(); iter.Next()) {
+	    DiskRequest *request = iter.Item();
+	    int time = disk->ComputeLatency(request->sector, request->writing);
+
+	    if ((best == NULL) || (time < bestTime)) {
+		best = request;
+		bestTime = time;
+	    }
+	}
+	break;
+
+      case ScanDiskScheduling:
+      case CLookDiskScheduling:
+	// the nearest request in the direction the head is moving,
+	// and the lowest one, in case there are none that way
+	for (; !iter.IsDone(); iter.Next()) {
+	    DiskRequest *request = iter.Item();
+	    bool ahead = (headUp || policy == CLookDiskScheduling) 
+				? (request->sector >= headSector)
+				: (request->sector <= headSector);
+
+	    if (ahead && ((best == NULL) || 
+		    (abs(request->sector - headSector) < 
+			abs(best->sector - headSector)))) {
+		best = request;
+	    }
+	    if ((lowest == NULL) || (request->sector < lowest->sector)) {
+		lowest = request;
+	    }
+	}
+	if (best == NULL) {
+	    if (policy == CLookDiskScheduling) {
+		best = lowest;		// back to the start
+	    } else {
+		headUp = !headUp;	// turn round
+		return NextRequest();
+	    }
+	}
+	break;
+    }
+    waiting->Remove(best);
+    return best;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FindEntry
+// 	Return the cache entry for a sector, making it the most recently
+//	used.  If the sector is being read, wait until it's there.
+//	If the sector isn't cached, take over the least recently used
+//	entry for it (other than one being read -- if they all are, wait
+//	for one), writing that entry back first if it has been changed,
+//	along with its neighbours (see CleanRun); the caller fills in the
+//	new entry's contents.  The caller must hold "lock".
+//
+//	"sectorNumber" -- the sector wanted
+//	"hit" -- set to TRUE if the sector was already in the cache
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::FindEntry(int sectorNumber, bool *hit)
+{
+    CacheEntry *entry;
+
+    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    for (;;) {
+	*hit = index->Find(sectorNumber, &entry);
+	if (*hit && !entry->busy) {
+	    break;
+	} else if (!*hit) {
+	    for (entry = oldest; entry != NULL; entry = entry->newer) {
+		if (!entry->busy) {
+		    break;
+		}
+	    }
+	    if (entry != NULL) {
+		break;
+	    }
+	}
+	readDone->Wait(lock);		// for the sector, or for any entry
+    }					// to be free
+    if (!*hit) {
+	if (entry->sector != -1) {
+	    if (entry->dirty) {
+		CleanRun(entry->sector);
+	    }
+	    index->Remove(entry->sector);
+	}
+	entry->sector = sectorNumber;
+	index->Insert(entry);
+    }
+    MakeNewest(entry);
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::HaveFreeEntry
+// 	Return whether FindEntry could take over an entry without
+//	waiting: whether any entry is not busy.  The caller must hold 
+//	"lock".
+//----------------------------------------------------------------------
+
+bool
+SynchDisk::HaveFreeEntry()
+{
+    for (CacheEntry *entry = oldest; entry != NULL; entry = entry->newer) {
+	if (!entry->busy) {
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::MakeNewest
+// 	Move a cache entry to the most recently used end of the list.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::MakeNewest(CacheEntry *entry)
+{
+    if (entry == newest) {
+	return;
+    }
+    entry->newer->older = entry->older;		// take it out...
+    if (entry->older != NULL) {
+	entry->older->newer = entry->newer;
+    } else {
+	oldest = entry->newer;
+    }
+    entry->older = newest;			// ...and put it at the front
+    entry->newer = NULL;
+    newest->newer = entry;
+    newest = entry;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Wake up the thread waiting for the disk
+//	request to finish, and start the next request, if any.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::CallBack()
 { 
-    semaphore->V();
+    ASSERT(active != NULL);
+    kernel->scheduler->ReadyToRun(active->thread);
+    active = NULL;
+    if (!waiting->IsEmpty()) {
+	StartRequest(NextRequest());
+    }
 }
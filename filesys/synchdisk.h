@@ -14,6 +14,68 @@
 #include "disk.h"
 #include "synch.h"
 #include "callback.h"
+#include "hash.h"
+
+class Thread;
+class Journal;
+
+const int DefaultCacheSectors = 64;	// sectors in the buffer cache,
+					// unless "-dc" says otherwise
+const int CacheFlushInterval = 1000000;	// ticks a changed sector can
+					// wait before it is written back
+const int DefaultReadAheadSectors = 4;	// sectors to read ahead of a
+					// sequential reader, unless "-ra" 
+					// says otherwise
+
+// How SynchDisk chooses which of the waiting requests to send to the
+// disk next, once the disk is free:
+//	FCFSDiskScheduling -- in the order they were made.
+//	SSTFDiskScheduling -- shortest seek time first: the one the 
+//		disk can get to soonest (see Disk::ComputeLatency).  Few
+//		ticks overall, but a request far from the others can wait
+//		a long time.
+//	ScanDiskScheduling -- the elevator: keep the head moving the 
+//		same way, serving requests as it reaches them, and turn
+//		round when there are none left ahead of it.  (Strictly,
+//		this is LOOK; going on to the edge of the disk would only
+//		waste time.)
+//	CLookDiskScheduling -- the same, but only upwards: after the 
+//		highest request, go back to the lowest one.  Waits are
+//		more even than with SCAN, which passes the middle of the
+//		disk twice as often as the edges.
+
+enum DiskSchedulingPolicy { FCFSDiskScheduling, SSTFDiskScheduling,
+			    ScanDiskScheduling, CLookDiskScheduling };
+
+extern bool ParseDiskSchedulingPolicy(char *name, 
+					DiskSchedulingPolicy *policy);
+					// Convert "fcfs", "sstf", "scan" or
+					// "clook" to a policy; return FALSE
+					// if the name is unknown
+
+// The following class defines a read or write waiting for the disk.
+// It lives on the stack of the thread that asked for it.
+
+class DiskRequest {
+  public:
+    int sector;			// the first sector to read or write
+    int numSectors;		// how many, all on one track
+    char *data;			// where to read it into, or write it from
+    bool writing;		// is it a write?
+    Thread *thread;		// the thread waiting for it to finish
+};
+
+// The following class defines one sector's worth of the buffer cache.
+
+class CacheEntry {
+  public:
+    int sector;			// the sector held here, or -1 if none
+    bool dirty;			// changed since it came from the disk?
+    bool busy;			// still being read from the disk?
+    CacheEntry *newer;		// the entries used just after and
+    CacheEntry *older;		// just before this one (LRU order)
+    char *data;			// the contents of the sector
+};
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -24,13 +86,31 @@
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
+// returning.  Requests that arrive while the disk is busy wait in a
+// queue, and the scheduling policy picks which one goes next.
+//
+// Recently used sectors are kept in a buffer cache, so that reading 
+// them again doesn't need the disk.  Writes only go as far as the
+// cache; a changed sector is written back when it is evicted, by
+// Flush, or at the latest CacheFlushInterval ticks later.
+//
+// ReadAhead asks for a sector to be brought into the cache in the
+// background, because it will probably be read soon.
+//
+// Once the file system has a journal, the sectors that an operation
+// writes go to the journal instead (see Journal::Log), and every read
+// sees the changes that are still there (see Journal::Overlay).
+// WriteThrough, for the journal's own log, goes straight to the disk.
 
 class SynchDisk : public CallBackObj {
   public:
-    SynchDisk();    		        // Initialize a synchronous disk,
-					// by initializing the raw Disk.
-    ~SynchDisk();			// De-allocate the synch disk data
+    SynchDisk(int cacheSectors, int readAheadSectors,
+		DiskSchedulingPolicy policy, bool mapDisk);
+					// Initialize a synchronous disk,
+					// by initializing the raw Disk; 
+					// cache up to "cacheSectors" sectors
+    ~SynchDisk();			// De-allocate the synch disk data;
+					// too late to write anything back
     
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
@@ -39,17 +119,88 @@ class SynchDisk : public CallBackObj {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+    void ReadSectors(int sectorNumber, int numSectors, char *data);
+    void WriteSectors(int sectorNumber, int numSectors, char *data);
+					// The same, for "numSectors" sectors
+					// in a row; sectors that aren't cached
+					// are read from the disk as a few
+					// large requests instead of many
+					// small ones
+    void WriteThrough(int sectorNumber, int numSectors, char *data);
+					// Write sectors to the disk now, and
+					// wait for them to get there
+    void SetJournal(Journal *j) { journal = j; }
+					// Send file system writes to "j"
+					// (NULL for none)
     
+    void ReadAhead(int sectorNumber);	// Start reading a sector into
+					// the cache; don't wait for it
+    int ReadAheadSectors() { return readAheadSectors; }
+					// How far ahead sequential readers
+					// should ask for sectors (0 if not
+					// at all)
+
+    void Flush();			// Write every changed sector in the
+					// cache back to the disk, and the
+					// disk back to its UNIX file
+    void Invalidate();			// Flush, then empty the cache
+    void FlushDaemon();			// Body of the thread that writes
+					// changed sectors back periodically
+    void ReadAheadDaemon();		// Body of the thread that reads
+					// sectors for ReadAhead
+
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskSchedulingPolicy policy;	// how to choose the next request
+    DiskRequest *active;		// the request the disk is working
+					// on, if any
+    List<DiskRequest *> *waiting;	// requests waiting for the disk;
+					// only changed with interrupts off
+    int headSector;			// where the last request left the
+					// disk head
+    bool headUp;			// is SCAN moving it to higher sectors?
+    Lock *lock;				// Protects the cache
+    Condition *readDone;		// Signalled when a busy sector has
+					// been read
+
+    int numEntries;			// size of the cache, in sectors
+    CacheEntry *entries;		// the cache itself
+    char *cacheData;			// the sectors it holds
+    HashTable<int, CacheEntry *> *index;	// the entries holding a 
+					// sector, by sector number
+    CacheEntry *newest, *oldest;	// ends of the LRU list
+    int numDirty;			// entries that need writing back
+    Thread *flusher;			// the FlushDaemon thread, if any
+    int readAheadSectors;		// see ReadAheadSectors
+    List<int> *readAheadList;		// sectors waiting to be read ahead
+    Thread *reader;			// the ReadAheadDaemon thread, once
+					// there has been a ReadAhead
+    bool readerIdle;			// is it asleep, waiting for more?
+    Journal *journal;			// see SetJournal
+
+    void DiskRead(int sectorNumber, int numSectors, char *data);
+    void DiskWrite(int sectorNumber, int numSectors, char *data);
+					// the uncached versions
+    void Request(int sectorNumber, int numSectors, char *data, 
+		bool writing);		// queue requests, a track at a 
+					// time, and wait for them
+    void StartRequest(DiskRequest *request);
+					// send a request to the disk
+    DiskRequest *NextRequest();		// take the request that should go
+					// next off the queue
+    CacheEntry *FindEntry(int sectorNumber, bool *hit);
+					// find or make room for a sector
+    bool HaveFreeEntry();		// could FindEntry make room at once?
+    int ReadRun(int sectorNumber, int numSectors, char *data);
+					// read uncached sectors into the cache
+    bool IsDirty(int sectorNumber);	// cached, and changed since read?
+    void CleanRun(int sectorNumber);	// write back changed sectors around
+					// this one
+    void MakeNewest(CacheEntry *entry);	// move to the front of the LRU list
 };
 
 #endif // SYNCHDISK_H
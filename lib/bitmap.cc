@@ -42,7 +42,7 @@ Bitmap::Bitmap(int numItems)
 
 Bitmap::~Bitmap()
 { 
-    delete map;
+    delete [] map;
 }
 
 //----------------------------------------------------------------------
@@ -110,34 +110,154 @@ Bitmap::Test(int which) const
 int 
 Bitmap::FindAndSet() 
 {
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
-	}
+    int which = NextBit(0, FALSE);
+
+    if (which == numBits) {
+	return -1;
     }
-    return -1;
+    Mark(which);
+    return which;
 }
 
 //----------------------------------------------------------------------
 // Bitmap::NumClear
 // 	Return the number of clear bits in the bitmap.
 //	(In other words, how many bits are unallocated?)
+//
+//	The unused bits at the end of the last word are never set, so 
+//	we can count the set bits a word at a time.
 //----------------------------------------------------------------------
 
 int 
 Bitmap::NumClear() const
 {
-    int count = 0;
+    int count = numBits;
 
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    count++;
-	}
+    for (int i = 0; i < numWords; i++) {
+	count -= __builtin_popcount(map[i]);
     }
     return count;
 }
 
+//----------------------------------------------------------------------
+// Bitmap::FindRun
+// 	Return the number of the first bit of a run of "n" clear bits.
+//	Runs that start at or after "hint" come first, then those before
+//	it; so successive searches with the hint just past the last run 
+//	found tend to find runs close together.
+//
+//	If there is no such run, return -1.
+//
+//	"n" is how many clear bits in a row are wanted.
+//	"hint" is where to start looking.
+//----------------------------------------------------------------------
+
+int 
+Bitmap::FindRun(int n, int hint) const
+{
+    int start;
+
+    ASSERT(n > 0 && hint >= 0);
+
+    start = SearchRun(n, hint, numBits);
+    if (start == -1) {
+	start = SearchRun(n, 0, hint);
+    }
+    return start;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindAndSetRun
+// 	Find a run of "n" clear bits, as FindRun does, and set them.
+//	Return the number of the first one, or -1 if there is no run 
+//	that long.
+//
+//	"n" is how many clear bits in a row are wanted.
+//	"hint" is where to start looking.
+//----------------------------------------------------------------------
+
+int 
+Bitmap::FindAndSetRun(int n, int hint)
+{
+    int start = FindRun(n, hint);
+
+    if (start != -1) {
+	for (int i = start; i < start + n; i++) {
+	    Mark(i);
+	}
+    }
+    return start;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::RunLength
+// 	Return the number of clear bits in a row, starting with the 
+//	"nth" (0 if it is set).
+//
+//	"which" is the number of the bit to start with.
+//----------------------------------------------------------------------
+
+int 
+Bitmap::RunLength(int which) const
+{
+    ASSERT(which >= 0 && which < numBits);
+
+    return NextBit(which, TRUE) - which;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::NextBit
+// 	Return the number of the first bit at or after "from" that is 
+//	set (or clear), or numBits if there isn't one.  Words with no
+//	such bit are skipped whole; in the word that has one, it is 
+//	found by counting trailing zeros.
+//
+//	"from" is where to start looking.
+//	"set" is TRUE to look for a set bit, FALSE for a clear one.
+//----------------------------------------------------------------------
+
+int 
+Bitmap::NextBit(int from, bool set) const
+{
+    int word = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits) {
+	return numBits;
+    }
+    bits = (set ? map[word] : ~map[word]) & (~0u << (from % BitsInWord));
+    while (bits == 0) {
+	if (++word == numWords) {
+	    return numBits;
+	}
+	bits = set ? map[word] : ~map[word];
+    }
+    return min(word * BitsInWord + __builtin_ctz(bits), numBits);
+}
+
+//----------------------------------------------------------------------
+// Bitmap::SearchRun
+// 	Return the number of the first bit of a run of "n" clear bits
+//	that starts at or after "from" and before "to" (though it may 
+//	end after "to"), or -1 if there isn't one.  Steps from the start 
+//	of each run of clear bits to its end, a word at a time.
+//----------------------------------------------------------------------
+
+int 
+Bitmap::SearchRun(int n, int from, int to) const
+{
+    int start, end;
+
+    for (start = NextBit(from, FALSE); start < to; 
+				start = NextBit(end, FALSE)) {
+	end = NextBit(start, TRUE);
+	if (end - start >= n) {
+	    return start;
+	}
+    }
+    return -1;
+}
+
 //----------------------------------------------------------------------
 // Bitmap::Print
 // 	Print the contents of the bitmap, for debugging.
@@ -177,8 +297,15 @@ Bitmap::SelfTest()
     ASSERT(Test(0) && Test(31));
 
     ASSERT(FindAndSet() == 1);
+    ASSERT(FindAndSetRun(4, 0) == 2);
+    ASSERT(FindRun(25, 0) == 6);	// just fits before bit 31
+    ASSERT(FindRun(1, 20) == 20);	// runs after the hint come first
+    ASSERT(RunLength(6) == 25 && RunLength(31) == 0);
     Clear(0);
     Clear(1);
+    for (i = 2; i < 6; i++) {
+	Clear(i);
+    }
     Clear(31);
 
     for (i = 0; i < numBits; i++) {
@@ -3,7 +3,9 @@
 //	can be either on or off.
 //
 //	Represented as an array of unsigned integers, on which we do
-//	modulo arithmetic to find the bit we are interested in.
+//	modulo arithmetic to find the bit we are interested in.  Searches
+//	look at a word at a time, skipping words that are all set (or all
+//	clear).
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -44,6 +46,16 @@ class Bitmap {
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
     int NumClear() const;	// Return the number of clear bits
+    int FindRun(int n, int hint) const;
+				// Return the # of the first bit of a run of
+				// "n" clear bits, starting the search at 
+				// "hint" and wrapping around.  If there is 
+				// no such run, return -1.
+    int FindAndSetRun(int n, int hint);
+				// Same, and as a side effect, set the bits
+    int RunLength(int which) const;
+				// Return the number of clear bits in a row
+				// starting with the "nth"
 
     void Print() const;		// Print contents of bitmap
     void SelfTest();		// Test whether bitmap is working
@@ -55,6 +67,15 @@ class Bitmap {
 				//  multiple of the number of bits in
 				//  a word)
     unsigned int *map;		// bit storage
+
+  private:
+    int NextBit(int from, bool set) const;
+				// Return the # of the first bit at or after
+				// "from" that is set (or clear); numBits if
+				// there isn't one
+    int SearchRun(int n, int from, int to) const;
+				// Look for a run of "n" clear bits starting
+				// between "from" and "to"
 };
 
 #endif // BITMAP_H
@@ -0,0 +1,218 @@
+// heap.cc
+//     	Routines to manage a priority queue of "things", kept as a
+//	binary heap in an array.  Heaps are implemented as templates
+//	so that we can store anything in them in a type-safe manner.
+//
+//	The array starts out small, and doubles in size whenever it
+//	fills up; it never shrinks.  So after the heap has reached its
+//	largest size, Insert and RemoveFront don't allocate any memory.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+const int InitialHeapSize = 16;		// initial size of the array
+
+//----------------------------------------------------------------------
+// Heap<T>::Heap
+//	Initialize a heap, empty to start with.
+//
+//	"comp" is the function used to order the items in the heap
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::Heap(int (*comp)(T x, T y))
+{
+    compare = comp;
+    maxInHeap = InitialHeapSize;
+    elements = new HeapElement<T>[maxInHeap];
+    numInHeap = 0;
+    nextSeq = 0;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::~Heap
+//	De-allocate the heap.  Note that this does NOT de-allocate any
+//	of the items in the heap; that's up to the caller.
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::~Heap()
+{
+    delete [] elements;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Less
+//	Return TRUE if "x" should come out of the heap before "y":
+//	either it is smaller, or they are equal and "x" was put in first.
+//----------------------------------------------------------------------
+
+template <class T>
+bool
+Heap<T>::Less(HeapElement<T> *x, HeapElement<T> *y) const
+{
+    int result = compare(x->item, y->item);
+
+    if (result != 0) {
+	return result < 0;
+    }
+    return (int) (x->seq - y->seq) < 0;	// OK even if nextSeq wraps
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Insert
+//	Put an item into the heap, and move it up towards the root until
+//	it is no smaller than its parent.
+//
+//	"item" is the thing to put into the heap
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::Insert(T item)
+{
+    HeapElement<T> element;
+    int i, parent;
+
+    if (numInHeap == maxInHeap) {	// out of room; double the array
+	HeapElement<T> *bigger = new HeapElement<T>[2 * maxInHeap];
+
+	for (i = 0; i < numInHeap; i++) {
+	    bigger[i] = elements[i];
+	}
+	delete [] elements;
+	elements = bigger;
+	maxInHeap *= 2;
+    }
+
+    element.item = item;
+    element.seq = nextSeq++;
+    for (i = numInHeap; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (!Less(&element, &elements[parent])) {
+	    break;
+	}
+	elements[i] = elements[parent];
+    }
+    elements[i] = element;
+    numInHeap++;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::RemoveFront
+//	Remove the smallest item from the heap, and return it.  The last
+//	element in the array takes its place, and is moved down until it
+//	is no larger than either of its children.
+//
+//	The heap must not be empty.
+//----------------------------------------------------------------------
+
+template <class T>
+T
+Heap<T>::RemoveFront()
+{
+    T front;
+    HeapElement<T> last;
+    int i, child;
+
+    ASSERT(!IsEmpty());
+    front = elements[0].item;
+    numInHeap--;
+    last = elements[numInHeap];
+    for (i = 0; (child = 2 * i + 1) < numInHeap; i = child) {
+	if ((child + 1 < numInHeap) &&
+			Less(&elements[child + 1], &elements[child])) {
+	    child++;			// pick the smaller child
+	}
+	if (!Less(&elements[child], &last)) {
+	    break;
+	}
+	elements[i] = elements[child];
+    }
+    elements[i] = last;
+    return front;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Apply
+//	Apply a function to each item in the heap, smallest first.
+//	Since the array isn't sorted, we do this by draining a copy of
+//	the heap; this is only meant for debugging output.
+//
+//	"func" is the procedure to apply.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::Apply(void (*func)(T)) const
+{
+    Heap<T> *copy = new Heap<T>(compare);
+
+    delete [] copy->elements;
+    copy->elements = new HeapElement<T>[maxInHeap];
+    copy->maxInHeap = maxInHeap;
+    for (int i = 0; i < numInHeap; i++) {
+	copy->elements[i] = elements[i];
+    }
+    copy->numInHeap = numInHeap;
+    while (!copy->IsEmpty()) {
+	(*func)(copy->RemoveFront());
+    }
+    delete copy;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SanityCheck
+//      Test whether this is still a legal heap.
+//
+//	Test: is every element no smaller than its parent?
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::SanityCheck() const
+{
+    ASSERT((numInHeap >= 0) && (numInHeap <= maxInHeap));
+    for (int i = 1; i < numInHeap; i++) {
+	ASSERT(!Less(&elements[i], &elements[(i - 1) / 2]));
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SelfTest
+//      Test whether this module is working.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::SelfTest(T *p, int numEntries)
+{
+    int i, j;
+    T prev, next;
+
+    ASSERT(IsEmpty());
+
+    // put everything in several times, to force the array to grow
+    for (j = 0; j < InitialHeapSize; j++) {
+	for (i = 0; i < numEntries; i++) {
+	    Insert(p[i]);
+	}
+	SanityCheck();
+    }
+    ASSERT(NumInList() == (unsigned) (numEntries * InitialHeapSize));
+
+    // should be able to get out everything we put in, in order
+    prev = RemoveFront();
+    for (i = 1; i < numEntries * InitialHeapSize; i++) {
+	next = RemoveFront();
+	ASSERT(compare(prev, next) <= 0);
+	prev = next;
+    }
+    ASSERT(IsEmpty());
+    SanityCheck();
+}
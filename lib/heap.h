@@ -0,0 +1,87 @@
+// heap.h
+//	Data structures to manage a priority queue, implemented as a
+//	binary heap stored in an array.
+//
+//	A Heap provides the same operations as a SortedList -- Insert,
+//	Front and RemoveFront -- but inserting and removing take
+//	O(log n) time rather than O(n), and no memory is allocated per
+//	item (the array only grows when it fills up).
+//
+//	Items that compare equal are removed in the order in which they
+//	were inserted, just as with a SortedList.
+//
+//	As with lists, allocation and deallocation of the items in the
+//	heap are to be done by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "copyright.h"
+#include "debug.h"
+
+// The following class defines a "heap element" -- an item, along
+// with the order in which it was inserted (used to break ties).
+//
+// This class is private to this module. Made public for notational
+// convenience.
+
+template <class T>
+class HeapElement {
+  public:
+    T item;			// item in the heap
+    unsigned int seq;		// when was the item inserted?
+};
+
+// The following class defines a heap.  As with a SortedList, all types
+// to be inserted into a heap must have a "Compare" function defined:
+//	   int Compare(T x, T y)
+//		returns -1 if x < y
+//		returns 0 if x == y
+//		returns 1 if x > y
+
+template <class T>
+class Heap {
+  public:
+    Heap(int (*comp)(T x, T y));	// initialize an empty heap
+    ~Heap();			// de-allocate the heap
+
+    void Insert(T item);	// put an item into the heap
+
+    T Front() { return elements[0].item; }
+    				// Return smallest item in the heap
+				// without removing it
+    T RemoveFront();		// Take smallest item out of the heap
+
+    unsigned int NumInList() { return numInHeap; }
+    				// how many items in the heap?
+    bool IsEmpty() { return numInHeap == 0; }
+    				// is the heap empty?
+
+    void Apply(void (*f)(T)) const;
+    				// apply function to all elements in
+				// the heap, smallest first
+
+    void SanityCheck() const;	// has this heap been corrupted?
+    void SelfTest(T *p, int numEntries);
+				// verify module is working
+
+  private:
+    int (*compare)(T x, T y);	// function for ordering heap elements
+    HeapElement<T> *elements;	// the heap: the children of element i
+				// are at 2i+1 and 2i+2
+    int numInHeap;		// number of elements in the heap
+    int maxInHeap;		// size of "elements"
+    unsigned int nextSeq;	// sequence number for the next Insert
+
+    bool Less(HeapElement<T> *x, HeapElement<T> *y) const;
+				// should x come out of the heap before y?
+};
+
+#include "heap.cc"		// templates are really like macros
+				// so needs to be included in every
+				// file that uses the template
+#endif // HEAP_H
@@ -0,0 +1,136 @@
+// histogram.cc
+//	Routines to count values in power-of-two sized ranges.
+//
+//	Range 0 holds only the value 0; range i (i > 0) holds the values
+//	from 2^(i-1) up to 2^i - 1.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "histogram.h"
+
+//----------------------------------------------------------------------
+// Histogram::Histogram
+// 	Initialize a histogram, with every count zero.
+//----------------------------------------------------------------------
+
+Histogram::Histogram()
+{
+    numValues = 0;
+    total = 0;
+    max = 0;
+    for (int i = 0; i < NumHistogramBuckets; i++) {
+	counts[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Histogram::Bucket
+// 	Return the range that "value" falls in: one more than the
+//	position of its highest bit that is set.
+//----------------------------------------------------------------------
+
+int
+Histogram::Bucket(int value)
+{
+    int bucket = 0;
+
+    while (value != 0) {
+	value >>= 1;
+	bucket++;
+    }
+    return bucket;
+}
+
+//----------------------------------------------------------------------
+// Histogram::Add
+// 	Count one more value.
+//
+//	"value" -- the value to count; must not be negative
+//----------------------------------------------------------------------
+
+void
+Histogram::Add(int value)
+{
+    ASSERT(value >= 0);
+    counts[Bucket(value)]++;
+    numValues++;
+    total += value;
+    if (value > max) {
+	max = value;
+    }
+}
+
+//----------------------------------------------------------------------
+// Histogram::Mean
+// 	Return the average of the values added so far, or 0 if there
+//	haven't been any.
+//----------------------------------------------------------------------
+
+double
+Histogram::Mean() const
+{
+    if (numValues == 0) {
+	return 0;
+    }
+    return total / numValues;
+}
+
+//----------------------------------------------------------------------
+// Histogram::Print
+// 	Print a summary line, then one line for each range from the
+//	lowest to the highest that has anything in it.
+//
+//	"title" -- what the values are, to start the summary line
+//----------------------------------------------------------------------
+
+void
+Histogram::Print(char *title) const
+{
+    int first, last;
+
+    printf("%s: count %d, mean %.1f, max %d\n", title, numValues, Mean(),
+		max);
+    if (numValues == 0) {
+	return;
+    }
+    for (first = 0; counts[first] == 0; first++) {
+	;
+    }
+    for (last = NumHistogramBuckets - 1; counts[last] == 0; last--) {
+	;
+    }
+    for (int i = first; i <= last; i++) {
+	if (i == 0) {
+	    printf("%24d: %d\n", 0, counts[i]);
+	} else {
+	    printf("%11u - %10u: %d\n", 1u << (i - 1), (1u << i) - 1,
+			counts[i]);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Histogram::SelfTest
+// 	Test whether this module is working.  The histogram must be
+//	empty to start with; it is left with some values in it.
+//----------------------------------------------------------------------
+
+void
+Histogram::SelfTest()
+{
+    ASSERT(numValues == 0);
+
+    Add(0);
+    Add(1);
+    Add(2);
+    Add(3);
+    Add(100);
+    ASSERT((counts[0] == 1) && (counts[1] == 1) && (counts[2] == 2));
+    ASSERT(counts[Bucket(64)] == 1 && Bucket(64) == Bucket(127));
+    ASSERT(Bucket(128) == Bucket(127) + 1);
+    ASSERT((numValues == 5) && (max == 100) && (Mean() == 106.0 / 5));
+}
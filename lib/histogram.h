@@ -0,0 +1,47 @@
+// histogram.h
+//	Data structures for a histogram -- a count of how many values
+//	fell into each of a number of ranges, for reporting how some
+//	quantity (such as how long threads wait to run) is distributed.
+//
+//	The ranges grow in powers of two: 0, 1, 2-3, 4-7, 8-15, ...
+//	so a histogram takes a fixed, small amount of space however
+//	many values are added, and however big they are.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "copyright.h"
+#include "utility.h"
+
+const int NumHistogramBuckets = 32;	// enough for any non-negative int
+
+// The following class defines a histogram of non-negative integers.
+
+class Histogram {
+  public:
+    Histogram();			// Initialize a histogram, with
+					// nothing in it
+
+    void Add(int value);		// Count one more value
+
+    int NumValues() const { return numValues; }
+    int Max() const { return max; }	// Largest value so far
+    double Mean() const;		// Average of the values so far
+
+    void Print(char *title) const;	// Print the counts in each range
+    void SelfTest();			// Test whether histogram is working
+
+  private:
+    int numValues;			// how many values have been added
+    double total;			// their sum (an int could overflow)
+    int max;				// the largest of them
+    int counts[NumHistogramBuckets];	// how many fell in each range
+
+    static int Bucket(int value);	// which range "value" falls in
+};
+
+#endif // HISTOGRAM_H
@@ -30,8 +30,10 @@
 #include "unistd.h"
 #include "sys/time.h"
 #include "sys/file.h"
+#include "sys/stat.h"
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/mman.h>
 
 #ifdef SOLARIS
 // KMS
@@ -131,6 +133,21 @@ Delay(int seconds)
     (void) sleep((unsigned) seconds);
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the UNIX wall clock time, in seconds.  Only the difference
+//	between two calls is meaningful; used to time benchmarks.
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timeval tv;
+
+    (void) gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // UDelay
 // 	Put the UNIX process running Nachos to sleep for x microseconds,
@@ -415,6 +432,65 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// FileNumber
+// 	Return a number that identifies an open file: the same for every
+//	open of the file, and different for every other file there is
+//	(at least, on the same file system).  Abort on error.
+//----------------------------------------------------------------------
+
+int
+FileNumber(int fd)
+{
+    struct stat status;
+    int retVal = fstat(fd, &status);
+
+    ASSERT(retVal >= 0);
+    return (int) status.st_ino;
+}
+
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "nBytes" of an open file into memory, for reading
+//	and writing, and return where.  Changes to the memory are changes
+//	to the file.  Abort on error.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int nBytes)
+{
+    void *addr = mmap(NULL, nBytes, PROT_READ | PROT_WRITE, MAP_SHARED, 
+			fd, 0);
+
+    ASSERT(addr != MAP_FAILED);
+    return (char *) addr;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Make sure the changes made to a mapped file have reached the
+//	file itself.  Abort on error.
+//----------------------------------------------------------------------
+
+void
+SyncMappedFile(char *addr, int nBytes)
+{
+    int retVal = msync(addr, nBytes, MS_SYNC);
+    ASSERT(retVal == 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Undo MapFile.  Abort on error.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *addr, int nBytes)
+{
+    int retVal = munmap(addr, nBytes);
+    ASSERT(retVal == 0);
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now, 
@@ -25,7 +25,11 @@
 
 const int MagicNumber = 0x456789ab;
 const int MagicSize = sizeof(int);
-const int DiskSize = (MagicSize + (NumSectors * SectorSize));
+#define DiskSize	(MagicSize + (NumSectors * SectorSize))
+
+int SectorSize = DefaultSectorSize;
+int SectorsPerTrack = DefaultSectorsPerTrack;
+int NumTracks = DefaultNumTracks;
 
 
 //----------------------------------------------------------------------
@@ -34,10 +38,18 @@ const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 //	if it doesn't exist), and check the magic number to make sure it's 
 // 	ok to treat it as Nachos disk storage.
 //
+//	If the file was made with another geometry, say so, since it
+//	will need to be formatted again; if it is too small, make it big
+//	enough.
+//
+//	Then, if asked, map the file into memory.  The magic number stays
+//	at the front, so the file is the same either way.
+//
 //	"toCall" -- object to call when disk read/write request completes
+//	"mapped" -- if TRUE, transfer data by copying to and from memory
 //----------------------------------------------------------------------
 
-Disk::Disk(CallBackObj *toCall)
+Disk::Disk(CallBackObj *toCall, bool mapped)
 {
     int magicNum;
     int tmp = 0;
@@ -52,6 +64,14 @@ Disk::Disk(CallBackObj *toCall)
     if (fileno >= 0) {		 	// file exists, check magic number 
 	Read(fileno, (char *) &magicNum, MagicSize);
 	ASSERT(magicNum == MagicNumber);
+	Lseek(fileno, 0, 2);
+	if (Tell(fileno) != DiskSize) {
+	    cerr << diskname << " was made with another disk geometry\n";
+	}
+	if (Tell(fileno) < DiskSize) {
+	    Lseek(fileno, DiskSize - sizeof(int), 0);
+	    WriteFile(fileno, (char *)&tmp, sizeof(int));
+	}
     } else {				// file doesn't exist, create it
         fileno = OpenForWrite(diskname);
 	magicNum = MagicNumber;  
@@ -61,6 +81,7 @@ Disk::Disk(CallBackObj *toCall)
         Lseek(fileno, DiskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
+    image = mapped ? MapFile(fileno, DiskSize) : NULL;
     active = FALSE;
 }
 
@@ -72,9 +93,27 @@ Disk::Disk(CallBackObj *toCall)
 
 Disk::~Disk()
 {
+    if (image != NULL) {
+	UnmapFile(image, DiskSize);
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Sync()
+// 	If the UNIX file is mapped into memory, make sure everything
+//	written to the disk so far is in the file.  Otherwise, it already
+//	is.
+//----------------------------------------------------------------------
+
+void
+Disk::Sync()
+{
+    if (image != NULL) {
+	SyncMappedFile(image, DiskSize);
+    }
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -97,56 +136,75 @@ PrintSector (bool writing, int sector, char *data)
 
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
-// 	Simulate a request to read/write a single disk sector
+// 	Simulate a request to read/write a run of disk sectors
 //	   Do the read/write immediately to the UNIX file
 //	   Set up an interrupt handler to be called later,
 //	      that will notify the caller when the simulator says
 //	      the operation has completed.
 //
 //	Note that a disk only allows an entire sector to be read/written,
-//	not part of a sector.
+//	not part of a sector.  The sectors must all be on one track.
 //
-//	"sectorNumber" -- the disk sector to read/write
+//	"sectorNumber" -- the first disk sector to read/write
+//	"numSectors" -- how many sectors, one track's worth at most
 //	"data" -- the bytes to be written, the buffer to hold the incoming bytes
 //----------------------------------------------------------------------
 
 void
-Disk::ReadRequest(int sectorNumber, char* data)
+Disk::ReadRequest(int sectorNumber, int numSectors, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    int ticks = ComputeLatency(sectorNumber, numSectors, FALSE);
+    int lastSector = sectorNumber + numSectors - 1;
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0) 
+		&& (lastSector < NumSectors));
+    ASSERT(sectorNumber / SectorsPerTrack == lastSector / SectorsPerTrack);
     
     //DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    if (image != NULL) {
+	bcopy(image + SectorSize * sectorNumber + MagicSize, data, 
+		numSectors * SectorSize);
+    } else {
+	Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+	Read(fileno, data, numSectors * SectorSize);
+    }
     if (debug->IsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(FALSE, sectorNumber + i, data + i * SectorSize);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
-    kernel->stats->numDiskReads++;
+    UpdateLast(lastSector);
+    kernel->stats->numDiskReads += numSectors;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteRequest(int sectorNumber, int numSectors, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int ticks = ComputeLatency(sectorNumber, numSectors, TRUE);
+    int lastSector = sectorNumber + numSectors - 1;
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0) 
+		&& (lastSector < NumSectors));
+    ASSERT(sectorNumber / SectorsPerTrack == lastSector / SectorsPerTrack);
     
     //DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    if (image != NULL) {
+	bcopy(data, image + SectorSize * sectorNumber + MagicSize, 
+		numSectors * SectorSize);
+    } else {
+	Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+	WriteFile(fileno, data, numSectors * SectorSize);
+    }
     if (debug->IsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(TRUE, sectorNumber + i, data + i * SectorSize);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
-    kernel->stats->numDiskWrites++;
+    UpdateLast(lastSector);
+    kernel->stats->numDiskWrites += numSectors;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
@@ -249,6 +307,45 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::ComputeLatency()
+// 	Return how long it will take to read/write a run of sectors on
+//	one track.  
+//
+//	The disk doesn't wait for the first sector of the run to come
+//	round: once the head is on the track, it transfers each sector
+//	as it passes under the head, in whatever order they come, so 
+//	the request is done when the last of them has gone by.  Reads of
+//	sectors already in the track buffer don't need to wait at all.
+//	Either way, each sector takes at least RotationTime to transfer.
+//	So a whole track takes one revolution, wherever the head is.
+//----------------------------------------------------------------------
+
+int
+Disk::ComputeLatency(int newSector, int numSectors, bool writing)
+{
+    int rotation;
+    int seek, timeAfter, last;
+
+    if (numSectors == 1) {
+	return ComputeLatency(newSector, writing);
+    }
+    seek = TimeToSeek(newSector, &rotation);
+    timeAfter = kernel->stats->totalTicks + seek + rotation;
+    last = numSectors;			// in sectors from timeAfter
+    for (int sector = newSector; sector < newSector + numSectors; sector++) {
+#ifndef NOTRACKBUF
+	if ((writing == FALSE) && (seek == 0) 
+		&& (((timeAfter - bufferInit) / RotationTime) 
+			> ModuloDiff(sector, bufferInit / RotationTime))) {
+	    continue;			// in the track buffer
+	}
+#endif
+	last = max(last, ModuloDiff(sector, timeAfter / RotationTime) + 1);
+    }
+    return seek + rotation + last * RotationTime;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
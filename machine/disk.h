@@ -28,12 +28,18 @@
 //
 // Addressing is by sector number -- each sector on the disk is given
 // a unique number: track * SectorsPerTrack + offset within a track.
+// A request can cover several sectors in a row, as long as they are
+// all on the same track; they are transferred one after another as
+// they pass under the head, with one interrupt at the end.
 //
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
 // and an interrupt is invoked later to signal that the operation completed.
 //
 // The physical disk is in fact simulated via operations on a UNIX file.
+// Optionally, the whole file is mapped into memory instead, so that
+// a transfer is just a copy, rather than two system calls; Sync makes
+// sure the changes have reached the file.
 //
 // To make life a little more realistic, the simulated time for
 // each operation reflects a "track buffer" -- RAM to store the contents
@@ -47,25 +53,41 @@
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
 
-const int SectorSize = 128;		// number of bytes per disk sector
-const int SectorsPerTrack  = 32;	// number of sectors per disk track 
-const int NumTracks = 32;		// number of tracks per disk
-const int NumSectors = (SectorsPerTrack * NumTracks);
+// The disk's geometry can be set on the command line (see main.cc),
+// before the disk is created.  A disk made with one geometry has to
+// be formatted again ("-f") to be used with another.
+
+extern int SectorSize;			// number of bytes per disk sector
+extern int SectorsPerTrack;		// number of sectors per disk track 
+extern int NumTracks;			// number of tracks per disk
+#define NumSectors	(SectorsPerTrack * NumTracks)
 					// total # of sectors per disk
 
+const int DefaultSectorSize = 128;
+const int DefaultSectorsPerTrack = 32;
+const int DefaultNumTracks = 32;
+
 class Disk : public CallBackObj {
   public:
-    Disk(CallBackObj *toCall);          // Create a simulated disk.  
+    Disk(CallBackObj *toCall, bool mapped);
+					// Create a simulated disk.  
 					// Invoke toCall->CallBack() 
 					// when each request completes.
+					// If "mapped", map the UNIX file
+					// into memory.
     ~Disk();				// Deallocate the disk.
     
-    void ReadRequest(int sectorNumber, char* data);
-    					// Read/write an single disk sector.
+    void ReadRequest(int sectorNumber, int numSectors, char* data);
+    					// Read/write "numSectors" disk
+					// sectors, on one track, starting
+					// at "sectorNumber".
 					// These routines send a request to 
     					// the disk and return immediately.
     					// Only one request allowed at a time!
-    void WriteRequest(int sectorNumber, char* data);
+    void WriteRequest(int sectorNumber, int numSectors, char* data);
+
+    void Sync();			// Write a mapped disk's changes back
+					// to the UNIX file
 
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
@@ -74,10 +96,15 @@ class Disk : public CallBackObj {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int ComputeLatency(int newSector, int numSectors, bool writing);
+					// The same, for "numSectors" sectors
+					// starting at newSector
 
   private:
     int fileno;				// UNIX file number for simulated disk 
     char diskname[32];			// name of simulated disk's file
+    char *image;			// the file mapped into memory, if
+					// it is (else NULL)
     CallBackObj *callWhenDone;		// Invoke when any disk request finishes
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
@@ -47,6 +47,7 @@ PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt,
     callOnInterrupt = callOnInt;
     when = time;
     type = kind;
+    nextFree = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -72,7 +73,9 @@ PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    pending = new Heap<PendingInterrupt *>(PendingCompare);
+    freeList = NULL;
+    nextDue = NeverDue;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -85,10 +88,17 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
+    PendingInterrupt *next;
+
     while (!pending->IsEmpty()) {
 	delete pending->RemoveFront();
     }
     delete pending;
+    while (freeList != NULL) {
+	next = freeList->nextFree;
+	delete freeList;
+	freeList = next;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -228,13 +238,13 @@ Interrupt::Idle()
 
 //----------------------------------------------------------------------
 // Interrupt::Halt
-// 	Shut down Nachos cleanly, printing out performance statistics.
+// 	Shut down Nachos cleanly.  The kernel prints out performance
+//	statistics as it goes (see Kernel::~Kernel).
 //----------------------------------------------------------------------
 void
 Interrupt::Halt()
 {
     cout << "Machine halting!\n\n";
-    kernel->stats->Print();
     delete kernel;	// Never returns.
 }
 
@@ -243,7 +253,9 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it in a heap ordered by time.  To avoid 
+//	a memory allocation for every interrupt, PendingInterrupts are 
+//	recycled through a free list once they have fired.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -257,12 +269,25 @@ void
 Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
 {
     int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    PendingInterrupt *toOccur;
+
+    if (freeList != NULL) {
+	toOccur = freeList;
+	freeList = toOccur->nextFree;
+	toOccur->callOnInterrupt = toCall;
+	toOccur->when = when;
+	toOccur->type = type;
+    } else {
+	toOccur = new PendingInterrupt(toCall, when, type);
+    }
 
     //DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
     pending->Insert(toOccur);
+    if (when < nextDue) {
+	nextDue = when;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -288,6 +313,9 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (debug->IsEnabled(dbgInt)) {
 	DumpState();
     }
+    if ((nextDue > stats->totalTicks) && !advanceClock) {
+	return FALSE;			// the usual case: nothing due yet
+    }
     if (pending->IsEmpty()) {   	// no pending interrupts
 	return FALSE;	
     }		
@@ -314,10 +342,12 @@ Interrupt::CheckIfDue(bool advanceClock)
     do {
         next = pending->RemoveFront();    // pull interrupt off list
         next->callOnInterrupt->CallBack();// call the interrupt handler
-	delete next;
+	next->nextFree = freeList;	  // and save it for re-use
+	freeList = next;
     } while (!pending->IsEmpty() 
     		&& (pending->Front()->when <= stats->totalTicks));
     inHandler = FALSE;
+    nextDue = pending->IsEmpty() ? NeverDue : pending->Front()->when;
     return TRUE;
 }
 
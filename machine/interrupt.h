@@ -35,6 +35,7 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "heap.h"
 #include "callback.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
@@ -51,6 +52,9 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 			NetworkSendInt, NetworkRecvInt};
 
+// The time returned by Interrupt::NextDue when nothing is pending.
+const int NeverDue = 0x7fffffff;
+
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
@@ -66,6 +70,8 @@ class PendingInterrupt {
     
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    PendingInterrupt *nextFree;	// next unused PendingInterrupt, when
+				// this one is on Interrupt's free list
 };
 
 // The following class defines the data structures for the simulation
@@ -96,6 +102,8 @@ class Interrupt {
     
     void YieldOnReturn();	// cause a context switch on return 
 				// from an interrupt handler
+    bool InHandler() { return inHandler; }
+				// is an interrupt handler running?
 
     MachineStatus getStatus() { return status; } 
     void setStatus(MachineStatus st) { status = st; }
@@ -116,11 +124,20 @@ class Interrupt {
     
     void OneTick();       	// Advance simulated time
 
+    int NextDue() { return nextDue; }
+				// When is the next interrupt scheduled?
+				// (NeverDue if nothing is pending)
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;		
-    				// the list of interrupts scheduled
-				// to occur in the future
+    Heap<PendingInterrupt *> *pending;		
+    				// the interrupts scheduled to occur
+				// in the future, earliest first
+    PendingInterrupt *freeList;	// PendingInterrupts that have fired,
+				// kept for re-use by Schedule
+    int nextDue;		// when the first interrupt in "pending"
+				// is to occur -- kept so that we don't
+				// have to look at the list on every tick
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
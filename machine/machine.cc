@@ -11,6 +11,11 @@
 #include "machine.h"
 #include "main.h"
 
+int PageSize = DefaultPageSize;
+int PageShift;
+int NumPhysPages = DefaultNumPhysPages;
+int TLBSize = DefaultTLBSize;
+
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
 static char* exceptionNames[] = { "no exception", "syscall", 
@@ -50,17 +55,27 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"threaded" -- if TRUE, execute user instructions with the 
+//		threaded-code engine (see Machine::RunThreaded)
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, bool threaded)
 {
     int i;
 
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
+    for (PageShift = 0; (1 << PageShift) < PageSize; PageShift++)
+	;
+    ASSERT((1 << PageShift) == PageSize);
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
+    decodedPages = new Instruction[MemorySize / 4];
+    decodedValid = new bool[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+	decodedValid[i] = FALSE;
+    FlushFastTlb();
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLBSize];
     for (i = 0; i < TLBSize; i++)
@@ -71,7 +86,9 @@ Machine::Machine(bool debug)
     pageTable = NULL;
 #endif
 
+    asid = 0;
     singleStep = debug;
+    threadedCode = threaded;
     CheckEndian();
 }
 
@@ -83,6 +100,8 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
+    delete [] decodedPages;
+    delete [] decodedValid;
     if (tlb != NULL)
         delete [] tlb;
 }
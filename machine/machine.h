@@ -26,20 +26,27 @@
 #include "translate.h"
 #include "synch.h"
 
-// Definitions related to the size, and format of user memory
-
-const int PageSize = 128; 		// set the page size equal to
-					// the disk sector size, for simplicity
-
-//
-// You are allowed to change this value.
-// Doing so will change the number of pages of physical memory
-// available on the simulated machine.
+// Definitions related to the size, and format of user memory.
 //
-const int NumPhysPages = 128;
-
-const int MemorySize = (NumPhysPages * PageSize);
-const int TLBSize = 4;			// if there is a TLB, make it small
+// These can be set on the command line (see main.cc), before the 
+// machine is created; they don't change after that.  Doing so changes
+// how much physical memory is available on the simulated machine.
+
+extern int PageSize;			// bytes per page; by default the
+					// disk sector size, for simplicity.
+					// Must be a power of 2
+extern int PageShift;			// log2(PageSize), so that the
+					// simulator can shift rather than
+					// divide; set by Machine::Machine
+extern int NumPhysPages;		// pages of physical memory
+#define MemorySize	(NumPhysPages * PageSize)
+extern int TLBSize;			// if there is a TLB, make it small
+
+const int DefaultPageSize = 128;
+const int DefaultNumPhysPages = 128;
+const int DefaultTLBSize = 4;
+const int FastTlbSize = 64;		// entries in each of the simulator's
+					// "fast TLBs"; must be a power of 2
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -76,6 +83,41 @@ enum ExceptionType { NoException,           // Everything ok!
 
 #define NumTotalRegs 	40
 
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+
+class Instruction {
+  public:
+    void Decode();	// decode the binary representation of the instruction
+
+    unsigned int value; // binary representation of the instruction
+
+    unsigned char opCode; // Type of instruction.  This is NOT the same as the
+    		          // opcode field from the instruction: see defs in
+                          // mips.h
+    unsigned char rs, rt, rd; // Three registers from instruction.
+    int extra;                // Immediate or target or shamt field or offset.
+                              // Immediates are sign-extended.
+};
+
+// The following class defines an entry in a "fast TLB": a cache, private
+// to the simulator, of translations that ReadMem and WriteMem have
+// already checked.  Unlike the TLB above, it isn't part of the simulated
+// hardware -- user programs can't tell it's there, and the kernel only
+// has to tell the machine (by calling FlushFastTlb) when it changes 
+// a translation.
+
+class FastTlbEntry {
+  public:
+    int virtualPage;	// the page number in virtual memory, or -1
+    int physicalPage;	// the page frame it maps to
+    char *hostPage;	// &mainMemory[physicalPage * PageSize]
+};
+
 // The following class defines the simulated host workstation hardware, as 
 // seen by user programs -- the CPU registers, main memory, etc.
 // User programs shouldn't be able to tell that they are running on our 
@@ -89,12 +131,12 @@ enum ExceptionType { NoException,           // Everything ok!
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
-class Instruction;
 class Interrupt;
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
+    Machine(bool debug, bool threaded);
+				// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
@@ -132,9 +174,15 @@ class Machine {
 // space, stored in memory), there is only one TLB (implemented in hardware).
 // Thus the TLB pointer should be considered as *read-only*, although 
 // the contents of the TLB are free to be modified by the kernel software.
+//
+// Each TLB entry is tagged with an address space ID, so the kernel 
+// need not empty the TLB when it switches address spaces; it just sets
+// "asid" to say which entries to use.
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int asid;				// the address space running; only 
+					// TLB entries tagged with it are used
 
     TranslationEntry *pageTable;
 
@@ -145,16 +193,32 @@ class Machine {
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+
+    void FlushFastTlb();	// Forget every translation cached by 
+				// ReadMem and WriteMem.  The kernel must
+				// call this whenever it switches page 
+				// tables, or changes an entry in the page
+				// table or TLB that might be in use.
+
+    void InvalidateDecodedPage(int frame);
+				// Discard the decoded instructions cached
+				// for a physical page frame.  The kernel 
+				// must call this after storing into 
+				// mainMemory directly (i.e., not through
+				// WriteMem).
   private:
 
 // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
-    
+    void OneInstruction(); 	// Run one instruction of a user program.
+
+    void RunThreaded();		// Run a user program using the faster,
+				// threaded-code engine
 
+    void DecodePage(int frame);	// Decode every word in a physical page
+				// frame into "decodedPages"
 
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
@@ -175,6 +239,19 @@ class Machine {
 
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
+    Instruction *decodedPages;	// decoded copy of each word of mainMemory,
+				// filled in a page frame at a time
+    bool *decodedValid;		// is the decoded copy of a frame current?
+
+    FastTlbEntry readTlb[FastTlbSize];
+				// translations usable by ReadMem, indexed 
+				// by virtual page # (mod FastTlbSize)
+    FastTlbEntry writeTlb[FastTlbSize];
+				// translations usable by WriteMem; a page
+				// is only put here once it is known to be
+				// writable, and its dirty bit is set
+
+    bool threadedCode;		// use RunThreaded rather than OneInstruction
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
@@ -24,27 +24,6 @@
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-  public:
-    void Decode();	// decode the binary representation of the instruction
-
-    unsigned int value; // binary representation of the instruction
-
-    unsigned char opCode; // Type of instruction.  This is NOT the same as the
-    		          // opcode field from the instruction: see defs in
-                          // mips.h
-    unsigned char rs, rt, rd; // Three registers from instruction.
-    int extra;                // Immediate or target or shamt field or offset.
-                              // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -52,23 +31,45 @@ class Instruction {
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	If the threaded-code engine was asked for, we use it instead of
+//	the loop below, unless we're single-stepping or tracing every
+//	instruction or clock tick.
+//
+//	Interrupt::OneTick is only called when the next interrupt is due;
+//	until then, advancing the simulated clock is all it would do.
+//	(When tracing interrupts with -d i, or single stepping, we call it
+//	every time, so that the output is the same as it always was.)
 //----------------------------------------------------------------------
 
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
+    Statistics *stats = kernel->stats;
+    Interrupt *interrupt = kernel->interrupt;
+    bool everyTick;		// must we call OneTick after every
+				// instruction (to trace or debug)?
 
     if (debug->IsEnabled('m')) {
         cout << "Starting program in thread: " << kernel->currentThread->getName();
 	cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
+    if (threadedCode && !singleStep && !debug->IsEnabled('m')
+		&& !debug->IsEnabled(dbgInt)) {
+	RunThreaded();		// never returns
+    }
+    everyTick = singleStep || debug->IsEnabled(dbgInt);
     for (;;) {
-        OneInstruction(instr);
-	kernel->interrupt->OneTick();
-	if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
-	  Debugger();
+        OneInstruction();
+	if (!everyTick && (stats->totalTicks + UserTick < interrupt->NextDue())) {
+	    stats->totalTicks += UserTick;	// no interrupt can be due, so
+	    stats->userTicks += UserTick;	// OneTick would only do this
+	} else {
+	    interrupt->OneTick();
+	    if (singleStep && (runUntilTime <= stats->totalTicks))
+	      Debugger();
+	}
     }
 }
 
@@ -116,25 +117,37 @@ TypeToReg(RegType reg, Instruction *instr)
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	The one exception is the decoded form of each instruction, which
+//	is kept per physical page frame (not per thread or address space),
+//	so it stays correct across context switches.  A frame is decoded
+//	the first time we fetch from it, and is thrown away whenever the
+//	frame is written (see WriteMem and InvalidateDecodedPage).
 //----------------------------------------------------------------------
 
 void
-Machine::OneInstruction(Instruction *instr)
+Machine::OneInstruction()
 {
 #ifdef SIM_FIX
     int byte;       // described in Kane for LWL,LWR,...
 #endif
 
-    int raw;
+    Instruction *instr;
+    ExceptionType exception;
+    int physAddr;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
-    // Fetch instruction 
-    if (!ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
+    // Fetch instruction, decoding its page if we haven't already
+    exception = Translate(registers[PCReg], &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	return;
+    }
+    if (!decodedValid[physAddr >> PageShift])
+	DecodePage(physAddr >> PageShift);
+    instr = &decodedPages[physAddr / 4];
 
     if (debug->IsEnabled('m')) {
         struct OpString *str = &opStrings[instr->opCode];
@@ -718,6 +731,446 @@ Machine::DelayedLoad(int nextReg, int nextValue)
     registers[0] = 0; 	// and always make sure R0 stays zero.
 }
 
+//----------------------------------------------------------------------
+// Machine::RunThreaded
+// 	Alternate execution engine for user programs, selected with -tc
+//	(see Run).  Produces exactly the same results as OneInstruction,
+//	including the simulated time charged to each instruction, but
+//	avoids most of the per-instruction overhead.
+//
+//	Instructions are executed straight out of the decoded copy of
+//	their page frame, using computed gotos (a gcc extension) to jump
+//	from the handler for one instruction directly to the handler for
+//	the next.  We only go back through the full fetch path (Translate)
+//	when control leaves the current virtual page, and we only call
+//	Interrupt::OneTick when an interrupt is actually due, or when
+//	the kernel was entered on an exception.  Otherwise, advancing the
+//	clock is just a couple of additions.
+//
+//	Anything the kernel does (exceptions, interrupt handlers, context
+//	switches) can change the page table, memory, or the thread we are
+//	running, so after any of those we re-start from the fetch path
+//	rather than trust anything we've cached in local variables.
+//
+//	Rarely executed instructions (partial-word loads and stores,
+//	syscalls, illegal instructions) are just handed to OneInstruction.
+//----------------------------------------------------------------------
+
+void
+Machine::RunThreaded()
+{
+    static void *dispatch[MaxOpcode + 1];	// handler for each opcode
+    Statistics *stats = kernel->stats;
+    Interrupt *interrupt = kernel->interrupt;
+    Instruction *instr;
+    Instruction *page;		// decoded copy of the current page
+    ExceptionType exception;
+    int physAddr, frame, offset, pageVAddr;
+    int pcAfter, nextLoadReg, nextLoadValue;
+    int sum, diff, tmp, value;
+    unsigned int rs, rt, imm;
+
+    if (dispatch[0] == NULL) {
+	for (int i = 0; i <= MaxOpcode; i++)
+	    dispatch[i] = &&other;
+	dispatch[OP_ADD] = &&add;	dispatch[OP_ADDI] = &&addi;
+	dispatch[OP_ADDIU] = &&addiu;	dispatch[OP_ADDU] = &&addu;
+	dispatch[OP_AND] = &&and_;	dispatch[OP_ANDI] = &&andi;
+	dispatch[OP_BEQ] = &&beq;	dispatch[OP_BGEZ] = &&bgez;
+	dispatch[OP_BGEZAL] = &&bgezal;	dispatch[OP_BGTZ] = &&bgtz;
+	dispatch[OP_BLEZ] = &&blez;	dispatch[OP_BLTZ] = &&bltz;
+	dispatch[OP_BLTZAL] = &&bltzal;	dispatch[OP_BNE] = &&bne;
+	dispatch[OP_DIV] = &&div;	dispatch[OP_DIVU] = &&divu;
+	dispatch[OP_J] = &&j;		dispatch[OP_JAL] = &&jal;
+	dispatch[OP_JALR] = &&jalr;	dispatch[OP_JR] = &&jr;
+	dispatch[OP_LB] = &&lb;		dispatch[OP_LBU] = &&lb;
+	dispatch[OP_LH] = &&lh;		dispatch[OP_LHU] = &&lh;
+	dispatch[OP_LUI] = &&lui;	dispatch[OP_LW] = &&lw;
+	dispatch[OP_MFHI] = &&mfhi;	dispatch[OP_MFLO] = &&mflo;
+	dispatch[OP_MTHI] = &&mthi;	dispatch[OP_MTLO] = &&mtlo;
+	dispatch[OP_MULT] = &&mult;	dispatch[OP_MULTU] = &&multu;
+	dispatch[OP_NOR] = &&nor;	dispatch[OP_OR] = &&or_;
+	dispatch[OP_ORI] = &&ori;	dispatch[OP_SB] = &&sb;
+	dispatch[OP_SH] = &&sh;		dispatch[OP_SLL] = &&sll;
+	dispatch[OP_SLLV] = &&sllv;	dispatch[OP_SLT] = &&slt;
+	dispatch[OP_SLTI] = &&slti;	dispatch[OP_SLTIU] = &&sltiu;
+	dispatch[OP_SLTU] = &&sltu;	dispatch[OP_SRA] = &&sra;
+	dispatch[OP_SRAV] = &&srav;	dispatch[OP_SRL] = &&srl;
+	dispatch[OP_SRLV] = &&srlv;	dispatch[OP_SUB] = &&sub;
+	dispatch[OP_SUBU] = &&subu;	dispatch[OP_SW] = &&sw;
+	dispatch[OP_XOR] = &&xor_;	dispatch[OP_XORI] = &&xori;
+    }
+
+  fetch:			// (re)start at the PC, with a full translation
+    exception = Translate(registers[PCReg], &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	goto trapped;
+    }
+    frame = physAddr >> PageShift;
+    if (!decodedValid[frame])
+	DecodePage(frame);
+    page = &decodedPages[frame * (PageSize / 4)];
+    pageVAddr = registers[PCReg] - (physAddr & (PageSize - 1));
+    instr = &decodedPages[physAddr / 4];
+
+  execute:			// run the instruction at "instr"
+    pcAfter = registers[NextPCReg] + 4;
+    nextLoadReg = 0;
+    nextLoadValue = 0;
+    goto *dispatch[instr->opCode];
+
+  add:
+    sum = registers[instr->rs] + registers[instr->rt];
+    if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+	((registers[instr->rs] ^ sum) & SIGN_BIT)) {
+	RaiseException(OverflowException, 0);
+	goto trapped;
+    }
+    registers[instr->rd] = sum;
+    goto retire;
+
+  addi:
+    sum = registers[instr->rs] + instr->extra;
+    if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+	((instr->extra ^ sum) & SIGN_BIT)) {
+	RaiseException(OverflowException, 0);
+	goto trapped;
+    }
+    registers[instr->rt] = sum;
+    goto retire;
+
+  addiu:
+    registers[instr->rt] = registers[instr->rs] + instr->extra;
+    goto retire;
+
+  addu:
+    registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
+    goto retire;
+
+  and_:
+    registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
+    goto retire;
+
+  andi:
+    registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xffff);
+    goto retire;
+
+  beq:
+    if (registers[instr->rs] == registers[instr->rt])
+	pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    goto retire;
+
+  bgezal:
+    registers[R31] = registers[NextPCReg] + 4;
+  bgez:
+    if (!(registers[instr->rs] & SIGN_BIT))
+	pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    goto retire;
+
+  bgtz:
+    if (registers[instr->rs] > 0)
+	pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    goto retire;
+
+  blez:
+    if (registers[instr->rs] <= 0)
+	pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    goto retire;
+
+  bltzal:
+    registers[R31] = registers[NextPCReg] + 4;
+  bltz:
+    if (registers[instr->rs] & SIGN_BIT)
+	pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    goto retire;
+
+  bne:
+    if (registers[instr->rs] != registers[instr->rt])
+	pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    goto retire;
+
+  div:
+    if (registers[instr->rt] == 0) {
+	registers[LoReg] = 0;
+	registers[HiReg] = 0;
+    } else {
+	registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
+	registers[HiReg] = registers[instr->rs] % registers[instr->rt];
+    }
+    goto retire;
+
+  divu:
+    rs = (unsigned int) registers[instr->rs];
+    rt = (unsigned int) registers[instr->rt];
+    if (rt == 0) {
+	registers[LoReg] = 0;
+	registers[HiReg] = 0;
+    } else {
+	tmp = rs / rt;
+	registers[LoReg] = (int) tmp;
+	tmp = rs % rt;
+	registers[HiReg] = (int) tmp;
+    }
+    goto retire;
+
+  jal:
+    registers[R31] = registers[NextPCReg] + 4;
+  j:
+    pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+    goto retire;
+
+  jalr:
+    registers[instr->rd] = registers[NextPCReg] + 4;
+  jr:
+    pcAfter = registers[instr->rs];
+    goto retire;
+
+  lb:				// LB and LBU
+    if (!ReadMem(registers[instr->rs] + instr->extra, 1, &value))
+	goto trapped;
+    if ((value & 0x80) && (instr->opCode == OP_LB))
+	value |= 0xffffff00;
+    else
+	value &= 0xff;
+    nextLoadReg = instr->rt;
+    nextLoadValue = value;
+    goto retire;
+
+  lh:				// LH and LHU
+    tmp = registers[instr->rs] + instr->extra;
+    if (tmp & 0x1) {
+	RaiseException(AddressErrorException, tmp);
+	goto trapped;
+    }
+    if (!ReadMem(tmp, 2, &value))
+	goto trapped;
+    if ((value & 0x8000) && (instr->opCode == OP_LH))
+	value |= 0xffff0000;
+    else
+	value &= 0xffff;
+    nextLoadReg = instr->rt;
+    nextLoadValue = value;
+    goto retire;
+
+  lui:
+    registers[instr->rt] = instr->extra << 16;
+    goto retire;
+
+  lw:
+    tmp = registers[instr->rs] + instr->extra;
+    if (tmp & 0x3) {
+	RaiseException(AddressErrorException, tmp);
+	goto trapped;
+    }
+    if (!ReadMem(tmp, 4, &value))
+	goto trapped;
+    nextLoadReg = instr->rt;
+    nextLoadValue = value;
+    goto retire;
+
+  mfhi:
+    registers[instr->rd] = registers[HiReg];
+    goto retire;
+
+  mflo:
+    registers[instr->rd] = registers[LoReg];
+    goto retire;
+
+  mthi:
+    registers[HiReg] = registers[instr->rs];
+    goto retire;
+
+  mtlo:
+    registers[LoReg] = registers[instr->rs];
+    goto retire;
+
+  mult:
+    Mult(registers[instr->rs], registers[instr->rt], TRUE,
+	 &registers[HiReg], &registers[LoReg]);
+    goto retire;
+
+  multu:
+    Mult(registers[instr->rs], registers[instr->rt], FALSE,
+	 &registers[HiReg], &registers[LoReg]);
+    goto retire;
+
+  nor:
+    registers[instr->rd] = ~(registers[instr->rs] | registers[instr->rt]);
+    goto retire;
+
+  or_:
+    registers[instr->rd] = registers[instr->rs] | registers[instr->rt];
+    goto retire;
+
+  ori:
+    registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xffff);
+    goto retire;
+
+  sb:
+    if (!WriteMem((unsigned) 
+	    (registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
+	goto trapped;
+    goto retire;
+
+  sh:
+    if (!WriteMem((unsigned) 
+	    (registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
+	goto trapped;
+    goto retire;
+
+  sll:
+    registers[instr->rd] = registers[instr->rt] << instr->extra;
+    goto retire;
+
+  sllv:
+    registers[instr->rd] = registers[instr->rt] <<
+	(registers[instr->rs] & 0x1f);
+    goto retire;
+
+  slt:
+    registers[instr->rd] = (registers[instr->rs] < registers[instr->rt]);
+    goto retire;
+
+  slti:
+    registers[instr->rt] = (registers[instr->rs] < instr->extra);
+    goto retire;
+
+  sltiu:
+    rs = registers[instr->rs];
+    imm = instr->extra;
+    registers[instr->rt] = (rs < imm);
+    goto retire;
+
+  sltu:
+    rs = registers[instr->rs];
+    rt = registers[instr->rt];
+    registers[instr->rd] = (rs < rt);
+    goto retire;
+
+  sra:
+    registers[instr->rd] = registers[instr->rt] >> instr->extra;
+    goto retire;
+
+  srav:
+    registers[instr->rd] = registers[instr->rt] >>
+	(registers[instr->rs] & 0x1f);
+    goto retire;
+
+  srl:
+    tmp = registers[instr->rt];
+    tmp >>= instr->extra;
+    registers[instr->rd] = tmp;
+    goto retire;
+
+  srlv:
+    tmp = registers[instr->rt];
+    tmp >>= (registers[instr->rs] & 0x1f);
+    registers[instr->rd] = tmp;
+    goto retire;
+
+  sub:
+    diff = registers[instr->rs] - registers[instr->rt];
+    if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+	((registers[instr->rs] ^ diff) & SIGN_BIT)) {
+	RaiseException(OverflowException, 0);
+	goto trapped;
+    }
+    registers[instr->rd] = diff;
+    goto retire;
+
+  subu:
+    registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
+    goto retire;
+
+  sw:
+    if (!WriteMem((unsigned) 
+	    (registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
+	goto trapped;
+    goto retire;
+
+  xor_:
+    registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
+    goto retire;
+
+  xori:
+    registers[instr->rt] = registers[instr->rs] ^ (instr->extra & 0xffff);
+    goto retire;
+
+  other:			// let the reference interpreter do it
+    if (tlb != NULL) {
+	stats->numTlbHits--;	// it fetches the instruction again
+    }
+    OneInstruction();
+    goto trapped;
+
+  retire:			// the instruction completed normally
+    DelayedLoad(nextLoadReg, nextLoadValue);
+    registers[PrevPCReg] = registers[PCReg];
+    registers[PCReg] = registers[NextPCReg];
+    registers[NextPCReg] = pcAfter;
+
+    if (stats->totalTicks + UserTick >= interrupt->NextDue())
+	goto trapped;		// time for an interrupt
+    stats->totalTicks += UserTick;
+    stats->userTicks += UserTick;
+
+    // If we're still on the same page, and it hasn't been written,
+    // go straight to the next instruction.
+    offset = registers[PCReg] - pageVAddr;
+    if (((unsigned) offset < (unsigned) PageSize) && !(offset & 0x3)
+	&& decodedValid[frame]) {
+	if (tlb != NULL) {
+	    stats->numTlbHits++;	// the fetch Translate would have done
+	}
+	instr = &page[offset / 4];
+	goto execute;
+    }
+    goto fetch;
+
+  trapped:			// go through the normal clock tick, since
+    interrupt->OneTick();	// an interrupt may be due, or the kernel
+    goto fetch;			// may have changed anything
+}
+
+//----------------------------------------------------------------------
+// Machine::DecodePage
+// 	Decode all of the words in a physical page frame, and mark the
+//	frame's decoded copy as current.  Data words that happen to share
+//	a page with code get decoded too; that's harmless, since we only
+//	look at an entry when the PC points at it.
+//
+//	"frame" -- the physical page frame to decode
+//----------------------------------------------------------------------
+
+void
+Machine::DecodePage(int frame)
+{
+    Instruction *instr = &decodedPages[frame * (PageSize / 4)];
+    unsigned int *word = (unsigned int *) &mainMemory[frame * PageSize];
+
+    for (int i = 0; i < PageSize / 4; i++, instr++) {
+	instr->value = WordToHost(word[i]);
+	instr->Decode();
+    }
+    decodedValid[frame] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodedPage
+// 	Forget the decoded instructions for a physical page frame; they
+//	will be decoded again the next time we fetch from the frame.
+//
+//	"frame" -- the physical page frame whose contents have changed
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateDecodedPage(int frame)
+{
+    ASSERT((frame >= 0) && (frame < NumPhysPages));
+    decodedValid[frame] = FALSE;
+}
+
 //----------------------------------------------------------------------
 // Instruction::Decode
 // 	Decode a MIPS instruction 
@@ -20,8 +20,13 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numDiskCacheHits = numDiskCacheMisses = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numFastTlbHits = numFastTlbMisses = 0;
+    numTlbHits = numTlbMisses = numTlbFlushes = 0;
+    numFramesInUse = maxFramesInUse = 0;
+    numZeroPoolHits = numZeroPoolMisses = 0;
 }
 
 //----------------------------------------------------------------------
@@ -36,10 +41,27 @@ Statistics::Print()
     cout << "Ticks: total " << totalTicks << ", idle " << idleTicks;
 		cout << ", system " << systemTicks << ", user " << userTicks <<"\n";
     cout << "Disk I/O: reads " << numDiskReads;
-		cout << ", writes " << numDiskWrites << "\n";
+		cout << ", writes " << numDiskWrites;
+    if (numDiskCacheHits + numDiskCacheMisses > 0) {
+	cout << ", cache hit ratio " << 100.0 * numDiskCacheHits /
+		(numDiskCacheHits + numDiskCacheMisses) << "% ("
+		<< numDiskCacheHits << " hits, " << numDiskCacheMisses
+		<< " misses)";
+    }
+    cout << "\n";
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
+    cout << "Fast TLB: hits " << numFastTlbHits;
+    cout << ", misses " << numFastTlbMisses << "\n";
+    if (numTlbHits + numTlbMisses > 0) {
+	cout << "TLB: hits " << numTlbHits << ", misses " << numTlbMisses;
+	cout << ", flushes " << numTlbFlushes << "\n";
+    }
+    cout << "Page frames: in use " << numFramesInUse;
+		cout << ", most in use " << maxFramesInUse;
+    cout << ", zeroed from pool " << numZeroPoolHits;
+		cout << ", zeroed on demand " << numZeroPoolMisses << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
 }
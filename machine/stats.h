@@ -30,9 +30,28 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numDiskCacheHits;	// number of sector reads found in the
+				// buffer cache
+    int numDiskCacheMisses;	// number that had to go to the disk
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numFastTlbHits;		// number of user loads and stores that
+				// reused a cached translation
+    int numFastTlbMisses;	// number that had to call Translate
+    int numTlbHits;		// number of user loads, stores and
+				// instruction fetches that found their
+				// page in the TLB, if there is one
+    int numTlbMisses;		// number it didn't, so that the kernel
+				// had to load the TLB
+    int numTlbFlushes;		// number of times the kernel emptied the
+				// TLB, switching address spaces
+    int numFramesInUse;		// number of page frames user programs
+				// are using now
+    int maxFramesInUse;		// the most they have used at once
+    int numZeroPoolHits;	// number of zeroed frames taken from
+				// the pool (see frames.h)
+    int numZeroPoolMisses;	// number that had to be zeroed then
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
@@ -77,6 +77,14 @@ ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 //   	Returns FALSE if the translation step from virtual to physical memory
 //   	failed.
 //
+//	If we've read from this page since the last FlushFastTlb, the
+//	translation is taken from "readTlb" rather than redone; otherwise
+//	it is saved there after Translate has set the page's use bit.
+//	With a TLB, a page's entry stays in the TLB as long as its
+//	translation stays in "readTlb" (the kernel flushes it whenever it
+//	drops one), so the real machine would have found it there: we
+//	count a TLB hit.
+//
 //	"addr" -- the virtual address to read from
 //	"size" -- the number of bytes to read (1, 2, or 4)
 //	"value" -- the place to write the result
@@ -88,27 +96,43 @@ Machine::ReadMem(int addr, int size, int *value)
     int data;
     ExceptionType exception;
     int physicalAddress;
+    int vpn = (unsigned) addr >> PageShift;
+    FastTlbEntry *fast = &readTlb[vpn & (FastTlbSize - 1)];
+    char *hostAddr;
     
     //DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-	RaiseException(exception, addr);
-	return FALSE;
+    if ((fast->virtualPage == vpn) && !(addr & (size - 1))) {
+	kernel->stats->numFastTlbHits++;
+	if (tlb != NULL) {
+	    kernel->stats->numTlbHits++;	// it's still in the TLB
+	}
+	hostAddr = fast->hostPage + (addr & (PageSize - 1));
+    } else {
+	kernel->stats->numFastTlbMisses++;
+	exception = Translate(addr, &physicalAddress, size, FALSE);
+	if (exception != NoException) {
+	    RaiseException(exception, addr);
+	    return FALSE;
+	}
+	fast->virtualPage = vpn;
+	fast->physicalPage = physicalAddress >> PageShift;
+	fast->hostPage = &mainMemory[fast->physicalPage * PageSize];
+	hostAddr = &mainMemory[physicalAddress];
     }
     switch (size) {
       case 1:
-	data = mainMemory[physicalAddress];
+	data = *hostAddr;
 	*value = data;
 	break;
 	
       case 2:
-	data = *(unsigned short *) &mainMemory[physicalAddress];
+	data = *(unsigned short *) hostAddr;
 	*value = ShortToHost(data);
 	break;
 	
       case 4:
-	data = *(unsigned int *) &mainMemory[physicalAddress];
+	data = *(unsigned int *) hostAddr;
 	*value = WordToHost(data);
 	break;
 
@@ -127,6 +151,9 @@ Machine::ReadMem(int addr, int size, int *value)
 //   	Returns FALSE if the translation step from virtual to physical memory
 //   	failed.
 //
+//	As with ReadMem, but using "writeTlb"; a page only goes there once
+//	Translate has checked that it isn't read-only, and set its dirty bit.
+//
 //	"addr" -- the virtual address to write to
 //	"size" -- the number of bytes to be written (1, 2, or 4)
 //	"value" -- the data to be written
@@ -137,26 +164,43 @@ Machine::WriteMem(int addr, int size, int value)
 {
     ExceptionType exception;
     int physicalAddress;
+    int vpn = (unsigned) addr >> PageShift;
+    FastTlbEntry *fast = &writeTlb[vpn & (FastTlbSize - 1)];
+    char *hostAddr;
      
     //DEBUG(dbgAddr, "Writing VA " << addr << ", size " << size << ", value " << value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-	RaiseException(exception, addr);
-	return FALSE;
+    if ((fast->virtualPage == vpn) && !(addr & (size - 1))) {
+	kernel->stats->numFastTlbHits++;
+	if (tlb != NULL) {
+	    kernel->stats->numTlbHits++;	// it's still in the TLB
+	}
+	hostAddr = fast->hostPage + (addr & (PageSize - 1));
+    } else {
+	kernel->stats->numFastTlbMisses++;
+	exception = Translate(addr, &physicalAddress, size, TRUE);
+	if (exception != NoException) {
+	    RaiseException(exception, addr);
+	    return FALSE;
+	}
+	fast->virtualPage = vpn;
+	fast->physicalPage = physicalAddress >> PageShift;
+	fast->hostPage = &mainMemory[fast->physicalPage * PageSize];
+	hostAddr = &mainMemory[physicalAddress];
     }
+    decodedValid[fast->physicalPage] = FALSE;	// in case it's code
     switch (size) {
       case 1:
-	mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
+	*hostAddr = (unsigned char) (value & 0xff);
 	break;
 
       case 2:
-	*(unsigned short *) &mainMemory[physicalAddress]
+	*(unsigned short *) hostAddr
 		= ShortToMachine((unsigned short) (value & 0xffff));
 	break;
       
       case 4:
-	*(unsigned int *) &mainMemory[physicalAddress]
+	*(unsigned int *) hostAddr
 		= WordToMachine((unsigned int) value);
 	break;
 	
@@ -166,6 +210,22 @@ Machine::WriteMem(int addr, int size, int value)
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::FlushFastTlb
+// 	Throw away every translation cached in the fast TLBs, so that the
+//	next access to each page goes through Translate again.  Called
+//	when the kernel changes the page table or TLB.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushFastTlb()
+{
+    for (int i = 0; i < FastTlbSize; i++) {
+	readTlb[i].virtualPage = -1;
+	writeTlb[i].virtualPage = -1;
+    }
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -203,8 +263,8 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 
 // calculate the virtual page number, and offset within the page,
 // from the virtual address
-    vpn = (unsigned) virtAddr / PageSize;
-    offset = (unsigned) virtAddr % PageSize;
+    vpn = (unsigned) virtAddr >> PageShift;
+    offset = virtAddr & (PageSize - 1);
     
     if (tlb == NULL) {		// => page table => vpn is index into table
 	if (vpn >= pageTableSize) {
@@ -217,16 +277,19 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	entry = &pageTable[vpn];
     } else {
         for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
+    	    if (tlb[i].valid && (tlb[i].virtualPage == vpn) 
+		    && (tlb[i].asid == asid)) {
 		entry = &tlb[i];			// FOUND!
 		break;
 	    }
 	if (entry == NULL) {				// not found
     	    //DEBUG(dbgAddr, "Invalid TLB entry for this virtual page!");
+	    kernel->stats->numTlbMisses++;
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	kernel->stats->numTlbHits++;
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
@@ -0,0 +1,85 @@
+/* filebench.c
+ *	Test program to measure the file system calls.
+ *
+ *	Writes a file in small pieces, reads it back, and opens and
+ *	closes it over and over, while keeping it open once throughout,
+ *	so that every Open shares the file header already in memory.
+ *	The time per call is the total ticks printed when Nachos halts,
+ *	divided by the number of calls.
+ *
+ *	Run it on the real file system: "nachos -x filebench".
+ */
+
+#include "syscall.h"
+
+#define CHUNK	16		/* bytes per Read or Write */
+#define NCHUNKS	32		/* so the file is 512 bytes */
+#define NOPENS	100		/* Opens (and Closes) to time */
+
+char buffer[CHUNK];
+
+void
+Print(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+int
+main()
+{
+    OpenFileId fd, other;
+    int i, j;
+
+    Remove("filebench.dat");		/* left over from a crash? */
+    if (Create("filebench.dat") < 0) {
+	Print("filebench: Create failed\n");
+	Halt();
+    }
+    fd = Open("filebench.dat");
+    if (fd < 0) {
+	Print("filebench: Open failed\n");
+	Halt();
+    }
+
+    for (i = 0; i < NCHUNKS; i++) {
+	for (j = 0; j < CHUNK; j++) {
+	    buffer[j] = i + j;
+	}
+	if (Write(buffer, CHUNK, fd) != CHUNK) {
+	    Print("filebench: Write failed\n");
+	    Halt();
+	}
+    }
+
+    Seek(0, fd);
+    for (i = 0; i < NCHUNKS; i++) {
+	if (Read(buffer, CHUNK, fd) != CHUNK) {
+	    Print("filebench: Read failed\n");
+	    Halt();
+	}
+	for (j = 0; j < CHUNK; j++) {
+	    if (buffer[j] != (char) (i + j)) {
+		Print("filebench: read back the wrong data\n");
+		Halt();
+	    }
+	}
+    }
+
+    for (i = 0; i < NOPENS; i++) {
+	other = Open("filebench.dat");
+	if (other < 0 || Close(other) < 0) {
+	    Print("filebench: Open or Close failed\n");
+	    Halt();
+	}
+    }
+
+    Close(fd);
+    Remove("filebench.dat");
+    Print("filebench: done\n");
+    Halt();
+    /* not reached */
+}
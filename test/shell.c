@@ -1,16 +1,19 @@
 #include "syscall.h"
 
+#define MaxJobs 8
+
 int
 main()
 {
-    SpaceId newProc;
+    SpaceId newProc, jobs[MaxJobs];
     OpenFileId input = ConsoleInput;
     OpenFileId output = ConsoleOutput;
     char prompt[2], ch, buffer[60];
-    int i;
+    int i, background, numJobs;
 
     prompt[0] = '-';
     prompt[1] = '-';
+    numJobs = 0;
 
     while( 1 )
     {
@@ -26,9 +29,38 @@ main()
 
 	buffer[--i] = '\0';
 
+	/* "command &" runs in the background: a copy of the shell waits
+	 * for it instead, while we carry on reading commands.  We join
+	 * the copies once the next command in the foreground is done
+	 * (or there are too many of them), so that their exit statuses
+	 * don't pile up in the kernel.
+	 */
+	background = 0;
+	if( i > 0 && buffer[i - 1] == '&' ) {
+		background = 1;
+		buffer[--i] = '\0';
+		while( i > 0 && buffer[i - 1] == ' ' )
+			buffer[--i] = '\0';
+	}
+
 	if( i > 0 ) {
+		if( background ) {
+			if( numJobs == MaxJobs )
+				while( numJobs > 0 )
+					Join(jobs[--numJobs]);
+			newProc = Fork();
+			if( newProc == 0 )	/* the copy */
+				Exit(Join(Exec(buffer)));
+			if( newProc > 0 ) {
+				jobs[numJobs++] = newProc;
+				continue;
+			}
+			/* no copy: run it in the foreground after all */
+		}
 		newProc = Exec(buffer);
 		Join(newProc);
+		while( numJobs > 0 )
+			Join(jobs[--numJobs]);
 	}
     }
 }
@@ -162,6 +162,22 @@ ThreadYield:
         j       $31
         .end ThreadYield
 
+	.globl SetTickets
+	.ent	SetTickets
+SetTickets:
+	addiu $2,$0,SC_SetTickets
+	syscall
+	j	$31
+	.end SetTickets
+
+	.globl Fork
+	.ent	Fork
+Fork:
+	addiu $2,$0,SC_Fork
+	syscall
+	j	$31
+	.end Fork
+
 	.globl ThreadExit
 	.ent    ThreadExit
 ThreadExit:
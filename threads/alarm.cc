@@ -1,8 +1,7 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and putting a thread to
+//	sleep for a while.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -12,6 +11,19 @@
 #include "alarm.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// SleeperCompare
+// 	Order two sleeping threads, earliest wake-up time first.
+//----------------------------------------------------------------------
+
+static int
+SleeperCompare(Sleeper *x, Sleeper *y)
+{
+    if (x->when < y->when) { return -1; }
+    else if (x->when > y->when) { return 1; }
+    else { return 0; }
+}
+
 //----------------------------------------------------------------------
 // Alarm::Alarm
 //      Initialize a software alarm clock.  Start up a timer device
@@ -23,6 +35,46 @@
 Alarm::Alarm(bool doRandom)
 {
     timer = new Timer(doRandom, this);
+    sleepers = new SortedList<Sleeper *>(SleeperCompare);
+}
+
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+//      De-allocate a software alarm clock, as Nachos halts.  Any 
+//	threads still asleep are never woken, so delete them too.
+//----------------------------------------------------------------------
+
+Alarm::~Alarm()
+{
+    Sleeper *sleeper;
+
+    while (!sleepers->IsEmpty()) {
+	sleeper = sleepers->RemoveFront();
+	delete sleeper->thread;
+	delete sleeper;
+    }
+    delete sleepers;
+    delete timer;
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+//      Put the current thread to sleep until at least "x" ticks from
+//	now.  Other threads run in the meantime; CallBack wakes the
+//	thread at the first timer interrupt after its time is up.
+//
+//	"x" -- how long to sleep, in ticks
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int x)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Thread *thread = kernel->currentThread;
+
+    sleepers->Insert(new Sleeper(thread, kernel->stats->totalTicks + x));
+    thread->Sleep(FALSE);
+    (void) kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -39,8 +91,9 @@ Alarm::Alarm(bool doRandom)
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
-//	For now, just provide time-slicing.  Only need to time slice 
-//      if we're currently running something (in other words, not idle).
+//	First wake up any threads whose time is up.  Then time slice,
+//	if we're currently running something (in other words, not idle),
+//	and the scheduler says the thread's time is up.
 //----------------------------------------------------------------------
 
 void 
@@ -48,8 +101,15 @@ Alarm::CallBack()
 {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
+    Sleeper *sleeper;
     
-    if (status != IdleMode) {
+    while (!sleepers->IsEmpty() &&
+		sleepers->Front()->when <= kernel->stats->totalTicks) {
+	sleeper = sleepers->RemoveFront();
+	kernel->scheduler->ReadyToRun(sleeper->thread);
+	delete sleeper;
+    }
+    if ((status != IdleMode) && kernel->scheduler->ShouldPreempt()) {
 	interrupt->YieldOnReturn();
     }
 }
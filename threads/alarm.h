@@ -8,7 +8,8 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
+//	A thread is only woken at a timer interrupt, so it may sleep
+//	for up to one time slice longer than it asked to.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,19 +22,32 @@
 #include "utility.h"
 #include "callback.h"
 #include "timer.h"
+#include "list.h"
+
+class Thread;
+
+// The following class records a thread that is waiting for the alarm.
+
+class Sleeper {
+  public:
+    Sleeper(Thread *t, int w) { thread = t; when = w; }
+    Thread *thread;		// the thread that is asleep
+    int when;			// the time (in ticks) to wake it up
+};
 
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
     Alarm(bool doRandomYield);	// Initialize the timer, and callback 
 				// to "toCall" every time slice.
-    ~Alarm() { delete timer; }
+    ~Alarm();
     
     void WaitUntil(int x);	// suspend execution until time > now + x
-                                // this method is not yet implemented
 
   private:
     Timer *timer;		// the hardware timer device
+    SortedList<Sleeper *> *sleepers;	// threads in WaitUntil, the
+				// earliest to wake up first
 
     void CallBack();		// called when the hardware
 				// timer generates an interrupt
@@ -0,0 +1,1273 @@
+// benchmark.cc 
+//	Performance benchmarks for the Nachos kernel and the hardware
+//	simulation.  Unlike the self tests, these don't check that things
+//	work; they report how long they take, either in host time or 
+//	in simulated ticks, so that alternative implementations can be
+//	compared.
+//
+//	To add a benchmark, write a routine that runs it and prints the
+//	results, and add it to the "benchmarks" table at the end of 
+//	this file.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "benchmark.h"
+#include "sysdep.h"
+#include "interrupt.h"
+#include "list.h"
+#include "heap.h"
+#include "addrspace.h"
+#include "directory.h"
+#include "filesys.h"
+#include "filehdr.h"
+#include "frames.h"
+#include "journal.h"
+#include "openfile.h"
+#include "pbitmap.h"
+#include "synchdisk.h"
+#include "textcache.h"
+
+//----------------------------------------------------------------------
+// EventCompare
+//	Order two scheduled interrupts by when they are due.  (The same
+//	as PendingCompare, in interrupt.cc.)
+//----------------------------------------------------------------------
+
+static int
+EventCompare(PendingInterrupt *x, PendingInterrupt *y)
+{
+    if (x->when < y->when) { return -1; }
+    else if (x->when > y->when) { return 1; }
+    else { return 0; }
+}
+
+static const int EventsPerRun = 200000;	// events to process per run
+static const int MaxEventPeriod = 1000;	// devices reschedule themselves
+					// 1..MaxEventPeriod ticks ahead
+
+//----------------------------------------------------------------------
+// TimeSortedList
+//	Simulate "numDevices" devices, each of which keeps one interrupt
+//	pending, using a SortedList as the event queue the way Interrupt 
+//	used to: a new PendingInterrupt is allocated for every event, 
+//	and the old one is deleted when it fires.
+//
+//	Returns the host time taken, in seconds.
+//----------------------------------------------------------------------
+
+static double
+TimeSortedList(int numDevices)
+{
+    SortedList<PendingInterrupt *> *queue = 
+			new SortedList<PendingInterrupt *>(EventCompare);
+    PendingInterrupt *next;
+    double start, elapsed;
+    int i;
+
+    RandomInit(numDevices);
+    for (i = 0; i < numDevices; i++) {
+	queue->Insert(new PendingInterrupt(NULL, 
+			RandomNumber() % MaxEventPeriod + 1, TimerInt));
+    }
+    start = HostTime();
+    for (i = 0; i < EventsPerRun; i++) {
+	next = queue->RemoveFront();
+	queue->Insert(new PendingInterrupt(NULL, 
+		next->when + RandomNumber() % MaxEventPeriod + 1, next->type));
+	delete next;
+    }
+    elapsed = HostTime() - start;
+    while (!queue->IsEmpty()) {
+	delete queue->RemoveFront();
+    }
+    delete queue;
+    return elapsed;
+}
+
+//----------------------------------------------------------------------
+// TimeHeap
+//	The same simulation as TimeSortedList, using a Heap as the event
+//	queue and re-using each PendingInterrupt once it has fired, as 
+//	Interrupt now does.
+//
+//	Returns the host time taken, in seconds.
+//----------------------------------------------------------------------
+
+static double
+TimeHeap(int numDevices)
+{
+    Heap<PendingInterrupt *> *queue = 
+			new Heap<PendingInterrupt *>(EventCompare);
+    PendingInterrupt *next;
+    double start, elapsed;
+    int i;
+
+    RandomInit(numDevices);
+    for (i = 0; i < numDevices; i++) {
+	queue->Insert(new PendingInterrupt(NULL, 
+			RandomNumber() % MaxEventPeriod + 1, TimerInt));
+    }
+    start = HostTime();
+    for (i = 0; i < EventsPerRun; i++) {
+	next = queue->RemoveFront();
+	next->when += RandomNumber() % MaxEventPeriod + 1;
+	queue->Insert(next);
+    }
+    elapsed = HostTime() - start;
+    while (!queue->IsEmpty()) {
+	delete queue->RemoveFront();
+    }
+    delete queue;
+    return elapsed;
+}
+
+//----------------------------------------------------------------------
+// EventQueueBenchmark
+//	Compare the cost of scheduling and firing interrupts with the
+//	old SortedList event queue and the current Heap, for different 
+//	numbers of interrupts pending at once.
+//----------------------------------------------------------------------
+
+static void
+EventQueueBenchmark()
+{
+    static int pendingCounts[] = { 4, 16, 64, 256, 1024 };
+    int numCounts = sizeof(pendingCounts) / sizeof(int);
+    double listTime, heapTime;
+
+    printf("%d events, host nanoseconds per event:\n", EventsPerRun);
+    printf("%10s %12s %12s\n", "pending", "SortedList", "Heap");
+    for (int i = 0; i < numCounts; i++) {
+	listTime = TimeSortedList(pendingCounts[i]);
+	heapTime = TimeHeap(pendingCounts[i]);
+	printf("%10d %12.1f %12.1f\n", pendingCounts[i],
+		listTime * 1e9 / EventsPerRun, heapTime * 1e9 / EventsPerRun);
+    }
+}
+
+// Programs to load: from the build directory, or with the real file
+// system, copies made with "nachos -cp ../test/matmult matmult" etc.
+
+static char *startupPrograms[] = {
+#ifdef FILESYS_STUB
+    "../test/halt", "../test/matmult", "../test/sort"
+#else
+    "halt", "matmult", "sort"
+#endif
+};
+static const int LoadsPerRun = 200;	// times to load each program
+
+//----------------------------------------------------------------------
+// StartupBenchmark
+//	Measure how long it takes to start a user program: create an
+//	address space and load the program into it (from scratch each 
+//	time), then throw it away again.  The simulated time is the 
+//	time spent waiting for the disk, with the real file system.
+//
+//	With "-vm", this only measures reading the program's header,
+//	since its pages are read in as they are used.
+//----------------------------------------------------------------------
+
+static void
+StartupBenchmark()
+{
+    int numPrograms = sizeof(startupPrograms) / sizeof(char *);
+    AddrSpace *space;
+    double start, elapsed;
+    int startTicks, ticks, j;
+
+    printf("%d loads, per load:\n", LoadsPerRun);
+    printf("%16s %18s %16s\n", "program", "host microseconds", "simulated ticks");
+    for (int i = 0; i < numPrograms; i++) {
+	start = HostTime();
+	startTicks = kernel->stats->totalTicks;
+	for (j = 0; j < LoadsPerRun; j++) {
+	    space = new AddrSpace;
+	    if (!space->Load(startupPrograms[i])) {
+		delete space;
+		break;			// Load has said why
+	    }
+	    delete space;
+	}
+	if (j < LoadsPerRun) {
+	    continue;
+	}
+	elapsed = HostTime() - start;
+	ticks = kernel->stats->totalTicks - startTicks;
+	printf("%16s %18.1f %16d\n", startupPrograms[i],
+		elapsed * 1e6 / LoadsPerRun, ticks / LoadsPerRun);
+    }
+}
+
+static char *textModeNames[] = { "private", "shared" };
+static const int MaxTextCopies = 64;	// more than fit in memory
+
+//----------------------------------------------------------------------
+// TextBenchmark
+//	Measure what sharing the code of a program saves: load copies of
+//	each program, without throwing them away, until memory is full,
+//	first with each copy having its own code (as with "-nt"), then
+//	with the copies sharing it (see textcache.h).  Only the first 
+//	copy that shares has to read the code in.
+//
+//	Without "-vm", that is; with it, nothing is shared.
+//----------------------------------------------------------------------
+
+static void
+TextBenchmark()
+{
+    int numPrograms = sizeof(startupPrograms) / sizeof(char *);
+    TextCache *textCache = kernel->textCache;
+    AddrSpace *spaces[MaxTextCopies];
+    double start, elapsed;
+    int startTicks, startFree, ticks, frames, numCopies;
+
+    kernel->textCache = NULL;
+
+    printf("Loading copies of a program until memory is full:\n");
+    printf("%16s %8s %8s %16s %18s %16s\n", "program", "mode", "copies",
+		"frames per copy", "host usec per load", "ticks per load");
+    for (int i = 0; i < numPrograms; i++) {
+	spaces[0] = new AddrSpace;	// load it once first, so both
+	if (!spaces[0]->Load(startupPrograms[i])) {	// modes start
+	    delete spaces[0];		// with it in the disk's cache
+	    continue;
+	}
+	delete spaces[0];
+	for (int mode = 0; mode < 2; mode++) {
+	    kernel->textCache = (mode == 1) ? new TextCache() : NULL;
+	    start = HostTime();
+	    startTicks = kernel->stats->totalTicks;
+	    startFree = kernel->frameAllocator->NumFree();
+	    for (numCopies = 0; numCopies < MaxTextCopies; numCopies++) {
+		spaces[numCopies] = new AddrSpace;
+		if (!spaces[numCopies]->Load(startupPrograms[i])) {
+		    delete spaces[numCopies];
+		    break;		// Load has said why
+		}
+	    }
+	    elapsed = HostTime() - start;
+	    ticks = kernel->stats->totalTicks - startTicks;
+	    frames = startFree - kernel->frameAllocator->NumFree();
+	    if (numCopies > 0) {
+		printf("%16s %8s %8d %16.1f %18.1f %16d\n", startupPrograms[i],
+			textModeNames[mode], numCopies, 
+			(double) frames / numCopies,
+			elapsed * 1e6 / numCopies, ticks / numCopies);
+	    }
+	    while (numCopies > 0) {
+		delete spaces[--numCopies];
+	    }
+	    delete kernel->textCache;
+	    kernel->textCache = NULL;
+	}
+    }
+    kernel->textCache = textCache;	// as it was
+}
+
+static char *poolModeNames[] = { "no pool", "pool" };
+
+//----------------------------------------------------------------------
+// ZeroBenchmark
+//	Measure what keeping a pool of zeroed frames saves when a user
+//	program is loaded: load each program over and over, first with
+//	no pool ("-zp 0"), so that its uninitialized data and stack are
+//	zeroed as it is loaded, then with the idle loop filling the pool
+//	between loads (see frames.h).  The time the idle loop takes is
+//	shown separately; it comes out of time the CPU has free anyway.
+//----------------------------------------------------------------------
+
+static void
+ZeroBenchmark()
+{
+    int numPrograms = sizeof(startupPrograms) / sizeof(char *);
+    FrameAllocator *frameAllocator = kernel->frameAllocator;
+    AddrSpace *space;
+    double start, elapsed, idle;
+    int startHits, startMisses, j;
+
+    printf("%d loads, per load:\n", LoadsPerRun);
+    printf("%16s %8s %18s %12s %12s %14s\n", "program", "mode",
+		"host microseconds", "from pool", "on demand", "idle usec");
+    for (int i = 0; i < numPrograms; i++) {
+	for (int mode = 0; mode < 2; mode++) {
+	    kernel->frameAllocator = new FrameAllocator(NumPhysPages, 
+			(mode == 1) ? DefaultZeroPoolFrames : 0);
+	    elapsed = idle = 0;
+	    startHits = kernel->stats->numZeroPoolHits;
+	    startMisses = kernel->stats->numZeroPoolMisses;
+	    for (j = 0; j < LoadsPerRun; j++) {
+		start = HostTime();
+		kernel->frameAllocator->ZeroIdleFrames();
+		idle += HostTime() - start;
+		start = HostTime();
+		space = new AddrSpace;
+		if (!space->Load(startupPrograms[i])) {
+		    delete space;
+		    break;		// Load has said why
+		}
+		delete space;
+		elapsed += HostTime() - start;
+	    }
+	    delete kernel->frameAllocator;
+	    kernel->frameAllocator = frameAllocator;
+	    if (j < LoadsPerRun) {
+		break;
+	    }
+	    printf("%16s %8s %18.1f %12d %12d %14.1f\n", startupPrograms[i],
+		    poolModeNames[mode], elapsed * 1e6 / LoadsPerRun,
+		    (kernel->stats->numZeroPoolHits - startHits) / LoadsPerRun,
+		    (kernel->stats->numZeroPoolMisses - startMisses) 
+			/ LoadsPerRun,
+		    idle * 1e6 / LoadsPerRun);
+	}
+    }
+}
+
+static char *cloneModeNames[] = { "exec", "fork", "fork+write" };
+
+//----------------------------------------------------------------------
+// ForkBenchmark
+//	Measure how much cheaper it is to start a copy of a running 
+//	program with Fork than to load it afresh with Exec: load each
+//	program once, then repeatedly
+//		exec -- load another copy of it, as Exec does;
+//		fork -- clone it, as Fork does (see AddrSpace::Fork);
+//		fork+write -- clone it, then write to every page of the 
+//			clone that can be written, so that each is copied;
+//	and throw the new address space away again.  "fork+write" is
+//	the most a clone can ever cost.
+//
+//	Fork doesn't work with "-vm", so then this only measures exec.
+//----------------------------------------------------------------------
+
+static void
+ForkBenchmark()
+{
+    int numPrograms = sizeof(startupPrograms) / sizeof(char *);
+    AddrSpace *parent, *space;
+    double start, elapsed;
+    int startTicks, ticks, copies, j;
+
+    printf("%d clones of a loaded program, per clone:\n", LoadsPerRun);
+    printf("%16s %10s %18s %16s %14s\n", "program", "mode", 
+		"host microseconds", "simulated ticks", "pages copied");
+    for (int i = 0; i < numPrograms; i++) {
+	parent = new AddrSpace;
+	if (!parent->Load(startupPrograms[i])) {
+	    delete parent;
+	    continue;			// Load has said why
+	}
+	for (int mode = 0; mode < 3; mode++) {
+	    start = HostTime();
+	    startTicks = kernel->stats->totalTicks;
+	    copies = 0;
+	    for (j = 0; j < LoadsPerRun; j++) {
+		if (mode == 0) {
+		    space = new AddrSpace;
+		    if (!space->Load(startupPrograms[i])) {
+			delete space;
+			break;
+		    }
+		} else if ((space = parent->Fork()) == NULL) {
+		    break;
+		}
+		if (mode == 2) {
+		    for (int vpn = 0; vpn < space->NumPages(); vpn++) {
+			if (space->CopyOnWrite(vpn * PageSize)) {
+			    copies++;
+			}
+		    }
+		}
+		delete space;
+	    }
+	    if (j < LoadsPerRun) {
+		continue;
+	    }
+	    elapsed = HostTime() - start;
+	    ticks = kernel->stats->totalTicks - startTicks;
+	    printf("%16s %10s %18.1f %16d %14d\n", startupPrograms[i],
+		    cloneModeNames[mode], elapsed * 1e6 / LoadsPerRun, 
+		    ticks / LoadsPerRun, copies / LoadsPerRun);
+	}
+	delete parent;
+    }
+}
+
+// Copies of one program to run side by side, each with its own
+// number of tickets, for ShareBenchmark.
+
+#ifdef FILESYS_STUB
+static char *shareProgram = "../test/matmult";
+#else
+static char *shareProgram = "matmult";
+#endif
+static int shareTickets[] = { 100, 200, 300 };
+static const int NumShareThreads = sizeof(shareTickets) / sizeof(int);
+static AddrSpace *shareSpaces[NumShareThreads];
+static const int ShareWindow = 300000;	// ticks to let them run for;
+					// less than matmult needs to finish
+
+//----------------------------------------------------------------------
+// ShareThread
+//	Run a user program that has already been loaded.
+//
+//	"which" -- the copy to run; its address space is in shareSpaces
+//----------------------------------------------------------------------
+
+static void
+ShareThread(int which)
+{
+    shareSpaces[which]->Execute();
+}
+
+//----------------------------------------------------------------------
+// ShareBenchmark
+//	Measure how closely the scheduler divides the CPU in proportion 
+//	to tickets (see "-sc stride" and "-sc lottery"): run a few copies
+//	of a compute-bound program, each with a different number of 
+//	tickets, for a fixed time, and compare the share of user 
+//	instructions each got with its share of the tickets.
+//
+//	The other policies ignore tickets, so for them the shares come
+//	out about equal.  Without "-vm" only as many copies as fit in
+//	memory are run.
+//----------------------------------------------------------------------
+
+static void
+ShareBenchmark()
+{
+    Thread *threads[NumShareThreads];
+    int numThreads, totalTickets = 0, totalTicks = 0, i;
+
+    for (i = 0; i < NumShareThreads; i++) {
+	shareSpaces[i] = new AddrSpace;
+	if (!shareSpaces[i]->Load(shareProgram)) {
+	    delete shareSpaces[i];
+	    break;			// Load has said why
+	}
+    }
+    numThreads = i;
+    if (numThreads < 2) {
+	printf("Not enough memory for two copies of %s; try -vm\n",
+		shareProgram);
+	return;
+    }
+    for (i = 0; i < numThreads; i++) {
+	threads[i] = new Thread(shareProgram);
+	threads[i]->setTickets(shareTickets[i]);
+	threads[i]->Fork((VoidFunctionPtr) ShareThread, i);
+	totalTickets += shareTickets[i];
+    }
+
+    kernel->alarm->WaitUntil(ShareWindow);
+
+    for (i = 0; i < numThreads; i++) {
+	totalTicks += threads[i]->userTicks;
+    }
+    printf("%d copies of %s, for %d ticks:\n", numThreads, shareProgram,
+		ShareWindow);
+    printf("%8s %8s %12s %14s %14s\n", "thread", "tickets", "user ticks",
+		"share (%)", "expected (%)");
+    for (i = 0; i < numThreads; i++) {
+	printf("%8d %8d %12d %14.1f %14.1f\n", i, threads[i]->getTickets(),
+		threads[i]->userTicks, 
+		100.0 * threads[i]->userTicks / totalTicks,
+		100.0 * threads[i]->getTickets() / totalTickets);
+    }
+}
+
+#ifndef FILESYS_STUB
+static const int ReadChunk = 16;	// bytes per Read: small, like Print
+					// (in main.cc) uses
+static int readAheadWork[] = { 0, 1000, 4000 };
+					// ticks of other work per sector read
+static const int ReadAheadFileSectors = 30;
+
+//----------------------------------------------------------------------
+// Work
+//	Keep the CPU busy for about "ticks" ticks, as if computing.
+//----------------------------------------------------------------------
+
+static void
+Work(int ticks)
+{
+    for (int i = 0; i < ticks; i += SystemTick) {
+	kernel->interrupt->SetLevel(IntOff);
+	kernel->interrupt->SetLevel(IntOn);	// advances the clock
+    }
+}
+#endif
+
+//----------------------------------------------------------------------
+// ReadAheadBenchmark
+//	Measure how long it takes to read a file sequentially, a little
+//	at a time, starting with nothing in the disk's cache (see "-ra").
+//	Between sectors the reader does some other work, which is what
+//	read-ahead can overlap with the disk.  The ticks per sector 
+//	include that work.
+//----------------------------------------------------------------------
+
+static void
+ReadAheadBenchmark()
+{
+#ifdef FILESYS_STUB
+    printf("Needs the real file system\n");
+#else
+    char *name = "READAHEAD";
+    int numSectors = ReadAheadFileSectors;
+    int numRuns = sizeof(readAheadWork) / sizeof(int);
+    char *buffer = new char[SectorSize];
+    int startTicks, startReads;
+    OpenFile *file;
+
+    kernel->fileSystem->Remove(name);
+    if (!kernel->fileSystem->Create(name, numSectors * SectorSize)) {
+	printf("Unable to create %s\n", name);
+	return;
+    }
+    file = kernel->fileSystem->Open(name);
+    for (int i = 0; i < numSectors; i++) {
+	memset(buffer, 'a' + i % 26, SectorSize);
+	file->Write(buffer, SectorSize);
+    }
+    delete file;
+
+    printf("%d sectors, read ahead %d:\n", numSectors,
+		kernel->synchDisk->ReadAheadSectors());
+    printf("%16s %16s %12s\n", "work per sector", "ticks per sector",
+		"disk reads");
+    for (int run = 0; run < numRuns; run++) {
+	kernel->synchDisk->Invalidate();
+	file = kernel->fileSystem->Open(name);
+	startTicks = kernel->stats->totalTicks;
+	startReads = kernel->stats->numDiskReads;
+	for (int i = 0; i < numSectors; i++) {
+	    for (int j = 0; j < SectorSize; j += ReadChunk) {
+		file->Read(buffer, ReadChunk);
+	    }
+	    Work(readAheadWork[run]);
+	}
+	printf("%16d %16d %12d\n", readAheadWork[run],
+		(kernel->stats->totalTicks - startTicks) / numSectors,
+		kernel->stats->numDiskReads - startReads);
+	delete file;
+    }
+    delete [] buffer;
+    kernel->fileSystem->Remove(name);
+#endif
+}
+
+// A disk workload for DiskBenchmark: several threads, each reading
+// sectors scattered over the whole disk, one after another.
+
+static const int NumDiskThreads = 8;
+static const int DiskReadsPerThread = 40;
+static int diskSectors[NumDiskThreads][DiskReadsPerThread];
+static char *diskPolicyNames[] = { "fcfs", "sstf", "scan", "clook" };
+static SynchDisk *benchDisk;		// the disk being measured
+static Semaphore *diskThreadsDone;
+static int diskWaitTotal, diskWaitLongest;
+
+//----------------------------------------------------------------------
+// DiskThread
+//	Read one thread's share of the sectors, timing each read.
+//
+//	"which" -- the thread's row of diskSectors
+//----------------------------------------------------------------------
+
+static void
+DiskThread(int which)
+{
+    char *buffer = new char[SectorSize];
+
+    for (int i = 0; i < DiskReadsPerThread; i++) {
+	int start = kernel->stats->totalTicks;
+	int wait;
+
+	benchDisk->ReadSector(diskSectors[which][i], buffer);
+	wait = kernel->stats->totalTicks - start;
+	diskWaitTotal += wait;
+	diskWaitLongest = max(diskWaitLongest, wait);
+    }
+    delete [] buffer;
+    diskThreadsDone->V();
+}
+
+//----------------------------------------------------------------------
+// DiskBenchmark
+//	Compare the disk scheduling policies (see "-ds") on the same
+//	workload: a few threads each reading random sectors, so that 
+//	there are usually several requests waiting for the disk.  Each
+//	policy gets a SynchDisk of its own, without a cache, so that 
+//	every read goes to the disk; it only reads, so the file system
+//	on the disk is safe.
+//----------------------------------------------------------------------
+
+static void
+DiskBenchmark()
+{
+    int numPolicies = sizeof(diskPolicyNames) / sizeof(char *);
+    int numReads = NumDiskThreads * DiskReadsPerThread;
+    DiskSchedulingPolicy policy;
+    int startTicks;
+
+    RandomInit(NumSectors);
+    for (int i = 0; i < NumDiskThreads; i++) {
+	for (int j = 0; j < DiskReadsPerThread; j++) {
+	    diskSectors[i][j] = RandomNumber() % NumSectors;
+	}
+    }
+    kernel->synchDisk->Flush();		// so it leaves the disk alone
+
+    printf("%d threads, %d reads each:\n", NumDiskThreads, 
+		DiskReadsPerThread);
+    printf("%8s %12s %16s %14s\n", "policy", "total ticks", 
+		"ticks per read", "longest wait");
+    for (int p = 0; p < numPolicies; p++) {
+	bool known = ParseDiskSchedulingPolicy(diskPolicyNames[p], &policy);
+
+	ASSERT(known);
+	benchDisk = new SynchDisk(0, 0, policy, FALSE);
+	diskThreadsDone = new Semaphore("disk benchmark", 0);
+	diskWaitTotal = diskWaitLongest = 0;
+	startTicks = kernel->stats->totalTicks;
+	for (int i = 0; i < NumDiskThreads; i++) {
+	    Thread *t = new Thread("disk reader");
+
+	    t->Fork((VoidFunctionPtr) DiskThread, i);
+	}
+	for (int i = 0; i < NumDiskThreads; i++) {
+	    diskThreadsDone->P();
+	}
+	printf("%8s %12d %16d %14d\n", diskPolicyNames[p],
+		kernel->stats->totalTicks - startTicks, 
+		diskWaitTotal / numReads, diskWaitLongest);
+	delete diskThreadsDone;
+	delete benchDisk;
+    }
+}
+
+static int transferSizes[] = { 1, 4, 8, 0 };
+					// sectors per request, for 
+					// TransferBenchmark; 0 for a
+					// whole track
+
+//----------------------------------------------------------------------
+// TransferBenchmark
+//	Measure how the number of sectors per disk request affects the
+//	time to read the whole disk, in order: simulated ticks, and 
+//	host time, most of which goes on system calls to read the file 
+//	holding the disk.  As in DiskBenchmark, the reads go through a 
+//	SynchDisk without a cache.
+//----------------------------------------------------------------------
+
+static void
+TransferBenchmark()
+{
+    int numRuns = sizeof(transferSizes) / sizeof(int);
+    char *buffer = new char[max(SectorsPerTrack, 8) * SectorSize];
+    SynchDisk *disk;
+    int startTicks;
+    double start;
+
+    kernel->synchDisk->Flush();		// so it leaves the disk alone
+    disk = new SynchDisk(0, 0, FCFSDiskScheduling, FALSE);
+    printf("%d sectors:\n", NumSectors);
+    printf("%18s %18s %20s\n", "sectors per read", "ticks per sector",
+		"host usec per sector");
+    for (int run = 0; run < numRuns; run++) {
+	int size = (transferSizes[run] > 0) ? transferSizes[run] 
+						: SectorsPerTrack;
+
+	startTicks = kernel->stats->totalTicks;
+	start = HostTime();
+	for (int i = 0; i < NumSectors; i += size) {
+	    disk->ReadSectors(i, min(size, NumSectors - i), buffer);
+	}
+	printf("%18d %18d %20.2f\n", size, 
+		(kernel->stats->totalTicks - startTicks) / NumSectors,
+		(HostTime() - start) * 1e6 / NumSectors);
+    }
+    delete disk;
+    delete [] buffer;
+}
+
+#ifndef FILESYS_STUB
+static const int CopyChunk = 128;	// bytes per Read or Write, as 
+					// Copy (in main.cc) uses
+static const int CopyRuns = 50;		// times to copy, for each mode
+#define CopyFileSize	(30 * SectorSize)
+#endif
+
+//----------------------------------------------------------------------
+// CopyBenchmark
+//	Measure the host time it takes the file system to write a file
+//	and read it back, first with the disk's UNIX file read and 
+//	written with system calls, and then with it mapped into memory
+//	(see "-dm").  For each, the kernel's disk is replaced by one 
+//	without a cache, so that every sector goes to the disk.
+//----------------------------------------------------------------------
+
+static void
+CopyBenchmark()
+{
+#ifdef FILESYS_STUB
+    printf("Needs the real file system\n");
+#else
+    char *name = "COPY";
+    SynchDisk *kernelDisk = kernel->synchDisk;
+    char buffer[CopyChunk];
+    OpenFile *file;
+    double start, elapsed;
+
+    memset(buffer, 'c', CopyChunk);
+    printf("%d bytes, written and read back %d times:\n", CopyFileSize,
+		CopyRuns);
+    printf("%12s %16s %16s\n", "disk file", "host seconds", 
+		"KB per second");
+    for (int m = 0; m < 2; m++) {
+	bool mapped = (m == 1);
+
+	kernelDisk->Flush();
+	kernel->synchDisk = new SynchDisk(0, 0, FCFSDiskScheduling, mapped);
+	kernel->fileSystem->Remove(name);
+	start = HostTime();
+	for (int run = 0; run < CopyRuns; run++) {
+	    if (!kernel->fileSystem->Create(name, CopyFileSize)) {
+		printf("Unable to create %s\n", name);
+		break;
+	    }
+	    file = kernel->fileSystem->Open(name);
+	    for (int i = 0; i < CopyFileSize; i += CopyChunk) {
+		file->Write(buffer, CopyChunk);
+	    }
+	    file->Seek(0);
+	    for (int i = 0; i < CopyFileSize; i += CopyChunk) {
+		file->Read(buffer, CopyChunk);
+	    }
+	    delete file;
+	    kernel->fileSystem->Remove(name);
+	}
+	elapsed = HostTime() - start;
+	delete kernel->synchDisk;
+	kernel->synchDisk = kernelDisk;
+	kernelDisk->Invalidate();	// the disk has changed under it
+	printf("%12s %16.3f %16.0f\n", mapped ? "mapped" : "read/write",
+		elapsed, 2.0 * CopyFileSize * CopyRuns / 1024 / elapsed);
+    }
+#endif
+}
+
+#ifndef FILESYS_STUB
+#define LargeFileSize	(NumSectors * SectorSize / 2)
+					// half the disk
+static int largeChunks[] = { 128, 4096 };
+					// bytes per Read or Write
+#endif
+
+//----------------------------------------------------------------------
+// LargeFileBenchmark
+//	Measure how fast a large file can be written and then read back,
+//	sequentially, starting with nothing in the disk's cache, in 
+//	simulated ticks per KB.  The time to write includes flushing
+//	the cache.  Small chunks go through the cache a sector at a time; 
+//	large ones are read and written many sectors per disk request, 
+//	if the file's sectors are contiguous.
+//----------------------------------------------------------------------
+
+static void
+LargeFileBenchmark()
+{
+#ifdef FILESYS_STUB
+    printf("Needs the real file system\n");
+#else
+    char *name = "LARGE";
+    int numRuns = sizeof(largeChunks) / sizeof(int);
+    int kbytes = LargeFileSize / 1024;
+    char *buffer;
+    OpenFile *file;
+    int start, writeTicks;
+
+    printf("%d KB file:\n", kbytes);
+    printf("%12s %20s %20s\n", "chunk bytes", "write ticks per KB", 
+		"read ticks per KB");
+    for (int run = 0; run < numRuns; run++) {
+	int chunk = largeChunks[run];
+
+	kernel->fileSystem->Remove(name);
+	if (!kernel->fileSystem->Create(name, LargeFileSize)) {
+	    printf("Unable to create %s\n", name);
+	    return;
+	}
+	buffer = new char[chunk];
+	memset(buffer, 'l', chunk);
+	kernel->synchDisk->Invalidate();
+	file = kernel->fileSystem->Open(name);
+
+	start = kernel->stats->totalTicks;
+	for (int i = 0; i < LargeFileSize; i += chunk) {
+	    file->Write(buffer, chunk);
+	}
+	kernel->synchDisk->Flush();
+	writeTicks = kernel->stats->totalTicks - start;
+
+	kernel->synchDisk->Invalidate();
+	file->Seek(0);
+	start = kernel->stats->totalTicks;
+	for (int i = 0; i < LargeFileSize; i += chunk) {
+	    file->Read(buffer, chunk);
+	}
+	printf("%12d %20d %20d\n", chunk, writeTicks / kbytes,
+		(kernel->stats->totalTicks - start) / kbytes);
+	delete file;
+	delete [] buffer;
+    }
+    kernel->fileSystem->Remove(name);
+#endif
+}
+
+static const int AllocFiles = 8;	// files to allocate on a
+static const int AllocFileSectors = 24;	// fragmented disk
+static const int AllocRuns = 2000;	// times to allocate them, for
+					// timing
+static char *allocatorNames[] = { "per sector", "runs" };
+
+//----------------------------------------------------------------------
+// Fragment
+//	Mark about half the sectors in "freeMap" in use, in runs of 1 to 
+//	8 sectors scattered at random, as if by files long since 
+//	created and removed.  The same every time.
+//----------------------------------------------------------------------
+
+static void
+Fragment(PersistentBitmap *freeMap)
+{
+    RandomInit(NumSectors);
+    while (freeMap->NumClear() > NumSectors / 2) {
+	int start = RandomNumber() % NumSectors;
+	int length = RandomNumber() % 8 + 1;
+
+	for (int i = start; i < min(start + length, NumSectors); i++) {
+	    if (!freeMap->Test(i)) {
+		freeMap->Mark(i);
+	    }
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// AllocateFiles
+//	Allocate AllocFiles files' worth of sectors from "freeMap", and
+//	fill in "sectors" with where each file's sectors went, in order.
+//	The "per sector" allocator takes the first free sector for each
+//	one, as Nachos used to; "runs" is FileHeader::Allocate, which 
+//	looks for runs of free sectors near each other.
+//----------------------------------------------------------------------
+
+static void
+AllocateFiles(int allocator, PersistentBitmap *freeMap, FileHeader *hdrs,
+		int sectors[][AllocFileSectors])
+{
+    for (int f = 0; f < AllocFiles; f++) {
+	if (allocator == 0) {
+	    for (int i = 0; i < AllocFileSectors; i++) {
+		sectors[f][i] = freeMap->FindAndSet();
+	    }
+	} else {
+	    bool ok = hdrs[f].Allocate(freeMap, 
+				AllocFileSectors * SectorSize, 0);
+
+	    ASSERT(ok);
+	    for (int i = 0; i < AllocFileSectors; i++) {
+		sectors[f][i] = hdrs[f].ByteToSector(i * SectorSize);
+	    }
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// FreeFiles
+//	Give back the sectors that AllocateFiles took.
+//----------------------------------------------------------------------
+
+static void
+FreeFiles(int allocator, PersistentBitmap *freeMap, FileHeader *hdrs,
+		int sectors[][AllocFileSectors])
+{
+    for (int f = 0; f < AllocFiles; f++) {
+	if (allocator == 0) {
+	    for (int i = 0; i < AllocFileSectors; i++) {
+		freeMap->Clear(sectors[f][i]);
+	    }
+	} else {
+	    hdrs[f].Deallocate(freeMap);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// AllocBenchmark
+//	Compare allocating files a sector at a time with allocating them
+//	in runs, on a disk that is half full and fragmented: the host 
+//	time to allocate and free a file, and the simulated ticks to read
+//	each file back, which mostly go on seeks and rotational delay.
+//	Each read starts with the head at the file's first sector, so
+//	only the seeks within the file count.  As in OpenFile::ReadAt, 
+//	sectors that are next to each other are read with one request.
+//	The reads go through a SynchDisk without a cache, and the free 
+//	map is a private one, so the file system on the disk is left 
+//	alone.
+//----------------------------------------------------------------------
+
+static void
+AllocBenchmark()
+{
+    int numAllocators = sizeof(allocatorNames) / sizeof(char *);
+    int (*sectors)[AllocFileSectors] = new int[AllocFiles][AllocFileSectors];
+    char *buffer = new char[AllocFileSectors * SectorSize];
+    PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
+    FileHeader *hdrs;
+    SynchDisk *disk;
+    int startTicks, readTicks, run;
+    double start;
+
+    Fragment(freeMap);
+    kernel->synchDisk->Flush();		// so it leaves the disk alone
+    disk = new SynchDisk(0, 0, FCFSDiskScheduling, FALSE);
+    printf("%d files of %d sectors, on a disk %d%% full:\n", AllocFiles,
+		AllocFileSectors, 
+		100 - 100 * freeMap->NumClear() / NumSectors);
+    printf("%12s %20s %22s\n", "allocator", "host usec per file",
+		"read ticks per sector");
+    for (int a = 0; a < numAllocators; a++) {
+	hdrs = new FileHeader[AllocFiles];
+	start = HostTime();
+	for (int r = 0; r < AllocRuns; r++) {
+	    AllocateFiles(a, freeMap, hdrs, sectors);
+	    FreeFiles(a, freeMap, hdrs, sectors);
+	}
+	printf("%12s %20.3f", allocatorNames[a], 
+		(HostTime() - start) * 1e6 / (AllocRuns * AllocFiles));
+
+	AllocateFiles(a, freeMap, hdrs, sectors);
+	readTicks = 0;
+	for (int f = 0; f < AllocFiles; f++) {
+	    disk->ReadSector(sectors[f][0], buffer);	// to put the head
+							// there
+	    startTicks = kernel->stats->totalTicks;
+	    for (int i = 0; i < AllocFileSectors; i += run) {
+		for (run = 1; (i + run < AllocFileSectors) &&
+			(sectors[f][i + run] == sectors[f][i] + run); run++) {
+		    ;
+		}
+		disk->ReadSectors(sectors[f][i], run, buffer);
+	    }
+	    readTicks += kernel->stats->totalTicks - startTicks;
+	}
+	printf(" %22d\n", readTicks / (AllocFiles * AllocFileSectors));
+	FreeFiles(a, freeMap, hdrs, sectors);
+	delete [] hdrs;
+    }
+    delete disk;
+    delete freeMap;
+    delete [] buffer;
+    delete [] sectors;
+}
+
+#ifndef FILESYS_STUB
+static const int BenchDirs = 8;		// directories, each with
+static const int BenchDirFiles = 40;	// this many files: as many as
+					// fit, with their headers, on
+					// the disk
+static const int OpenRounds = 30;	// times to open every file
+
+//----------------------------------------------------------------------
+// FilesPhase
+//	Print the cost of "count" operations on files, since "start"
+//	(host time) and "startReads" (disk reads).
+//----------------------------------------------------------------------
+
+static void
+FilesPhase(char *what, int count, double start, int startReads)
+{
+    printf("%16s %8d %20.3f %20.3f\n", what, count, 
+		(HostTime() - start) * 1e6 / count,
+		(double) (kernel->stats->numDiskReads - startReads) / count);
+}
+
+//----------------------------------------------------------------------
+// OpenBenchFiles
+//	Open, and close, each of the files that FilesBenchmark made.
+//----------------------------------------------------------------------
+
+static void
+OpenBenchFiles()
+{
+    char name[PathNameMaxLen + 1];
+
+    for (int d = 0; d < BenchDirs; d++) {
+	for (int f = 0; f < BenchDirFiles; f++) {
+	    sprintf(name, "bench/directory-%d/a-long-file-name-%d", d, f);
+	    OpenFile *file = kernel->fileSystem->Open(name);
+
+	    ASSERT(file != NULL);
+	    delete file;
+	}
+    }
+}
+#endif
+
+//----------------------------------------------------------------------
+// FilesBenchmark
+//	Measure creating, opening and removing many files with long 
+//	names, spread over several directories below a top one: the 
+//	host time per operation, which is mostly spent finding names,
+//	and how many disk reads each one needed.  Opening is measured 
+//	first just after the file system has been started again, with
+//	nothing in any of its caches, and then with the names already
+//	looked up.  Each open also reads the file's header, unless the
+//	disk's cache still has it.
+//----------------------------------------------------------------------
+
+static void
+FilesBenchmark()
+{
+#ifdef FILESYS_STUB
+    printf("Needs the real file system\n");
+#else
+    int numFiles = BenchDirs * BenchDirFiles;
+    char name[PathNameMaxLen + 1];
+    int startReads;
+    double start;
+    bool journaled;
+
+    if (!kernel->fileSystem->Mkdir("bench")) {
+	printf("Unable to create bench\n");
+	return;
+    }
+    printf("%d files in %d directories:\n", numFiles, BenchDirs);
+    printf("%16s %8s %20s %20s\n", "operation", "count", 
+		"host usec per op", "disk reads per op");
+
+    start = HostTime();
+    startReads = kernel->stats->numDiskReads;
+    for (int d = 0; d < BenchDirs; d++) {
+	sprintf(name, "bench/directory-%d", d);
+	ASSERT(kernel->fileSystem->Mkdir(name));
+	for (int f = 0; f < BenchDirFiles; f++) {
+	    sprintf(name, "bench/directory-%d/a-long-file-name-%d", d, f);
+	    if (!kernel->fileSystem->Create(name, 0)) {
+		printf("Unable to create %s\n", name);
+		return;
+	    }
+	}
+    }
+    FilesPhase("create", numFiles, start, startReads);
+
+    kernel->synchDisk->Flush();		// start the file system again,
+    journaled = kernel->fileSystem->GetJournal()->IsEnabled();
+    delete kernel->fileSystem;		// from what is on disk
+    kernel->synchDisk->Invalidate();
+    kernel->fileSystem = new FileSystem(FALSE, journaled);
+
+    start = HostTime();
+    startReads = kernel->stats->numDiskReads;
+    OpenBenchFiles();
+    FilesPhase("first open", numFiles, start, startReads);
+
+    start = HostTime();
+    startReads = kernel->stats->numDiskReads;
+    for (int round = 0; round < OpenRounds; round++) {
+	OpenBenchFiles();
+    }
+    FilesPhase("open again", numFiles * OpenRounds, start, startReads);
+
+    start = HostTime();
+    startReads = kernel->stats->numDiskReads;
+    for (int d = 0; d < BenchDirs; d++) {
+	for (int f = 0; f < BenchDirFiles; f++) {
+	    sprintf(name, "bench/directory-%d/a-long-file-name-%d", d, f);
+	    ASSERT(kernel->fileSystem->Remove(name));
+	}
+	sprintf(name, "bench/directory-%d", d);
+	ASSERT(kernel->fileSystem->Remove(name));
+    }
+    FilesPhase("remove", numFiles, start, startReads);
+    ASSERT(kernel->fileSystem->Remove("bench"));
+#endif
+}
+
+#ifndef FILESYS_STUB
+// A file system workload for JournalBenchmark: several threads, each
+// creating some small files and then removing them.
+
+static const int NumJournalThreads = 4;
+static const int JournalFilesPerThread = 25;
+static char *journalModeNames[] = { "write-back", "flush each", "journal" };
+static int journalMode;			// index into journalModeNames
+static Semaphore *journalThreadsDone;
+
+//----------------------------------------------------------------------
+// JournalThread
+//	Create one thread's files, then remove them.  Unless there is
+//	a journal, the only way to be sure that an operation has reached
+//	the disk is to flush the whole cache after it, so that is what
+//	"flush each" does.
+//
+//	"which" -- the thread's number, for naming its files
+//----------------------------------------------------------------------
+
+static void
+JournalThread(int which)
+{
+    char name[FileNameMaxLen + 1];
+
+    for (int pass = 0; pass < 2; pass++) {
+	for (int i = 0; i < JournalFilesPerThread; i++) {
+	    sprintf(name, "journal-%d-%d", which, i);
+	    if (pass == 0) {
+		ASSERT(kernel->fileSystem->Create(name, 0));
+	    } else {
+		ASSERT(kernel->fileSystem->Remove(name));
+	    }
+	    if (journalMode == 1) {
+		kernel->synchDisk->Flush();
+	    }
+	}
+    }
+    journalThreadsDone->V();
+}
+#endif
+
+//----------------------------------------------------------------------
+// JournalBenchmark
+//	Measure what it costs to make file system operations durable.
+//	The same workload runs with the file system started again three
+//	ways: without the journal, leaving changes in the disk's cache
+//	("write-back", fast but not safe); without it, flushing the 
+//	cache after every operation; and with it, where threads that 
+//	finish operations at about the same time share one log write 
+//	(group commit).  Each run ends with the cache flushed, so every
+//	change has reached the disk.
+//----------------------------------------------------------------------
+
+static void
+JournalBenchmark()
+{
+#ifdef FILESYS_STUB
+    printf("Needs the real file system\n");
+#else
+    int numModes = sizeof(journalModeNames) / sizeof(char *);
+    int numOps = 2 * NumJournalThreads * JournalFilesPerThread;
+    bool journaled = kernel->fileSystem->GetJournal()->IsEnabled();
+    int startTicks, startWrites;
+    Journal *journal;
+
+    printf("%d threads, each creating and removing %d files:\n", 
+		NumJournalThreads, JournalFilesPerThread);
+    printf("%12s %14s %20s %16s\n", "mode", "ticks per op", 
+		"sectors written/op", "ops per commit");
+    for (journalMode = 0; journalMode < numModes; journalMode++) {
+	kernel->synchDisk->Flush();
+	delete kernel->fileSystem;
+	kernel->fileSystem = new FileSystem(FALSE, journalMode == 2);
+	journal = kernel->fileSystem->GetJournal();
+
+	journalThreadsDone = new Semaphore("journal benchmark", 0);
+	startTicks = kernel->stats->totalTicks;
+	startWrites = kernel->stats->numDiskWrites;
+	for (int i = 0; i < NumJournalThreads; i++) {
+	    Thread *t = new Thread("journal bench");
+
+	    t->Fork((VoidFunctionPtr) JournalThread, i);
+	}
+	for (int i = 0; i < NumJournalThreads; i++) {
+	    journalThreadsDone->P();
+	}
+	kernel->synchDisk->Flush();
+	printf("%12s %14d %20.2f", journalModeNames[journalMode],
+		(kernel->stats->totalTicks - startTicks) / numOps,
+		(double) (kernel->stats->numDiskWrites - startWrites) / numOps);
+	if (journal->NumCommits() > 0) {
+	    printf(" %16.2f\n", 
+		(double) journal->NumOps() / journal->NumCommits());
+	} else {
+	    printf(" %16s\n", "-");
+	}
+	delete journalThreadsDone;
+    }
+
+    kernel->synchDisk->Flush();		// as it was
+    delete kernel->fileSystem;
+    kernel->fileSystem = new FileSystem(FALSE, journaled);
+#endif
+}
+
+// The benchmarks that can be run with "nachos -B <name>".
+
+static struct {
+    char *name;
+    void (*run)();
+    char *description;
+} benchmarks[] = {
+    { "events", EventQueueBenchmark,
+	"interrupt event queue: SortedList vs. Heap" },
+    { "startup", StartupBenchmark,
+	"user program startup: creating and loading an address space" },
+    { "text", TextBenchmark,
+	"running many copies of a program: sharing its code, or not" },
+    { "fork", ForkBenchmark,
+	"cloning a running program: copy-on-write Fork vs. Exec" },
+    { "zero", ZeroBenchmark,
+	"loading a program: with a pool of zeroed frames, or not" },
+    { "share", ShareBenchmark,
+	"proportional share: user instructions run per ticket" },
+    { "readahead", ReadAheadBenchmark,
+	"reading a file sequentially, with read-ahead" },
+    { "disk", DiskBenchmark,
+	"disk scheduling: random reads from several threads" },
+    { "transfer", TransferBenchmark,
+	"reading the whole disk, several sectors per request" },
+    { "copy", CopyBenchmark,
+	"file system copy throughput, with the disk file mapped or not" },
+    { "largefile", LargeFileBenchmark,
+	"writing and reading a large file sequentially" },
+    { "alloc", AllocBenchmark,
+	"allocating files on a fragmented disk: by sector vs. in runs" },
+    { "files", FilesBenchmark,
+	"creating, opening and removing many files in directories" },
+    { "journal", JournalBenchmark,
+	"making file system changes durable: flushing vs. a journal" },
+};
+
+static const int NumBenchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+//----------------------------------------------------------------------
+// Benchmark
+//	Run the benchmark called "name", or list the benchmarks if there
+//	isn't one by that name.
+//----------------------------------------------------------------------
+
+void
+Benchmark(char *name)
+{
+    int i;
+
+    for (i = 0; i < NumBenchmarks; i++) {
+	if (strcmp(name, benchmarks[i].name) == 0) {
+	    cout << "Benchmark: " << benchmarks[i].description << "\n";
+	    (*benchmarks[i].run)();
+	    return;
+	}
+    }
+    cout << "Benchmarks:\n";
+    for (i = 0; i < NumBenchmarks; i++) {
+	cout << "    " << benchmarks[i].name << "\t" 
+		<< benchmarks[i].description << "\n";
+    }
+}
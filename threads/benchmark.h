@@ -0,0 +1,17 @@
+// benchmark.h 
+//	Performance benchmarks for the Nachos kernel and the hardware
+//	simulation.  Run them with "nachos -B <name>"; "nachos -B list"
+//	prints the names of the ones available.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "copyright.h"
+
+extern void Benchmark(char *name);	// run the benchmark called "name"
+
+#endif // BENCHMARK_H
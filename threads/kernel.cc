@@ -16,6 +16,9 @@
 #include "string.h"
 #include "synchconsole.h"
 #include "synchdisk.h"
+#include "swap.h"
+#include "textcache.h"
+#include "frames.h"
 #include "post.h"
 
 //----------------------------------------------------------------------
@@ -28,10 +31,24 @@ Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE; 
     debugUserProg = FALSE;
+    threadedCode = FALSE;
+    demandPaging = FALSE;
+    maxFrames = NumPhysPages;
+    shareText = TRUE;
+    zeroPoolFrames = DefaultZeroPoolFrames;
+    tlbPolicy = RandomTlbReplacement;
+    flushTlb = FALSE;
+    schedulingPolicy = RoundRobinScheduling;
+    printHistograms = FALSE;
+    cacheSectors = DefaultCacheSectors;
+    readAheadSectors = DefaultReadAheadSectors;
+    diskSchedulingPolicy = FCFSDiskScheduling;
+    mapDisk = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
+    journalFlag = TRUE;
 #endif
     reliability = 1;            // network reliability, default is 1.0
     hostName = 0;               // machine id, also UNIX socket name
@@ -45,6 +62,69 @@ Kernel::Kernel(int argc, char **argv)
 	    i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-tc") == 0) {
+            threadedCode = TRUE;
+        } else if (strcmp(argv[i], "-vm") == 0) {
+	    ASSERT(i + 1 < argc);
+	    if (!ParseReplacementPolicy(argv[i + 1], &replacementPolicy)) {
+		cerr << "Unknown page replacement policy " << argv[i + 1] 
+			<< "\n";
+		ASSERT(FALSE);
+	    }
+	    demandPaging = TRUE;
+	    i++;
+        } else if (strcmp(argv[i], "-mf") == 0) {
+	    ASSERT(i + 1 < argc);
+	    maxFrames = atoi(argv[i + 1]);
+	    ASSERT((maxFrames > 0) && (maxFrames <= NumPhysPages));
+	    i++;
+        } else if (strcmp(argv[i], "-nt") == 0) {
+	    shareText = FALSE;
+        } else if (strcmp(argv[i], "-zp") == 0) {
+	    ASSERT(i + 1 < argc);
+	    zeroPoolFrames = atoi(argv[i + 1]);
+	    ASSERT((zeroPoolFrames >= 0) && (zeroPoolFrames <= NumPhysPages));
+	    i++;
+        } else if (strcmp(argv[i], "-tr") == 0) {
+	    ASSERT(i + 1 < argc);
+	    if (!ParseTlbReplacementPolicy(argv[i + 1], &tlbPolicy)) {
+		cerr << "Unknown TLB replacement policy " << argv[i + 1] 
+			<< "\n";
+		ASSERT(FALSE);
+	    }
+	    i++;
+        } else if (strcmp(argv[i], "-tf") == 0) {
+	    flushTlb = TRUE;
+        } else if (strcmp(argv[i], "-sc") == 0) {
+	    ASSERT(i + 1 < argc);
+	    if (!ParseSchedulingPolicy(argv[i + 1], &schedulingPolicy)) {
+		cerr << "Unknown scheduling policy " << argv[i + 1] << "\n";
+		ASSERT(FALSE);
+	    }
+	    i++;
+        } else if (strcmp(argv[i], "-sh") == 0) {
+	    printHistograms = TRUE;
+        } else if (strcmp(argv[i], "-dc") == 0) {
+	    ASSERT(i + 1 < argc);
+	    cacheSectors = atoi(argv[i + 1]);
+	    ASSERT(cacheSectors >= 0);
+	    i++;
+        } else if (strcmp(argv[i], "-ra") == 0) {
+	    ASSERT(i + 1 < argc);
+	    readAheadSectors = atoi(argv[i + 1]);
+	    ASSERT(readAheadSectors >= 0);
+	    i++;
+        } else if (strcmp(argv[i], "-ds") == 0) {
+	    ASSERT(i + 1 < argc);
+	    if (!ParseDiskSchedulingPolicy(argv[i + 1], 
+					&diskSchedulingPolicy)) {
+		cerr << "Unknown disk scheduling policy " << argv[i + 1] 
+			<< "\n";
+		ASSERT(FALSE);
+	    }
+	    i++;
+        } else if (strcmp(argv[i], "-dm") == 0) {
+	    mapDisk = TRUE;
 	} else if (strcmp(argv[i], "-ci") == 0) {
 	    ASSERT(i + 1 < argc);
 	    consoleIn = argv[i + 1];
@@ -56,6 +136,8 @@ Kernel::Kernel(int argc, char **argv)
 #ifndef FILESYS_STUB
 	} else if (strcmp(argv[i], "-f") == 0) {
 	    formatFlag = TRUE;
+	} else if (strcmp(argv[i], "-nj") == 0) {
+	    journalFlag = FALSE;
 #endif
         } else if (strcmp(argv[i], "-n") == 0) {
             ASSERT(i + 1 < argc);   // next argument is float
@@ -67,10 +149,15 @@ Kernel::Kernel(int argc, char **argv)
             i++;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
-	    cout << "Partial usage: nachos [-s]\n";
+	    cout << "Partial usage: nachos [-s] [-tc]\n";
+	    cout << "Partial usage: nachos [-vm fifo|clock|lru|wsclock] [-mf #frames] [-nt] [-zp #frames]\n";
+	    cout << "Partial usage: nachos [-tr random|fifo|nru] [-tf]\n";
+	    cout << "Partial usage: nachos [-sc rr|priority|mlfq|stride|lottery] [-sh]\n";
+	    cout << "Partial usage: nachos [-dc #sectors] [-ra #sectors]\n";
+	    cout << "Partial usage: nachos [-ds fcfs|sstf|scan|clook] [-dm]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
-	    cout << "Partial usage: nachos [-nf]\n";
+	    cout << "Partial usage: nachos [-nf] [-nj]\n";
 #endif
             cout << "Partial usage: nachos [-n #] [-m #]\n";
 	}
@@ -95,19 +182,38 @@ Kernel::Initialize()
 
     stats = new Statistics();		// collect statistics
     interrupt = new Interrupt;		// start up interrupt handling
-    scheduler = new Scheduler();	// initialize the ready queue
+    scheduler = new Scheduler(schedulingPolicy, printHistograms);
+					// initialize the ready queue
     alarm = new Alarm(randomSlice);	// start up time slicing
-    machine = new Machine(debugUserProg);
+    machine = new Machine(debugUserProg, threadedCode);
+    if (machine->tlb != NULL) {
+	tlbManager = new TlbManager(tlbPolicy, flushTlb);
+    } else {
+	tlbManager = NULL;
+    }
     synchConsoleIn = new SynchConsole("stdin", consoleIn, consoleOut); // input from stdin
     synchConsoleOut = new SynchConsole("stdout",consoleIn, consoleOut); // output to stdout
     systemLock = new Lock("systemLock");
-    bitmap = new Bitmap(NumPhysPages);
-    synchDisk = new SynchDisk();    //
+    frameAllocator = new FrameAllocator(NumPhysPages, zeroPoolFrames);
+    synchDisk = new SynchDisk(cacheSectors, readAheadSectors,
+				diskSchedulingPolicy, mapDisk);
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
 #else
-    fileSystem = new FileSystem(formatFlag);
+    fileSystem = new FileSystem(formatFlag, journalFlag);
 #endif // FILESYS_STUB
+    if (demandPaging) {
+	coreMap = new CoreMap(replacementPolicy, maxFrames);
+	swapSpace = new SwapSpace();
+    } else {
+	coreMap = NULL;
+	swapSpace = NULL;
+    }
+    if (shareText) {
+	textCache = new TextCache();
+    } else {
+	textCache = NULL;
+    }
 #ifdef NETWORK
     postOfficeIn = new PostOfficeInput(10);
     postOfficeOut = new PostOfficeOutput(reliability);
@@ -131,23 +237,36 @@ Kernel::Initialize()
 
 //----------------------------------------------------------------------
 // Kernel::~Kernel
-// 	Nachos is halting.  De-allocate global data structures.
+// 	Nachos is halting.  Write back whatever is in the disk's cache,
+//	print out performance statistics, and de-allocate global data 
+//	structures.
 //----------------------------------------------------------------------
 
 Kernel::~Kernel()
 {
-    delete stats;
+    synchDisk->Flush();			// even if we're halting because we
+					// are idle: the thread that was
+					// going to sleep waits for the disk
+    scheduler->PrintHistograms();
+    stats->Print();
+
     delete scheduler;
     delete alarm;
+    delete tlbManager;
     delete machine;
     delete synchConsoleIn;
     delete synchConsoleOut;
-    delete synchDisk;
+    delete swapSpace;
+    delete coreMap;
+    delete textCache;
+    delete frameAllocator;
     delete fileSystem;
+    delete synchDisk;
 #ifdef NETWORK
     delete postOfficeIn;
     delete postOfficeOut;
 #endif
+    delete stats;			// closing files still counts ticks
     delete interrupt;
     
     Exit(0);
@@ -21,6 +21,9 @@
 #include "synchconsole.h"
 #include "synch.h"
 #include "bitmap.h"
+#include "coremap.h"
+#include "tlbmanager.h"
+#include "synchdisk.h"
 
 class PostOfficeInput;
 class PostOfficeOutput;
@@ -38,6 +41,9 @@ class PostOfficeOutput;
 //
 //};
 class SynchDisk;
+class SwapSpace;
+class TextCache;
+class FrameAllocator;
 
 class Kernel {
   public:
@@ -70,7 +76,13 @@ class Kernel {
     SynchConsole *synchConsoleOut;
     SynchDisk *synchDisk;
     FileSystem *fileSystem;     
-    Bitmap *bitmap;
+    FrameAllocator *frameAllocator;	// page frames for user programs
+    CoreMap *coreMap;		// page frames, if demand paging (else NULL)
+    SwapSpace *swapSpace;	// where evicted pages go, ditto
+    TextCache *textCache;	// code shared by programs loaded up 
+				// front, unless NULL
+    TlbManager *tlbManager;	// what is in the TLB, if the machine
+				// has one (else NULL)
     Lock *systemLock;
 #ifdef NETWORK
     PostOfficeInput *postOfficeIn;
@@ -82,11 +94,32 @@ class Kernel {
   private:
     bool randomSlice;		// enable pseudo-random time slicing
     bool debugUserProg;         // single step user program
+    bool threadedCode;          // run user programs with the
+				// threaded-code engine
+    bool demandPaging;		// load user pages only when needed
+    ReplacementPolicy replacementPolicy;
+				// how to choose a page to evict
+    int maxFrames;		// most page frames user programs can use
+    bool shareText;		// share code between copies of a program
+    int zeroPoolFrames;		// free frames to keep zeroed
+    TlbReplacementPolicy tlbPolicy;
+				// how to choose a TLB entry to replace
+    bool flushTlb;		// empty the TLB on every address space 
+				// switch, as if it had no tags
+    SchedulingPolicy schedulingPolicy;
+				// how to choose the next thread to run
+    bool printHistograms;	// print each thread's scheduling histograms
+    int cacheSectors;		// size of the disk's buffer cache
+    int readAheadSectors;	// how far ahead to read sequential files
+    DiskSchedulingPolicy diskSchedulingPolicy;
+				// how to order requests for the disk
+    bool mapDisk;		// map the disk's file into memory
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
 #ifndef FILESYS_STUB
     bool formatFlag;          // format the disk if this is true
+    bool journalFlag;		// journal file system changes (see journal.h)
 #endif
 };
 
@@ -4,10 +4,16 @@
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
 //              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
-//              -f -cp <unix file> <nachos file>
-//              -p <nachos file> -r <nachos file> -l -D
+//              -f -nj -cp <unix file> <nachos file>
+//              -p <nachos file> -r <nachos file> -mkdir <nachos dir> -l -D
 //              -n <network reliability> -m <machine id>
-//              -z -K -C -N
+//              -z -K -C -N -B <benchmark>
+//              -vm <replacement policy> -mf <#frames> -nt -zp <#frames>
+//              -sc <scheduling policy> -sh -dc <#sectors> -ra <#sectors>
+//              -ds <disk scheduling policy> -dm
+//              -np <#pages> -ps <page size> -tlb <#entries>
+//              -tr <TLB replacement policy> -tf
+//              -dg <sector size> <sectors per track> <#tracks>
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
@@ -21,13 +27,47 @@
 //    -K run a simple self test of kernel threads and synchronization
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
+//    -B run a performance benchmark (see benchmark.cc); "-B list" lists them
+//    -vm demand pages user programs, evicting pages with the given policy:
+//	fifo, clock, lru or wsclock (see coremap.h)
+//    -mf limits user programs to the given number of page frames
+//    -nt gives each copy of a program its own copy of the code, rather
+//	than sharing it with the others running (see textcache.h)
+//    -zp sets how many free page frames to keep zeroed, ready for 
+//	pages that start out zero; 0 turns it off (see frames.h)
+//    -sc chooses how to schedule threads: rr (round robin, the default),
+//	priority, mlfq (multi-level feedback queue), stride or lottery
+//	(see scheduler.h)
+//    -sh prints how long each thread waited to run, and ran, as histograms
+//    -dc sets how many sectors the disk's buffer cache holds; 0 turns
+//	it off (see synchdisk.h)
+//    -ra sets how many sectors to read ahead when a file is read
+//	sequentially; 0 turns it off
+//    -ds chooses the order in which requests waiting for the disk are
+//	served: fcfs (the default), sstf, scan or clook (see synchdisk.h)
+//    -dm maps the file that holds the disk into memory, so that disk
+//	transfers are copies rather than system calls
+//    -np sets how many pages of physical memory the machine has
+//    -ps sets the size of a page, in bytes; a power of 2, at least 4 (and,
+//	with "-vm", a multiple of the sector size)
+//    -tlb sets how many entries the machine's TLB has, if it has one
+//	(see USE_TLB in build/Makefile)
+//    -tr chooses which TLB entry to replace on a TLB miss: random (the
+//	default), fifo or nru (see tlbmanager.h)
+//    -tf empties the TLB whenever another address space runs, as if
+//	its entries weren't tagged with address space IDs
+//    -dg sets the disk's geometry; a disk made with another geometry
+//	has to be formatted again
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
+//    -nj changes the file system in place, without journaling the
+//	changes first (see journal.h)
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -r removes a Nachos file, or an empty directory, from the file system
+//    -mkdir makes a Nachos directory; files in it are named "dir/file"
+//    -l lists the contents of the Nachos root directory
 //    -D prints the contents of the entire file system 
 //
 //  Note: the file system flags are not used if the stub filesystem
@@ -44,9 +84,11 @@
 #include "main.h"
 #include "filesys.h"
 #include "openfile.h"
+#include "synchdisk.h"
 #include "sysdep.h"
 #include "hello.h"
 #include "addrspace.h"
+#include "benchmark.h"
 
 // global variables
 Kernel *kernel;
@@ -177,18 +219,21 @@ main(int argc, char **argv)
     bool threadTestFlag = false;
     bool consoleTestFlag = false;
     bool networkTestFlag = false;
+    char *benchmarkName = NULL;       // benchmark to run, if any
 #ifndef FILESYS_STUB
     char *copyUnixFileName = NULL;    // UNIX file to be copied into Nachos
     char *copyNachosFileName = NULL;  // name of copied file in Nachos
     char *printFileName = NULL; 
     char *removeFileName = NULL;
+    char *mkdirName = NULL;	      // Nachos directory to be made
     bool dirListFlag = false;
     bool dumpFlag = false;
 #endif //FILESYS_STUB
 
     // some command line arguments are handled here.
     // those that set kernel parameters are handled in
-    // the Kernel constructor
+    // the Kernel constructor; the size of the simulated 
+    // hardware is set here, since some of those depend on it
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-d") == 0) {
 	    ASSERT(i + 1 < argc);   // next argument is debug string
@@ -212,6 +257,38 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-N") == 0) {
 	    networkTestFlag = TRUE;
 	}
+	else if (strcmp(argv[i], "-B") == 0) {
+	    ASSERT(i + 1 < argc);
+	    benchmarkName = argv[i + 1];
+	    i++;
+	}
+	else if (strcmp(argv[i], "-np") == 0) {
+	    ASSERT(i + 1 < argc);
+	    NumPhysPages = atoi(argv[i + 1]);
+	    ASSERT(NumPhysPages > 0);
+	    i++;
+	}
+	else if (strcmp(argv[i], "-ps") == 0) {
+	    ASSERT(i + 1 < argc);
+	    PageSize = atoi(argv[i + 1]);
+	    ASSERT((PageSize >= 4) && ((PageSize & (PageSize - 1)) == 0));
+	    i++;
+	}
+	else if (strcmp(argv[i], "-tlb") == 0) {
+	    ASSERT(i + 1 < argc);
+	    TLBSize = atoi(argv[i + 1]);
+	    ASSERT(TLBSize > 0);
+	    i++;
+	}
+	else if (strcmp(argv[i], "-dg") == 0) {
+	    ASSERT(i + 3 < argc);
+	    SectorSize = atoi(argv[i + 1]);
+	    SectorsPerTrack = atoi(argv[i + 2]);
+	    NumTracks = atoi(argv[i + 3]);
+	    ASSERT((SectorSize > 0) && (SectorSize % sizeof(int) == 0));
+	    ASSERT((SectorsPerTrack > 0) && (NumTracks > 0));
+	    i += 3;
+	}
 #ifndef FILESYS_STUB
 	else if (strcmp(argv[i], "-cp") == 0) {
 	    ASSERT(i + 2 < argc);
@@ -229,6 +306,11 @@ main(int argc, char **argv)
 	    removeFileName = argv[i + 1];
 	    i++;
 	}
+	else if (strcmp(argv[i], "-mkdir") == 0) {
+	    ASSERT(i + 1 < argc);
+	    mkdirName = argv[i + 1];
+	    i++;
+	}
 	else if (strcmp(argv[i], "-l") == 0) {
 	    dirListFlag = true;
 	}
@@ -239,11 +321,13 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
             cout << "Partial usage: nachos [-x programName]\n";
-	    cout << "Partial usage: nachos [-K] [-C] [-N]\n";
+	    cout << "Partial usage: nachos [-K] [-C] [-N] [-B benchmark]\n";
+	    cout << "Partial usage: nachos [-np #pages] [-ps pageSize] [-tlb #entries]\n";
+	    cout << "Partial usage: nachos [-dg sectorSize sectorsPerTrack #tracks]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
-            cout << "Partial usage: nachos [-l] [-D]\n";
+            cout << "Partial usage: nachos [-mkdir dirName] [-l] [-D]\n";
 #endif //FILESYS_STUB
 	}
 	else if (strcmp(argv[i], "-hello") == 0) {
@@ -278,11 +362,18 @@ main(int argc, char **argv)
       kernel->NetworkTest();   // two-machine test of the network
     }
 #endif
+    if (benchmarkName != NULL) {
+      Benchmark(benchmarkName);	// time some part of the system
+      kernel->interrupt->Halt();	// and print the statistics
+    }
 
 #ifndef FILESYS_STUB
     if (removeFileName != NULL) {
       kernel->fileSystem->Remove(removeFileName);
     }
+    if (mkdirName != NULL) {
+      kernel->fileSystem->Mkdir(mkdirName);
+    }
     if (copyUnixFileName != NULL && copyNachosFileName != NULL) {
       Copy(copyUnixFileName,copyNachosFileName);
     }
@@ -295,6 +386,8 @@ main(int argc, char **argv)
     if (printFileName != NULL) {
       Print(printFileName);
     }
+    kernel->synchDisk->Flush();	// in case we're killed before the
+				// changes would be written back
 #endif // FILESYS_STUB
 
     // finally, run an initial user program if requested to do so
@@ -11,8 +11,11 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	The policy for choosing the next thread is picked when Nachos
+//	starts (see "-sc" in main.cc): round robin (the original, straight
+//	FIFO), strict priority, a multi-level feedback queue, or stride
+//	or lottery proportional-share scheduling.  The timer only 
+//	preempts a thread when the policy says so; see ShouldPreempt.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -23,15 +26,99 @@
 #include "scheduler.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// ParseSchedulingPolicy
+// 	Look up a scheduling policy by name, for the "-sc" flag.
+//
+//	"name" -- "rr", "priority", "mlfq", "stride" or "lottery"
+//	"policy" -- where to store the policy, if the name is known
+//----------------------------------------------------------------------
+
+bool
+ParseSchedulingPolicy(char *name, SchedulingPolicy *policy)
+{
+    if (strcmp(name, "rr") == 0) {
+	*policy = RoundRobinScheduling;
+    } else if (strcmp(name, "priority") == 0) {
+	*policy = PriorityScheduling;
+    } else if (strcmp(name, "mlfq") == 0) {
+	*policy = MlfqScheduling;
+    } else if (strcmp(name, "stride") == 0) {
+	*policy = StrideScheduling;
+    } else if (strcmp(name, "lottery") == 0) {
+	*policy = LotteryScheduling;
+    } else {
+	return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// PriorityCompare
+// 	Order two threads on the priority list, highest priority first.
+//	SortedList puts a thread after any others of the same priority,
+//	so they take turns.
+//----------------------------------------------------------------------
+
+static int
+PriorityCompare(Thread *x, Thread *y)
+{
+    if (x->getPriority() > y->getPriority()) { return -1; }
+    else if (x->getPriority() < y->getPriority()) { return 1; }
+    else { return 0; }
+}
+
+//----------------------------------------------------------------------
+// PassCompare
+// 	Order two threads for stride scheduling, lowest pass first.
+//----------------------------------------------------------------------
+
+static int
+PassCompare(Thread *x, Thread *y)
+{
+    if (x->pass < y->pass) { return -1; }
+    else if (x->pass > y->pass) { return 1; }
+    else { return 0; }
+}
+
+//----------------------------------------------------------------------
+// MlfqQuantum
+// 	How long a thread can run at a level of the feedback queue before
+//	it drops to the next one: one timer interrupt's worth at level 0,
+//	doubling at each level down.
+//----------------------------------------------------------------------
+
+static int
+MlfqQuantum(int level)
+{
+    return TimerTicks << level;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
 //	Initially, no ready threads.
+//
+//	"policy" -- how to choose the next thread to run
+//	"printHistograms" -- if set, print each thread's wait and run
+//		time histograms when it finishes, and at halt
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulingPolicy policy, bool printHistograms)
 { 
-    readyList = new List<Thread *>; 
+    this->policy = policy;
+    this->printHistograms = printHistograms;
+    for (int i = 0; i < NumMlfqLevels; i++) {
+	readyList[i] = new List<Thread *>; 
+    }
+    if (policy == StrideScheduling) {
+	sortedList = new SortedList<Thread *>(PassCompare);
+    } else {
+	sortedList = new SortedList<Thread *>(PriorityCompare);
+    }
+    lastBoost = 0;
+    boostEpoch = 0;
+    lastPass = 0;
     toBeDestroyed = NULL;
 } 
 
@@ -42,10 +129,16 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 { 
-    while ( !readyList->IsEmpty() ) {
-        delete readyList->RemoveFront() ;
+    for (int i = 0; i < NumMlfqLevels; i++) {
+	while (!readyList[i]->IsEmpty()) {
+	    delete readyList[i]->RemoveFront();
+	}
+	delete readyList[i]; 
     }
-    delete readyList; 
+    while (!sortedList->IsEmpty()) {
+	delete sortedList->RemoveFront();
+    }
+    delete sortedList;
 } 
 
 //----------------------------------------------------------------------
@@ -53,22 +146,60 @@ Scheduler::~Scheduler()
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
 //
+//	If an interrupt handler has just woken up a thread that should
+//	run before the interrupted one, switch to it as soon as the 
+//	handler returns, rather than waiting for the timer.
+//
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
 
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
-    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    Interrupt *interrupt = kernel->interrupt;
+
+    ASSERT(interrupt->getLevel() == IntOff);
     //DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
 
     thread->setStatus(READY);
-    readyList->Append(thread);
+    thread->readySince = kernel->stats->totalTicks;
+    switch (policy) {
+      case RoundRobinScheduling:
+      case LotteryScheduling:
+	readyList[0]->Append(thread);
+	break;
+      case PriorityScheduling:
+	sortedList->Insert(thread);
+	break;
+      case StrideScheduling:
+	if (thread->pass < lastPass) {	// don't let a thread that has 
+	    thread->pass = lastPass;	// been asleep catch up all at once
+	}
+	sortedList->Insert(thread);
+	break;
+      case MlfqScheduling:
+	if (thread->boostEpoch != boostEpoch) {	// blocked during a boost
+	    thread->level = 0;
+	    thread->boostEpoch = boostEpoch;
+	}
+	readyList[thread->level]->Append(thread);
+	break;
+      default:
+	ASSERTNOTREACHED();
+    }
+
+    if (interrupt->InHandler() && (interrupt->getStatus() != IdleMode) &&
+		Precedes(thread, kernel->currentThread)) {
+	interrupt->YieldOnReturn();
+    }
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-// 	Return the next thread to be scheduled onto the CPU.
+// 	Return the next thread to be scheduled onto the CPU: the one
+//	at the front of the ready list, or with the feedback queue, of 
+//	the highest level that has any threads, or with a lottery, the
+//	winner.
 //	If there are no ready threads, return NULL.
 // Side effect:
 //	Thread is removed from the ready list.
@@ -77,13 +208,49 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
+    Thread *thread;
+
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
-    if (readyList->IsEmpty()) {
-	return NULL;
-    } else {
-    	return readyList->RemoveFront();
+    if ((policy == PriorityScheduling) || (policy == StrideScheduling)) {
+	if (sortedList->IsEmpty()) {
+	    return NULL;
+	}
+	thread = sortedList->RemoveFront();
+	lastPass = thread->pass;
+	return thread;
+    }
+    if (policy == LotteryScheduling) {
+	return DrawLottery();
+    }
+    if (policy == MlfqScheduling) {
+	CheckBoost();
     }
+    for (int i = 0; i < NumMlfqLevels; i++) {
+	if (!readyList[i]->IsEmpty()) {
+	    return readyList[i]->RemoveFront();
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::IsEmpty
+// 	Return TRUE if there are no threads ready to run.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::IsEmpty()
+{
+    if ((policy == PriorityScheduling) || (policy == StrideScheduling)) {
+	return sortedList->IsEmpty();
+    }
+    for (int i = 0; i < NumMlfqLevels; i++) {
+	if (!readyList[i]->IsEmpty()) {
+	    return FALSE;
+	}
+    }
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -125,6 +292,13 @@ Scheduler::Run (Thread *nextThread, bool finishing)
 
     kernel->currentThread = nextThread;  // switch to the next thread
     nextThread->setStatus(RUNNING);      // nextThread is now running
+    oldThread->runTimes.Add(oldThread->chargedSince - 
+					oldThread->runningSince);
+    nextThread->waitTimes.Add(kernel->stats->totalTicks - 
+					nextThread->readySince);
+    nextThread->runningSince = kernel->stats->totalTicks;
+    nextThread->chargedSince = kernel->stats->totalTicks;
+    nextThread->userTicksSince = kernel->stats->userTicks;
     
     //DEBUG(dbgThread, "Switching from: " << oldThread->getName() << " to: " << nextThread->getName());
     
@@ -152,6 +326,171 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     }
 }
 
+//----------------------------------------------------------------------
+// Scheduler::StopRunning
+// 	The current thread is about to give up the CPU, to sleep, to
+//	finish, or to let another thread run.  Charge it for the time 
+//	it has run since it was last charged; Run records the whole
+//	turn, once another thread really does run (when the thread 
+//	yields, the scheduler may pick it again, and then its turn 
+//	just goes on).
+//
+//	With the feedback queue, a thread that used up the whole quantum
+//	for its level this turn drops to the next level; one that gave
+//	up the CPU sooner (say, to wait for I/O) stays where it is.
+//	With stride scheduling, the thread's pass goes up by the time
+//	it ran, divided by its tickets.
+//
+//	"thread" is the thread giving up the CPU.
+//----------------------------------------------------------------------
+
+void
+Scheduler::StopRunning(Thread *thread)
+{
+    int ran = kernel->stats->totalTicks - thread->chargedSince;
+    int turn = kernel->stats->totalTicks - thread->runningSince;
+
+    ASSERT(thread == kernel->currentThread);
+    thread->chargedSince = kernel->stats->totalTicks;
+    thread->userTicks += kernel->stats->userTicks - thread->userTicksSince;
+    thread->userTicksSince = kernel->stats->userTicks;
+    if (policy == StrideScheduling) {
+	thread->pass += (double) ran / thread->getTickets();
+    }
+    if ((policy == MlfqScheduling) && (turn >= MlfqQuantum(thread->level))
+		&& (thread->level < NumMlfqLevels - 1)) {
+	thread->level++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ShouldPreempt
+// 	Called from the timer interrupt handler, to decide whether the
+//	interrupted thread should give up the CPU:
+//	  round robin, stride and lottery -- always
+//	  priority -- if there's a ready thread of the same or higher
+//		priority
+//	  feedback queue -- if there's a ready thread at a higher level,
+//		or the thread has used up its quantum for this turn
+//----------------------------------------------------------------------
+
+bool
+Scheduler::ShouldPreempt()
+{
+    Thread *current = kernel->currentThread;
+
+    switch (policy) {
+      case RoundRobinScheduling:
+      case StrideScheduling:
+      case LotteryScheduling:
+	return TRUE;
+      case PriorityScheduling:
+	return !sortedList->IsEmpty() && 
+		(sortedList->Front()->getPriority() >= current->getPriority());
+      case MlfqScheduling:
+	CheckBoost();
+	for (int i = 0; i < current->level; i++) {
+	    if (!readyList[i]->IsEmpty()) {
+		return TRUE;
+	    }
+	}
+	return kernel->stats->totalTicks - current->runningSince >= 
+			MlfqQuantum(current->level);
+      default:
+	ASSERTNOTREACHED();
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Precedes
+// 	Return TRUE if thread "x" should run before thread "y" (not
+//	just after it, as when they take turns).
+//----------------------------------------------------------------------
+
+bool
+Scheduler::Precedes(Thread *x, Thread *y)
+{
+    switch (policy) {
+      case PriorityScheduling:
+	return x->getPriority() > y->getPriority();
+      case MlfqScheduling:
+	return x->level < y->level;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::DrawLottery
+// 	Choose the next thread at random, with each ready thread's 
+//	chance in proportion to its tickets, and take it off the ready 
+//	list.  Return NULL if no threads are ready.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::DrawLottery()
+{
+    List<Thread *> *list = readyList[0];
+    int total = 0, winner;
+    Thread *thread = NULL;
+
+    if (list->IsEmpty()) {
+	return NULL;
+    }
+    ListIterator<Thread *> count(list);
+    for (; !count.IsDone(); count.Next()) {
+	total += count.Item()->getTickets();
+    }
+    ASSERT(total > 0);			// at most MaxTickets each
+    winner = RandomNumber() % total;
+    ListIterator<Thread *> iter(list);
+    for (; !iter.IsDone(); iter.Next()) {
+	thread = iter.Item();
+	winner -= thread->getTickets();
+	if (winner < 0) {
+	    break;
+	}
+    }
+    list->Remove(thread);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::CheckBoost
+// 	With the feedback queue, if MlfqBoostInterval ticks have passed 
+//	since the last boost, move every thread back to level 0.  Ready
+//	threads (and the running one) move now; threads that are blocked
+//	move when they are next made ready, by noticing that they missed
+//	a boost.
+//----------------------------------------------------------------------
+
+void
+Scheduler::CheckBoost()
+{
+    Thread *thread;
+
+    if (kernel->stats->totalTicks - lastBoost < MlfqBoostInterval) {
+	return;
+    }
+    lastBoost = kernel->stats->totalTicks;
+    boostEpoch++;
+    for (int i = 1; i < NumMlfqLevels; i++) {
+	while (!readyList[i]->IsEmpty()) {
+	    readyList[0]->Append(readyList[i]->RemoveFront());
+	}
+    }
+    ListIterator<Thread *> iter(readyList[0]);
+    for (; !iter.IsDone(); iter.Next()) {
+	thread = iter.Item();
+	thread->level = 0;
+	thread->boostEpoch = boostEpoch;
+    }
+    thread = kernel->currentThread;
+    thread->level = 0;
+    thread->boostEpoch = boostEpoch;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::CheckToBeDestroyed
 // 	If the old thread gave up the processor because it was finishing,
@@ -164,6 +503,9 @@ void
 Scheduler::CheckToBeDestroyed()
 {
     if (toBeDestroyed != NULL) {
+	if (printHistograms) {
+	    toBeDestroyed->PrintHistograms();
+	}
         delete toBeDestroyed;
 	toBeDestroyed = NULL;
     }
@@ -178,5 +520,38 @@ void
 Scheduler::Print()
 {
     cout << "Ready list contents:\n";
-    readyList->Apply(ThreadPrint);
+    for (int i = 0; i < NumMlfqLevels; i++) {
+	readyList[i]->Apply(ThreadPrint);
+    }
+    sortedList->Apply(ThreadPrint);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PrintHistograms
+// 	If we were asked to, print the histograms of the threads that
+//	are still around -- the running thread and the ready ones -- as
+//	Nachos halts.  (Threads that have finished printed theirs then.)
+//	The running thread's last turn is counted as if it were over.
+//----------------------------------------------------------------------
+
+void
+Scheduler::PrintHistograms()
+{
+    if (!printHistograms) {
+	return;
+    }
+    StopRunning(kernel->currentThread);
+    kernel->currentThread->runTimes.Add(kernel->currentThread->chargedSince
+				- kernel->currentThread->runningSince);
+    kernel->currentThread->PrintHistograms();
+    for (int i = 0; i < NumMlfqLevels; i++) {
+	ListIterator<Thread *> iter(readyList[i]);
+	for (; !iter.IsDone(); iter.Next()) {
+	    iter.Item()->PrintHistograms();
+	}
+    }
+    ListIterator<Thread *> iter(sortedList);
+    for (; !iter.IsDone(); iter.Next()) {
+	iter.Item()->PrintHistograms();
+    }
 }
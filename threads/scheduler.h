@@ -12,33 +12,100 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "stats.h"
+
+// The scheduling policies.
+//	RoundRobinScheduling -- one FIFO ready list; the running thread
+//		is preempted at every timer interrupt
+//	PriorityScheduling -- always run the ready thread with the
+//		highest priority (see Thread::setPriority); threads of 
+//		equal priority take turns, round robin
+//	MlfqScheduling -- multi-level feedback queue: threads start at
+//		level 0, and drop a level each time they run for the
+//		whole quantum for their level, so that threads which 
+//		mostly wait for I/O stay ahead of ones that compute.  Lower levels 
+//		get longer quanta.  Every MlfqBoostInterval ticks, 
+//		everyone goes back to level 0, so nothing starves.
+//	StrideScheduling -- proportional share: each thread gets CPU 
+//		time in proportion to its tickets (see Thread::setTickets).
+//		A thread's "pass" goes up by the ticks it runs divided 
+//		by its tickets, and the ready thread with the lowest 
+//		pass runs next.
+//	LotteryScheduling -- proportional share by chance: at each 
+//		turn, the next thread is drawn at random, weighted by
+//		tickets.  Right on average, but not over short periods.
+
+enum SchedulingPolicy { RoundRobinScheduling, PriorityScheduling,
+			MlfqScheduling, StrideScheduling, 
+			LotteryScheduling };
+
+const int NumMlfqLevels = 4;
+const int MlfqBoostInterval = 100 * TimerTicks;
+
+extern bool ParseSchedulingPolicy(char *name, SchedulingPolicy *policy);
+					// Convert "rr", "priority", "mlfq",
+					// "stride" or "lottery" to a policy;
+					// return FALSE if the name is unknown
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
+//
+// It also keeps, for each thread, a histogram of how long the thread 
+// waited on the ready list each time, and one of how long it then
+// ran before giving up the CPU, and a count of the user instructions
+// it has executed.
 
 class Scheduler {
   public:
-    Scheduler();		// Initialize list of ready threads 
+    Scheduler(SchedulingPolicy policy, bool printHistograms);
+				// Initialize list of ready threads; if
+				// "printHistograms", print each thread's
+				// histograms when it finishes
     ~Scheduler();		// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	
     				// Thread can be dispatched.
-    Thread* FindNextToRun();	// Dequeue first thread on the ready 
-				// list, if any, and return thread.
+    Thread* FindNextToRun();	// Dequeue the thread that should run
+				// next, if any, and return thread.
+    bool IsEmpty();		// Are no threads ready to run?
     void Run(Thread* nextThread, bool finishing);
     				// Cause nextThread to start running
+    void StopRunning(Thread *thread);
+				// The current thread is giving up the
+				// CPU; charge it for the time it ran
+    bool ShouldPreempt();	// Called at each timer interrupt: should
+				// the current thread give up the CPU?
     void CheckToBeDestroyed();// Check if thread that had been
     				// running needs to be deleted
     void Print();		// Print contents of ready list
+    void PrintHistograms();	// Print the histograms of the threads 
+				// that haven't finished, if asked to
     
     // SelfTest for scheduler is implemented in class Thread
     
   private:
-    List<Thread *> *readyList;  // queue of threads that are ready to run,
-				// but not running
+    SchedulingPolicy policy;	// how to choose the next thread
+    bool printHistograms;	// print each thread's histograms?
+    List<Thread *> *readyList[NumMlfqLevels];
+				// queues of threads that are ready to run,
+				// but not running; all but MlfqScheduling
+				// use only readyList[0]
+    SortedList<Thread *> *sortedList;
+				// PriorityScheduling and StrideScheduling
+				// use this instead, in the order the 
+				// threads should run
+    int lastBoost;		// MlfqScheduling: when everyone last went
+    int boostEpoch;		// back to level 0, and how many times
+    double lastPass;		// StrideScheduling: the pass of the thread
+				// that was chosen last
     Thread *toBeDestroyed;	// finishing thread to be destroyed
     				// by the next thread that runs
+
+    bool Precedes(Thread *x, Thread *y);
+				// Should "x" run before "y"?
+    Thread *DrawLottery();	// LotteryScheduling: pick the next thread
+    void CheckBoost();		// MlfqScheduling: boost if it is time
 };
 
 #endif // SCHEDULER_H
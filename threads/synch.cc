@@ -75,7 +75,7 @@ Semaphore::P()
     
     while (value == 0) { 			// semaphore not available
 	queue->Append((void *)kernel->currentThread);	// so go to sleep
-	kernel->currentThread->Sleep();
+	kernel->currentThread->Sleep(FALSE);
     } 
     value--; 					// semaphore available, 
 						// consume its value
@@ -24,7 +24,7 @@ Bitmap *bitmap;
 Lock *systemLock;
 //Table   *threadTable;
 SynchConsole *systemConsole;
-char systemBuffer[SystemBufferSize];
+char *systemBuffer;
 Lock *systemBufferLock;
 //#endif
 
@@ -141,7 +141,8 @@ Initialize(int argc, char **argv)
     DebugInit(debugArgs);			// initialize //DEBUG messages
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
-    scheduler = new Scheduler();		// initialize the ready queue
+    scheduler = new Scheduler(RoundRobinScheduling, FALSE);
+					// initialize the ready queue
     if (randomYield)				// start the timer (if needed)
 	timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
@@ -161,9 +162,10 @@ Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
     
 //#if defined(CHANGED) && defined(USER_PROGRAM)
-    machine = new Machine(debugUserProg);	// this must come first
+    machine = new Machine(debugUserProg, FALSE);	// this must come first
     bitmap = new Bitmap(NumPhysPages);
     systemLock = new Lock("systemLock");
+    systemBuffer = new char[SystemBufferSize];
     systemBufferLock = new Lock("system buffer"); 
 //#endif
 
@@ -46,7 +46,7 @@ extern SynchConsole *systemConsole;
 
 
 #define SystemBufferSize (PageSize * 4)
-extern char systemBuffer[SystemBufferSize];
+extern char *systemBuffer;
 extern Lock *systemBufferLock;
 //#endif
 
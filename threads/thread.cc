@@ -22,6 +22,7 @@
 #include "kernel.h"
 #include "main.h"
 #include "machine.h"
+#include "frames.h"
 #include "stdio.h"
 
 #define STACK_FENCEPOST 0xdeadbeef	// this is put at the top of the
@@ -90,6 +91,11 @@ Thread::CreateFile(char *fn) {
   return(space->CreateFile(fn));
 }
 
+bool
+Thread::RemoveFile(char *fn) {
+  return(space->RemoveFile(fn));
+}
+
 int
 Thread::OpenReadWriteFile(char *fn) {
   return(space->OpenReadWriteFile(fn));
@@ -104,10 +110,15 @@ int
 Thread::WriteOpenFile(int fd, int svaddr, int size) {
   return(space->WriteOpenFile(fd, svaddr, size));
 }
+
+bool
+Thread::SeekOpenFile(int fd, int position) {
+  return(space->SeekOpenFile(fd, position));
+}
  
-void
+bool
 Thread::CloseOpenFile(int fd) { 
-  space->CloseOpenFile(fd);
+  return(space->CloseOpenFile(fd));
 }
 
 int 
@@ -138,9 +149,19 @@ Thread::Thread(char* threadName)
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+    priority = 0;
+    tickets = DefaultTickets;
 //#ifdef USER_PROGRAM
     space = NULL;
 //#endif
+    level = 0;
+    boostEpoch = 0;
+    readySince = 0;
+    runningSince = 0;
+    chargedSince = 0;
+    pass = 0;
+    userTicks = 0;
+    userTicksSince = 0;
 }
 
 //----------------------------------------------------------------------
@@ -249,15 +270,18 @@ Thread::Finish ()
     //DEBUG('t', "Finishing thread \"%s\"\n", getName());
     
     threadToBeDestroyed = kernel->currentThread;
-    Sleep();					// invokes SWITCH
+    Sleep(TRUE);				// invokes SWITCH
     // not reached
 }
 
 //----------------------------------------------------------------------
 // Thread::Yield
 // 	Relinquish the CPU if any other thread is ready to run.
-//	If so, put the thread on the end of the ready list, so that
-//	it will eventually be re-scheduled.
+//	If so, put the thread back on the ready list, so that it will 
+//	eventually be re-scheduled, and run the thread the scheduler
+//	picks (with round robin scheduling, the one at the front of
+//	the list; with priorities, possibly this one again, in which
+//	case it just carries on, as if it hadn't yielded).
 //
 //	NOTE: returns immediately if no other thread on the ready queue.
 //	Otherwise returns when the thread eventually works its way
@@ -281,10 +305,15 @@ Thread::Yield ()
     
     //DEBUG('t', "Yielding thread \"%s\"\n", getName());
     
-    nextThread = kernel->scheduler->FindNextToRun();
-    if (nextThread != NULL) {
+    if (!kernel->scheduler->IsEmpty()) {
+	kernel->scheduler->StopRunning(this);
 	kernel->scheduler->ReadyToRun(this);
-	kernel->scheduler->Run(nextThread, true);
+	nextThread = kernel->scheduler->FindNextToRun();
+	if (nextThread == this) {	// the scheduler prefers us still,
+	    status = RUNNING;		// so just carry on with this turn
+	} else {
+	    kernel->scheduler->Run(nextThread, FALSE);
+	}
     }
     (void) kernel->interrupt->SetLevel(oldLevel);
 }
@@ -300,16 +329,21 @@ Thread::Yield ()
 //	we have no thread to run.  "Interrupt::Idle" is called
 //	to signify that we should idle the CPU until the next I/O kernel->interrupt
 //	occurs (the only thing that could cause a thread to become
-//	ready to run).
+//	ready to run).  Meanwhile, zero some free page frames, so that
+//	they are ready when a user program needs a page that starts out
+//	zero.
 //
 //	NOTE: we assume kernel->interrupts are already disabled, because it
 //	is called from the synchronization routines which must
 //	disable kernel->interrupts for atomicity.   We need kernel->interrupts off 
 //	so that there can't be a time slice between pulling the first thread
 //	off the ready list, and switching to it.
+//
+//	"finishing" is set if the thread is done, and should be deleted
+//	once the next thread is running (see Thread::Finish)
 //----------------------------------------------------------------------
 void
-Thread::Sleep ()
+Thread::Sleep (bool finishing)
 {
     Thread *nextThread;
     
@@ -319,10 +353,28 @@ Thread::Sleep ()
     //DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
     status = BLOCKED;
-    while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL)
+    kernel->scheduler->StopRunning(this);
+    while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL) {
+	kernel->frameAllocator->ZeroIdleFrames();	// while there's time
 	kernel->interrupt->Idle();	// no one to run, wait for an kernel->interrupt
+    }
         
-    kernel->scheduler->Run(nextThread, true); // returns when we've been signalled
+    kernel->scheduler->Run(nextThread, finishing);
+					// returns when we've been signalled
+}
+
+//----------------------------------------------------------------------
+// Thread::PrintHistograms
+// 	Print how long the thread waited on the ready list each time 
+//	it was made ready, and how long it ran each time it was chosen.
+//----------------------------------------------------------------------
+
+void
+Thread::PrintHistograms()
+{
+    printf("Thread \"%s\":\n", name);
+    waitTimes.Print("  ticks waiting to run");
+    runTimes.Print("  ticks running");
 }
 
 //----------------------------------------------------------------------
@@ -335,7 +387,7 @@ Thread::Sleep ()
 
 static void ThreadFinish()    { kernel->currentThread->Finish(); }
 static void InterruptEnable() { kernel->interrupt->Enable(); }
-void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
+void ThreadPrint(Thread *t) { t->Print(); }
 
 //----------------------------------------------------------------------
 // Thread::StackAllocate
@@ -39,6 +39,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "histogram.h"
 //#if defined(CHANGED) && defined(USER_PROGRAM)
 #include "synch.h"
 //#endif
@@ -61,12 +62,19 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(4 * 1024)	// in words
 
+// A thread's share of the CPU under proportional-share scheduling, 
+// until it is given some other number of tickets.  No thread may have
+// more than MaxTickets, so that the lottery's total can't overflow.
+const int DefaultTickets = 100;
+const int MaxTickets = 10000;
+
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
 // external function, dummy routine whose sole job is to call Thread::Print
-extern void ThreadPrint(int arg);	 
+class Thread;
+extern void ThreadPrint(Thread *thread);
 
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
@@ -103,7 +111,7 @@ class Thread {
     void Fork(VoidFunctionPtr func, int arg); 	// Make thread run (*func)(arg)
     void Yield();  				// Relinquish the CPU if any 
 						// other thread is runnable
-    void Sleep();  				// Put the thread to sleep and 
+    void Sleep(bool finishing);		// Put the thread to sleep and 
 						// relinquish the processor
     void Finish();  				// The thread is done executing
     
@@ -111,7 +119,13 @@ class Thread {
 						// overflowed its stack
     void setStatus(ThreadStatus st) { status = st; }
     char* getName() { return (name); }
+    void setPriority(int p) { priority = p; }
+    int getPriority() { return (priority); }
+    void setTickets(int t) { ASSERT(t > 0 && t <= MaxTickets); tickets = t; }
+    int getTickets() { return (tickets); }
     void Print() { printf("%s, ", name); }
+    void PrintHistograms();		// Print how long the thread has 
+					// waited to run, and then run
 
     void SelfTest();
 //#if defined(CHANGED) && defined(USER_PROGRAM)
@@ -121,10 +135,12 @@ class Thread {
     void Kill(int which, int type, int ev, Lock *l);
 
     bool CreateFile(char *fn);
+    bool RemoveFile(char *fn);
     int OpenReadWriteFile(char *fn);
     int ReadOpenFile(int fd, int svaddr, int size);
     int WriteOpenFile(int fd, int svaddr, int size);
-    void CloseOpenFile(int fd);
+    bool SeekOpenFile(int fd, int position);
+    bool CloseOpenFile(int fd);
 
     int ReadConsole(int b, int size);
     int WriteConsole(int b, int size);
@@ -145,6 +161,11 @@ class Thread {
 					// (If NULL, don't deallocate stack)
     ThreadStatus status;		// ready, running or blocked
     char* name;
+    int priority;			// for PriorityScheduling; the
+					// higher, the sooner it runs
+    int tickets;			// for StrideScheduling and 
+					// LotteryScheduling: its share
+					// of the CPU
 
     void StackAllocate(VoidFunctionPtr func, int arg);
     					// Allocate a stack for thread.
@@ -164,6 +185,21 @@ class Thread {
     AddrSpace *space;			// User code this thread is running.
 //#endif
 
+// Bookkeeping for the scheduler (see scheduler.cc).
+
+    int level;				// MlfqScheduling: which queue
+    int boostEpoch;			// the last boost it took part in
+    int readySince;			// when it was last made ready
+    int runningSince;			// when it last started running
+    int chargedSince;			// when the time it has run was last
+					// charged to it (see StopRunning)
+    Histogram waitTimes;		// how long it waited each time
+    Histogram runTimes;			// how long it ran each time
+    double pass;			// StrideScheduling: virtual time
+    int userTicks;			// user instructions it has run
+    int userTicksSince;			// stats->userTicks when it last
+					// started running
+
 
 
 };
@@ -22,9 +22,17 @@
 #include "noff.h"
 #include "exception.h"
 #include "bitmap.h"
+#include "coremap.h"
+#include "swap.h"
+#include "textcache.h"
+#include "frames.h"
+#include "tlbmanager.h"
 
 extern Bitmap *bitmap;
 
+int AddrSpace::numSpaces = 0;
+int AddrSpace::nextId = 1;
+
 //----------------------------------------------------------------------
 // SwapHeader
 // 	Do little endian to big endian conversion on the bytes in the 
@@ -71,17 +79,60 @@ SwapHeader (NoffHeader *noffH)
 
 AddrSpace::AddrSpace()
 {
-	return;
+    pageTable = NULL;
+    numPages = 0;
+    demandPaged = FALSE;
+    executable = NULL;
+    swapSlot = NULL;
+    text = NULL;
+    copyOnWrite = NULL;
+    id = nextId++;
+    for (int i = 0; i < MaxOpenFiles; i++) {
+	openFiles[i] = NULL;
+    }
+    numSpaces++;
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space, giving back its page frames (and
+//	if it was demand paged, its swap slots), and closing the files
+//	it still has open.  Frames shared with other address spaces 
+//	stay in use until the last of them lets go.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-   delete pageTable;
+    if (kernel->tlbManager != NULL) {
+	kernel->tlbManager->InvalidateSpace(this);
+    }
+    for (int i = 0; i < MaxOpenFiles; i++) {
+	delete openFiles[i];
+    }
+    if (demandPaged) {
+	kernel->coreMap->Acquire();
+	for (int i = 0; i < numPages; i++) {
+	    if (pageTable[i].valid) {
+		kernel->coreMap->FreeFrame(pageTable[i].physicalPage);
+	    }
+	    if (swapSlot[i] != -1) {
+		kernel->swapSpace->Free(swapSlot[i]);
+	    }
+	}
+	kernel->coreMap->Release();
+	delete [] swapSlot;
+    } else {
+	for (int i = 0; i < numPages; i++) {
+	    kernel->frameAllocator->Free(pageTable[i].physicalPage);
+	}
+	if (text != NULL) {
+	    kernel->textCache->Release(text);
+	}
+	delete [] copyOnWrite;
+    }
+    delete executable;
+    delete [] pageTable;
+    numSpaces--;
 }
 
 
@@ -89,8 +140,23 @@ AddrSpace::~AddrSpace()
 // AddrSpace::Load
 // 	Load a user program into memory from a file.
 //
-//	Assumes that the page table has been initialized, and that
-//	the object code file is in NOFF format.
+//	Assumes that the object code file is in NOFF format.
+//
+//	Each page gets a frame of its own, and the segments are read 
+//	from the file directly into those frames; only the parts of 
+//	the address space that aren't in the file are zeroed.
+//
+//	The exception is the pages that hold nothing but code, which 
+//	are read-only.  If another address space is running the same
+//	program, we use the frames its code is in (see textcache.h), 
+//	and don't read those pages at all.  Otherwise, ours are shared
+//	with the copies loaded after us, and the executable stays open 
+//	as long as any of them is running.
+//
+//	If we are demand paging (the "-vm" flag), nothing is read in 
+//	yet: every page starts out invalid, and is brought in by 
+//	PageFault the first time it is used.  The executable stays open 
+//	until then.
 //
 //	"fileName" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
@@ -98,10 +164,10 @@ AddrSpace::~AddrSpace()
 bool 
 AddrSpace::Load(char *fileName) 
 {
-    OpenFile *executable = kernel->fileSystem->Open(fileName);
-    NoffHeader noffH;
     unsigned int size;
 
+    executable = kernel->fileSystem->Open(fileName);
+
     if ((int)executable == (int)NULL) {
 	cerr << "Unable to open file " << fileName << "\n";
 	return FALSE;
@@ -128,52 +194,246 @@ AddrSpace::Load(char *fileName)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
-
-    cout << "Asserted " << numPages << " <= " << NumPhysPages << endl;
-    //DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
+    demandPaged = (kernel->coreMap != NULL);
+    if (demandPaged) {
+	pageTable = new TranslationEntry[numPages];
+	swapSlot = new int[numPages];
+	for (int i = 0; i < numPages; i++) {
+	    pageTable[i].virtualPage = i;
+	    pageTable[i].physicalPage = -1;
+	    pageTable[i].valid = FALSE;
+	    pageTable[i].use = FALSE;
+	    pageTable[i].dirty = FALSE;
+	    pageTable[i].readOnly = FALSE;
+	    swapSlot[i] = -1;
+	}
+	return TRUE;
+    }
 
-    pageTable = new TranslationEntry[size];
-    for (int i = 0; i < size; i++) {
-	pageTable[i].virtualPage = i;	// for now, virt page # = phys page #
-	pageTable[i].physicalPage = kernel->bitmap->FindAndSet();
+    if (kernel->textCache != NULL) {
+	text = kernel->textCache->Find(executable, &noffH.code);
+    }
+    if (numPages - ((text != NULL) ? text->numPages : 0) > 
+			kernel->frameAllocator->NumFree()) {	// without "-vm",
+	cerr << "Not enough memory to load " << fileName << "\n";
+	if (text != NULL) {			// the whole program has 
+	    kernel->textCache->Release(text);	// to fit in memory
+	    text = NULL;
+	}
+	numPages = 0;
+	return FALSE;
+    }
+    DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
+
+// pages to be read in get frames in a row where possible, so that
+// ReadSegment can read them together; pages past the segments get
+// frames that are zero already
+    int zeroPage = FirstZeroPage(), frame = -1, run = 0;
+
+    pageTable = new TranslationEntry[numPages];
+    for (int i = 0; i < numPages; i++) {
+	pageTable[i].virtualPage = i;
+	if (IsSharedText(i)) {
+	    pageTable[i].physicalPage = text->frames[i - text->firstPage];
+	    kernel->frameAllocator->Share(pageTable[i].physicalPage);
+	} else {
+	    if (i >= zeroPage) {
+		frame = kernel->frameAllocator->Allocate(TRUE);
+	    } else if (run == 0) {	// start a new block of frames
+		int count = 0, order;
+
+		while ((i + count < zeroPage) && !IsSharedText(i + count)) {
+		    count++;
+		}
+		order = FrameAllocator::OrderOf(count);
+		while ((frame = kernel->frameAllocator->AllocateBlock(order))
+				== -1) {
+		    ASSERT(order > 0);	// there are enough frames free
+		    order--;
+		}
+		run = 1 << order;
+	    }
+	    pageTable[i].physicalPage = frame++;
+	    if (i < zeroPage) {
+		run--;
+	    }
+	    kernel->machine->InvalidateDecodedPage(pageTable[i].physicalPage);
+	}
 	pageTable[i].valid = TRUE;
 	pageTable[i].use = FALSE;
 	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  
+	pageTable[i].readOnly = (kernel->textCache != NULL) &&
+				TextCache::IsShared(&noffH.code, i);
     }
 
-    char *buff = new char[size];
+// then, read the code and data segments straight into their frames,
+// in address order, zeroing whatever lies between and after them
+    Segment *segments[3];
+    int numSegments = 0, loaded = 0;
 
-// then, copy in the code and data segments into memory
-// Note: this code assumes that virtual address = physical address
-    if (noffH.code.size > 0) {
-        //DEBUG(dbgAddr, "Initializing code segment.");
-	//DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-	// Read the executable to a buff, use writechar to move the buff into machine->mainMemory
-    	executable->ReadAt(&buff[noffH.code.virtualAddr], noffH.code.size, noffH.code.inFileAddr);
+    segments[numSegments++] = &noffH.code;
+#ifdef RDATA
+    segments[numSegments++] = &noffH.readonlyData;
+#endif
+    segments[numSegments++] = &noffH.initData;
+    for (int i = 1; i < numSegments; i++) {	// insertion sort
+	Segment *segment = segments[i];
+	int j;
+
+	for (j = i; (j > 0) && 
+		(segments[j - 1]->virtualAddr > segment->virtualAddr); j--) {
+	    segments[j] = segments[j - 1];
+	}
+	segments[j] = segment;
     }
-    if (noffH.initData.size > 0) {
-        //DEBUG(dbgAddr, "Initializing data segment.");
-	//DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-    	executable->ReadAt(&buff[noffH.initData.virtualAddr], noffH.initData.size, noffH.initData.inFileAddr);
+    for (int i = 0; i < numSegments; i++) {
+	if (segments[i]->size > 0) {
+	    ASSERT(segments[i]->virtualAddr >= loaded);
+	    ZeroRange(loaded, segments[i]->virtualAddr);
+	    ReadSegment(segments[i]);
+	    loaded = segments[i]->virtualAddr + segments[i]->size;
+	}
     }
+    ZeroRange(loaded, zeroPage * PageSize);	// the rest of the last page
 
-#ifdef RDATA
-    if (noffH.readonlyData.size > 0) {
-        //DEBUG(dbgAddr, "Initializing read only data segment.");
-	//DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-    	executable->ReadAt(&buff[noffH.readonlyData.virtualAddr], noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
+    if (text == NULL && kernel->textCache != NULL) {
+					// let others share our code
+	text = kernel->textCache->Insert(executable, &noffH.code, pageTable);
     }
-#endif
+    if (text == NULL || text->executable != executable) {
+	delete executable;		// close file
+    }
+    executable = NULL;
+    return TRUE;			// success
+}
 
-    WriteBuffer(size, pageTable[0].virtualPage, buff);
+//----------------------------------------------------------------------
+// AddrSpace::Fork
+// 	Make a copy of this address space, for the Fork system call, 
+//	without copying any memory: the copy maps the same frames.  The
+//	pages that either could write to become read-only in both, and
+//	CopyOnWrite copies a page when one of them first writes to it.
+//	Code is read-only already, and stays shared.
+//
+//	The copy starts with no files open, other than the console.
+//
+//	Return NULL if we are demand paged, since the core map gives
+//	each frame to only one address space.
+//----------------------------------------------------------------------
 
-    delete executable;			// close file
-    return TRUE;			// success
+AddrSpace *
+AddrSpace::Fork()
+{
+    AddrSpace *child;
+
+    if (demandPaged) {
+	return NULL;
+    }
+    if (copyOnWrite == NULL) {		// our first Fork
+	copyOnWrite = new bool[numPages];
+	for (int i = 0; i < numPages; i++) {
+	    copyOnWrite[i] = FALSE;
+	}
+    }
+    // our pages are about to become read-only
+    if (kernel->tlbManager != NULL) {
+	kernel->tlbManager->InvalidateSpace(this);
+    }
+    child = new AddrSpace;
+    child->numPages = numPages;
+    child->noffH = noffH;
+    child->pageTable = new TranslationEntry[numPages];
+    child->copyOnWrite = new bool[numPages];
+    for (int i = 0; i < numPages; i++) {
+	if (!pageTable[i].readOnly) {
+	    pageTable[i].readOnly = TRUE;
+	    copyOnWrite[i] = TRUE;
+	}
+	child->pageTable[i] = pageTable[i];
+	child->copyOnWrite[i] = copyOnWrite[i];
+	kernel->frameAllocator->Share(pageTable[i].physicalPage);
+    }
+    child->text = text;
+    if (text != NULL) {
+	kernel->textCache->Share(text);
+    }
+    kernel->machine->FlushFastTlb();	// our pages are read-only now
+    return child;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Handle a write to a read-only page.  If it is read-only only
+//	because it is shared with a forked address space, give us a 
+//	copy of our own (unless nobody else is using it any more), and 
+//	make it writable; the instruction that faulted is then 
+//	re-executed.  Return FALSE if the page really is read-only, or
+//	there is no frame free for the copy.
+//
+//	"badVAddr" -- the virtual address that was written to
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(int badVAddr)
+{
+    int vpn = (unsigned) badVAddr / PageSize;
+    TranslationEntry *entry;
+    int frame;
+
+    if (!IsCopyOnWrite(badVAddr)) {
+	return FALSE;
+    }
+    entry = &pageTable[vpn];
+    if (kernel->tlbManager != NULL) {
+	kernel->tlbManager->Invalidate(entry);
+    }
+    if (kernel->frameAllocator->RefCount(entry->physicalPage) > 1) {
+	frame = kernel->frameAllocator->Allocate();
+	if (frame == -1) {
+	    return FALSE;
+	}
+	bcopy(&kernel->machine->mainMemory[entry->physicalPage * PageSize],
+		&kernel->machine->mainMemory[frame * PageSize], PageSize);
+	kernel->machine->InvalidateDecodedPage(frame);
+	kernel->frameAllocator->Free(entry->physicalPage);
+	entry->physicalPage = frame;
+    }
+    entry->readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+    kernel->machine->FlushFastTlb();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsCopyOnWrite
+// 	Return TRUE if a virtual page is read-only only because it is 
+//	shared with a forked address space, and CopyOnWrite has not yet
+//	given us a copy of our own.
+//
+//	"badVAddr" -- a virtual address in the page
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsCopyOnWrite(int badVAddr)
+{
+    int vpn = (unsigned) badVAddr / PageSize;
+
+    return (copyOnWrite != NULL) && (vpn < numPages) && copyOnWrite[vpn];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsSharedText
+// 	Return TRUE if a virtual page is in a frame shared with other 
+//	address spaces, through the text cache.
+//
+//	"vpn" -- the virtual page
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsSharedText(int vpn)
+{
+    return (text != NULL) && (vpn >= text->firstPage) && 
+			(vpn < text->firstPage + text->numPages);
 }
 
 //----------------------------------------------------------------------
@@ -254,13 +514,264 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	have it forget any translations it cached from the last one.
+//	If the machine has a TLB instead, just tell it which of the 
+//	TLB's entries are ours (see tlbmanager.h).
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
+    if (kernel->tlbManager != NULL) {
+	kernel->tlbManager->Switch(this);
+	return;
+    }
     kernel->machine->pageTable = pageTable;
     kernel->machine->pageTableSize = numPages;
+    kernel->machine->FlushFastTlb();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageFault
+// 	Handle a page fault: the page containing "badVAddr" isn't in
+//	memory.  Find it a frame (which may mean evicting some other 
+//	page), fill the frame in, and make the page valid.  The
+//	instruction that faulted is then re-executed.
+//
+//	"badVAddr" -- the virtual address that couldn't be translated
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PageFault(int badVAddr)
+{
+    int vpn = (unsigned) badVAddr / PageSize;
+    TranslationEntry *entry = &pageTable[vpn];
+    int frame;
+
+    ASSERT(demandPaged && (vpn < numPages));
+    kernel->coreMap->Acquire();
+    if (!entry->valid) {
+	kernel->stats->numPageFaults++;
+	frame = kernel->coreMap->AllocateFrame(this, entry,
+			(swapSlot[vpn] == -1) && (vpn >= FirstZeroPage()));
+	LoadPage(vpn, frame);
+	entry->physicalPage = frame;
+	entry->use = FALSE;
+	entry->dirty = FALSE;
+	entry->valid = TRUE;
+    }
+    kernel->coreMap->Release();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::EvictPage
+// 	Take a page out of memory, so its frame can be given to someone
+//	else.  If it has changed since it was brought in, save it in the
+//	swap space first; otherwise, there is already a copy in the swap
+//	space or the executable (or it is all zeroes).
+//
+//	Called by the core map, which is held by the caller.
+//
+//	"vpn" -- the virtual page to evict
+//----------------------------------------------------------------------
+
+void
+AddrSpace::EvictPage(int vpn)
+{
+    TranslationEntry *entry = &pageTable[vpn];
+
+    ASSERT(entry->valid);
+    if (kernel->tlbManager != NULL) {
+	kernel->tlbManager->Invalidate(entry);	// saving its dirty bit
+    }
+    entry->valid = FALSE;		// before we wait for the disk
+    kernel->machine->FlushFastTlb();
+    if (entry->dirty) {
+	SwapOut(vpn);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CleanPage
+// 	Save a dirty page in the swap space, and mark it clean, so that
+//	it can be evicted later without waiting for the disk.
+//
+//	Called by the core map, which is held by the caller.
+//
+//	"vpn" -- the virtual page to write out
+//----------------------------------------------------------------------
+
+void
+AddrSpace::CleanPage(int vpn)
+{
+    TranslationEntry *entry = &pageTable[vpn];
+
+    ASSERT(entry->valid && entry->dirty);
+    if (kernel->tlbManager != NULL) {
+	kernel->tlbManager->Invalidate(entry);
+    }
+    entry->dirty = FALSE;		// in case it changes while we write
+    kernel->machine->FlushFastTlb();
+    SwapOut(vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapOut
+// 	Write a page to its slot in the swap space, allocating the slot
+//	the first time.
+//
+//	"vpn" -- the virtual page to write out
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SwapOut(int vpn)
+{
+    char *page = &kernel->machine->mainMemory[pageTable[vpn].physicalPage 
+						* PageSize];
+
+    if (swapSlot[vpn] == -1) {
+	swapSlot[vpn] = kernel->swapSpace->Allocate();
+    }
+    kernel->swapSpace->WritePage(swapSlot[vpn], page);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+// 	Fill in a page frame with the contents of a virtual page: from 
+//	the swap space if the page has been there, or else from the
+//	parts of the executable's segments that fall in the page.  
+//	Anything else (uninitialized data, the stack) starts out zero;
+//	pages with nothing else were given frames that are zero already.
+//
+//	"vpn" -- the virtual page being brought in
+//	"frame" -- the physical page frame to put it in
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadPage(int vpn, int frame)
+{
+    char *page = &kernel->machine->mainMemory[frame * PageSize];
+
+    if (swapSlot[vpn] != -1) {
+	kernel->swapSpace->ReadPage(swapSlot[vpn], page);
+    } else if (vpn < FirstZeroPage()) {
+	bzero(page, PageSize);
+	LoadSegment(&noffH.code, vpn, page);
+#ifdef RDATA
+	LoadSegment(&noffH.readonlyData, vpn, page);
+#endif
+	LoadSegment(&noffH.initData, vpn, page);
+    }
+    kernel->machine->InvalidateDecodedPage(frame);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Read whatever part of a segment of the executable falls in a 
+//	virtual page, into the frame holding the page.
+//
+//	"segment" -- where the segment is, in the file and in memory
+//	"vpn" -- the virtual page being brought in
+//	"page" -- the start of its frame in mainMemory
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadSegment(Segment *segment, int vpn, char *page)
+{
+    int start = max(segment->virtualAddr, vpn * PageSize);
+    int end = min(segment->virtualAddr + segment->size, (vpn + 1) * PageSize);
+
+    if (start < end) {
+	executable->ReadAt(&page[start - vpn * PageSize], end - start,
+			segment->inFileAddr + start - segment->virtualAddr);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadSegment
+// 	Read a segment of the executable straight into the frames
+//	that hold it.  Only used when the whole program is loaded up 
+//	front.  Pages shared with another address space already have
+//	their contents, so they are skipped.
+//
+//	Pages whose frames are next to each other are read together;
+//	usually that is all of them, so the segment takes one ReadAt,
+//	and no disk sector is read twice.
+//
+//	"segment" -- where the segment is, in the file and in memory
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReadSegment(Segment *segment)
+{
+    int vaddr = segment->virtualAddr;
+    int end = segment->virtualAddr + segment->size;
+    int vpn, frame, chunk;
+
+    while (vaddr < end) {
+	vpn = vaddr / PageSize;
+	if (IsSharedText(vpn)) {
+	    vaddr = (vpn + 1) * PageSize;
+	    continue;
+	}
+	frame = pageTable[vpn].physicalPage;
+	chunk = min((vpn + 1) * PageSize, end) - vaddr;
+	while ((vaddr + chunk < end) && !IsSharedText(vpn + 1) &&
+		(pageTable[vpn + 1].physicalPage == frame + 1)) {
+	    vpn++;
+	    frame++;
+	    chunk = min((vpn + 1) * PageSize, end) - vaddr;
+	}
+	executable->ReadAt(&kernel->machine->mainMemory[
+		pageTable[vaddr / PageSize].physicalPage * PageSize 
+			+ vaddr % PageSize],
+		chunk, segment->inFileAddr + vaddr - segment->virtualAddr);
+	vaddr += chunk;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ZeroRange
+// 	Zero the virtual addresses from "from" up to (but not including)
+//	"to", in the frames that hold them.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ZeroRange(int from, int to)
+{
+    int offset, chunk;
+
+    while (from < to) {
+	offset = from % PageSize;
+	chunk = min(PageSize - offset, to - from);
+	bzero(&kernel->machine->mainMemory[
+		pageTable[from / PageSize].physicalPage * PageSize + offset],
+		chunk);
+	from += chunk;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FirstZeroPage
+// 	Return the first virtual page past all of the executable's 
+//	segments.  It, and every page after it, holds nothing but 
+//	uninitialized data and the stack, so starts out all zeroes.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::FirstZeroPage()
+{
+    int end = noffH.code.virtualAddr + noffH.code.size;
+
+#ifdef RDATA
+    if (noffH.readonlyData.size > 0) {
+	end = max(end, noffH.readonlyData.virtualAddr + noffH.readonlyData.size);
+    }
+#endif
+    if (noffH.initData.size > 0) {
+	end = max(end, noffH.initData.virtualAddr + noffH.initData.size);
+    }
+    return divRoundUp(end, PageSize);
 }
 
 //----------------------------------------------------------------------
@@ -269,42 +780,156 @@ void AddrSpace::RestoreState()
 
 //----------------------------------------------------------------------
 // AddrSpace::CreateFile
+//	Create a file, for the Create system call.  In the real file
+//	system, where a file's size is fixed, it is UserFileSize bytes.
 //----------------------------------------------------------------------
 bool AddrSpace::CreateFile(char *fn)
 {
-	return false;
+#ifdef FILESYS_STUB
+	return kernel->fileSystem->Create(fn);
+#else
+	return kernel->fileSystem->Create(fn, UserFileSize);
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RemoveFile
+//	Remove a file, for the Remove system call.  The Nachos file
+//	system won't remove a file that any program has open (see
+//	FileSystem::Unlink), so this fails until every Open of it is
+//	closed.  (The stub file system leaves it to UNIX, which will.)
+//----------------------------------------------------------------------
+bool AddrSpace::RemoveFile(char *fn)
+{
+	return kernel->fileSystem->Remove(fn);
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::OpenReadWriteFile
+//	Open a file, and return the lowest OpenFileId not in use for it,
+//	or -1 if the file can't be opened or the table is full.  Each
+//	Open gets its own position in the file, starting at 0; the file
+//	system shares what else it can between them.
 //----------------------------------------------------------------------
 int AddrSpace::OpenReadWriteFile(char *fn)
 {
-	return 0;
+	int fd;
+	OpenFile *file;
+
+	for (fd = 2; fd < MaxOpenFiles; fd++) {	// 0 and 1 are the console
+		if (openFiles[fd] == NULL)
+			break;
+	}
+	if (fd == MaxOpenFiles)
+		return -1;
+	file = kernel->fileSystem->Open(fn);
+	if (file == NULL)
+		return -1;
+	openFiles[fd] = file;
+	return fd;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindOpenFile
+//	Return the file open as "fd", or NULL if "fd" isn't one.
+//----------------------------------------------------------------------
+OpenFile *AddrSpace::FindOpenFile(int fd)
+{
+	if (fd < 0 || fd >= MaxOpenFiles)
+		return NULL;
+	return openFiles[fd];
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::ReadOpenFile
+//	Read up to "size" bytes from an open file, from its position,
+//	into user memory at "svaddr".  We go a page at a time, through a
+//	page-sized buffer, so that a huge "size" costs no more than the
+//	file has to give.  Return -1 if part of the user buffer isn't a
+//	legal address.
 //----------------------------------------------------------------------
 int AddrSpace::ReadOpenFile(int fd, int svaddr, int size)
 {
-	return 0;
+	OpenFile *file = FindOpenFile(fd);
+	char *buffer;
+	int count, numRead, total = 0;
+
+	if (file == NULL)
+		return -1;
+	buffer = new char[PageSize];
+	while (total < size) {
+		count = min(size - total, PageSize);
+		numRead = file->Read(buffer, count);
+		if (!CopyOut(svaddr + total, buffer, numRead)) {
+			total = -1;
+			break;
+		}
+		total += numRead;
+		if (numRead < count)		// end of file
+			break;
+	}
+	delete [] buffer;
+	return total;
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::WriteOpenFile
+//	Write "size" bytes from user memory at "svaddr" to an open file,
+//	at its position, a page at a time as for ReadOpenFile.  Return -1
+//	if part of the user buffer isn't a legal address; the pages before
+//	it have been written.
 //----------------------------------------------------------------------
 int AddrSpace::WriteOpenFile(int fd, int svaddr, int size)
 {
-        return 0;
+	OpenFile *file = FindOpenFile(fd);
+	char *buffer;
+	int count, numWritten, total = 0;
+
+	if (file == NULL)
+		return -1;
+	buffer = new char[PageSize];
+	while (total < size) {
+		count = min(size - total, PageSize);
+		if (!CopyIn(svaddr + total, buffer, count)) {
+			total = -1;
+			break;
+		}
+		numWritten = file->Write(buffer, count);
+		total += numWritten;
+		if (numWritten < count)		// end of file
+			break;
+	}
+	delete [] buffer;
+	return total;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SeekOpenFile
+//	Set where the next Read or Write of an open file starts.
+//----------------------------------------------------------------------
+bool AddrSpace::SeekOpenFile(int fd, int position)
+{
+	OpenFile *file = FindOpenFile(fd);
+
+	if (file == NULL || position < 0)
+		return false;
+	file->Seek(position);
+	return true;
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::CloseOpenFile
+//	Close an open file, freeing its OpenFileId.
 //----------------------------------------------------------------------
-void AddrSpace::CloseOpenFile(int fd)
+bool AddrSpace::CloseOpenFile(int fd)
 {
+	OpenFile *file = FindOpenFile(fd);
 
+	if (file == NULL)
+		return false;
+	delete file;
+	openFiles[fd] = NULL;
+	return true;
 }
 
 //----------------------------------------------------------------------
@@ -324,17 +949,33 @@ int AddrSpace::ReadConsole(int b, int size)
 int AddrSpace::WriteConsole(int b, int size)
 {
 	char *string = new char[size];
-	ReadString(b, string, size);
-	cout << string;
+	if (!CopyIn(b, string, size)) {
+		delete [] string;
+		return -1;
+	}
+	cout.write(string, size);
+	delete [] string;
         return size;
 }
 
 //----------------------------------------------------------------------
-// AddrSpace::TlbFault()
+// AddrSpace::TlbFault
+//  Handle a TLB miss: load the TLB with the page table entry for 
+//  the page containing _vaddr_, bringing the page into memory first
+//  if it isn't there.  The instruction that missed is then 
+//  re-executed.
+//  Return false if _vaddr_ isn't in the address space at all.
 //----------------------------------------------------------------------
 bool AddrSpace::TlbFault(int vaddr)
 {
-	return false;
+	int vpn = (unsigned) vaddr / PageSize;
+
+	if (vpn >= numPages)
+		return false;
+	if (!pageTable[vpn].valid)
+		PageFault(vaddr);
+	kernel->tlbManager->Refill(this, &pageTable[vpn]);
+	return true;
 }
 
 //----------------------------------------------------------------------
@@ -347,15 +988,17 @@ bool AddrSpace::TlbFault(int vaddr)
 //  and store the physical address in _paddr_.
 //  The flag _writing_ is false (0) for read-only access; true (1)
 //  for read-write access.
-//  Return any exceptions caused by the address translation.
+//  Return any exceptions caused by the address translation; a 
+//  PageFaultException means the page has to be brought in first
+//  (see PageFault).
 //----------------------------------------------------------------------
 ExceptionType
 AddrSpace::Translate(int vaddr, int *paddr, bool writing)
 {
     TranslationEntry *pte;
     int pfn;
-    int vpn    = vaddr / PageSize;
-    int offset = vaddr % PageSize;
+    int vpn    = (unsigned) vaddr / PageSize;
+    int offset = (unsigned) vaddr % PageSize;
 
     if (vpn >= numPages) {
         return AddressErrorException;
@@ -363,6 +1006,10 @@ AddrSpace::Translate(int vaddr, int *paddr, bool writing)
 
     pte = &pageTable[vpn];
 
+    if (!pte->valid) {
+        return PageFaultException;
+    }
+
     if (writing && pte->readOnly) {
         return ReadOnlyException;
     }
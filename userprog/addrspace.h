@@ -17,8 +17,16 @@
 #include "filesys.h"
 #include "translate.h"
 #include "machine.h"
+#include "noff.h"
+
+class SharedText;
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define MaxOpenFiles		16	// files a user program can have open
+					// at once, counting the console
+#define UserFileSize		1024	// size of a file made by Create; in
+					// the real file system, files can't
+					// grow
 
 class AddrSpace {
   public:
@@ -36,12 +44,36 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    void PageFault(int badVAddr);	// Bring in the page containing
+					// "badVAddr", if demand paging
+    void EvictPage(int vpn);		// Take away a page's frame, saving
+					// its contents in the swap space 
+					// if they've changed
+    void CleanPage(int vpn);		// Save a dirty page in the swap 
+					// space, but leave it in memory
+
+    AddrSpace *Fork();			// Make a copy of the address space,
+					// sharing pages until they change
+    bool CopyOnWrite(int badVAddr);	// Give us our own copy of a page
+					// we share, since we wrote to it
+    bool IsCopyOnWrite(int badVAddr);	// Is a page read-only only until
+					// we write to it?
+
+    int GetId() { return id; }		// Our SpaceId, for Exec and Join
+    int NumPages() { return numPages; }
+    static int NumSpaces() { return numSpaces; }
+					// How many address spaces exist?
+
     //Added functionality here:
     bool CreateFile(char *fn);
-    int OpenReadWriteFile(char *fn);
+    bool RemoveFile(char *fn);
+    int OpenReadWriteFile(char *fn);	// Return an OpenFileId, or -1
     int ReadOpenFile(int fd, int svaddr, int size);
     int WriteOpenFile(int fd, int svaddr, int size);
-    void CloseOpenFile(int fd);
+					// Return the bytes read or written,
+					// or -1 if "fd" isn't open
+    bool SeekOpenFile(int fd, int position);
+    bool CloseOpenFile(int fd);
     int ReadConsole(int b, int size);
     int WriteConsole(int b, int size);
     bool TlbFault(int vaddr);
@@ -57,9 +89,43 @@ class AddrSpace {
     int numPages;         		// Number of pages in the virtual 
 					// address space
 
+    bool demandPaged;			// are pages loaded only when used?
+    OpenFile *executable;		// if so, the file to load them from,
+    NoffHeader noffH;			// and where in the file they are
+    int *swapSlot;			// slot in the swap space holding
+					// each page, or -1 if none yet
+    SharedText *text;			// if not demand paged, the frames
+					// holding our code, shared with 
+					// other copies of the program
+    bool *copyOnWrite;			// which pages are read-only only
+					// until they are written, or NULL
+					// if we have never been forked
+    int id;				// our SpaceId
+    OpenFile *openFiles[MaxOpenFiles];	// the files the program has open,
+					// by OpenFileId; the first two are
+					// the console, so are always NULL
+
+    static int numSpaces;		// number of address spaces
+    static int nextId;			// the SpaceId for the next one
+
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
 
+    void LoadPage(int vpn, int frame);	// Fill in a frame with the 
+					// contents of a page
+    void LoadSegment(Segment *segment, int vpn, char *page);
+					// Read the part of a segment that 
+					// falls in a page from the executable
+    void SwapOut(int vpn);		// Write a page to its swap slot
+
+    void ReadSegment(Segment *segment);	// Read a segment of the executable
+					// into the frames holding it
+    void ZeroRange(int from, int to);	// Zero part of the address space
+    int FirstZeroPage();		// The first page past the executable's
+					// segments, which starts out zero
+    bool IsSharedText(int vpn);		// Is a page's frame shared code?
+    OpenFile *FindOpenFile(int fd);	// The file open as "fd", or NULL
+
 };
 
 #endif // ADDRSPACE_H
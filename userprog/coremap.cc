@@ -0,0 +1,310 @@
+// coremap.cc
+//	Routines to keep track of physical page frames, and to choose
+//	which page to evict when they are all in use.
+//
+//	Frames come from kernel->frameAllocator, as they do for eagerly loaded
+//	programs; the core map just remembers who has each one.  When
+//	a page fault finds no free frame (or user pages already have
+//	"maxFrames" of them), we take one away from some address space
+//	(possibly the one that faulted), which writes the page out to
+//	the swap space if it has to.
+//
+//	The replacement policies look at, and clear, the use bits in
+//	the owners' page tables.  Since the machine caches translations
+//	(see Machine::FlushFastTlb), and only sets a use bit when it
+//	translates, we have to flush that cache whenever we clear one.
+//	If the machine has a TLB, it sets the bits there, so we have to
+//	copy them to the page tables first (see TlbManager::SaveBits).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "coremap.h"
+#include "addrspace.h"
+#include "frames.h"
+#include "tlbmanager.h"
+
+//----------------------------------------------------------------------
+// ParseReplacementPolicy
+// 	Look up a page replacement policy by name, for the "-vm" flag.
+//
+//	"name" -- "fifo", "clock", "lru" or "wsclock"
+//	"policy" -- where to store the policy, if the name is known
+//----------------------------------------------------------------------
+
+bool
+ParseReplacementPolicy(char *name, ReplacementPolicy *policy)
+{
+    if (strcmp(name, "fifo") == 0) {
+	*policy = FifoReplacement;
+    } else if (strcmp(name, "clock") == 0) {
+	*policy = ClockReplacement;
+    } else if (strcmp(name, "lru") == 0) {
+	*policy = LruReplacement;
+    } else if (strcmp(name, "wsclock") == 0) {
+	*policy = WsClockReplacement;
+    } else {
+	return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::CoreMap
+// 	Initialize the core map; all frames start out free.
+//
+//	"policy" -- how to choose a page to evict
+//	"maxFrames" -- the most frames user pages can take up at once
+//----------------------------------------------------------------------
+
+CoreMap::CoreMap(ReplacementPolicy policy, int maxFrames)
+{
+    ASSERT((maxFrames > 0) && (maxFrames <= NumPhysPages));
+    this->policy = policy;
+    this->maxFrames = maxFrames;
+    numInUse = 0;
+    frames = new CoreMapEntry[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++) {
+	frames[i].owner = NULL;
+	frames[i].entry = NULL;
+    }
+    hand = 0;
+    nextLoadOrder = 0;
+    lock = new Lock("core map");
+}
+
+//----------------------------------------------------------------------
+// CoreMap::~CoreMap
+// 	De-allocate the core map.
+//----------------------------------------------------------------------
+
+CoreMap::~CoreMap()
+{
+    delete [] frames;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::AllocateFrame
+// 	Find a frame for a page that is about to be brought into memory.
+//	Use a free frame if there is one; otherwise evict the page
+//	chosen by the replacement policy.
+//
+//	The caller fills in the frame, and then "entry".
+//
+//	"owner" -- the address space the page belongs to
+//	"entry" -- the page's entry in owner's page table
+//	"zeroed" -- must the frame be all zeroes?  (If so, the caller
+//		need not fill it in.)
+//----------------------------------------------------------------------
+
+int
+CoreMap::AllocateFrame(AddrSpace *owner, TranslationEntry *entry, 
+			bool zeroed)
+{
+    int frame = -1;
+    CoreMapEntry *victim;
+
+    if (kernel->tlbManager != NULL) {	// bring the bits up to date
+	kernel->tlbManager->SaveBits();
+    }
+    if (policy == LruReplacement) {	// sample the use bits
+	for (int i = 0; i < NumPhysPages; i++) {
+	    if (frames[i].owner != NULL) {
+		frames[i].age >>= 1;
+		if (frames[i].entry->use) {
+		    frames[i].age |= 0x80000000;
+		    frames[i].entry->use = FALSE;
+		}
+	    }
+	}
+	kernel->machine->FlushFastTlb();
+    }
+
+    if (numInUse < maxFrames) {
+	frame = kernel->frameAllocator->Allocate(zeroed);
+    }
+    if (frame != -1) {
+	numInUse++;
+    } else {
+	frame = FindVictim();
+	victim = &frames[frame];
+	DEBUG(dbgAddr, "Evicting virtual page " << victim->entry->virtualPage
+			<< " from frame " << frame);
+	victim->owner->EvictPage(victim->entry->virtualPage);
+	if (zeroed) {
+	    bzero(&kernel->machine->mainMemory[frame * PageSize], PageSize);
+	    kernel->stats->numZeroPoolMisses++;
+	}
+    }
+
+    frames[frame].owner = owner;
+    frames[frame].entry = entry;
+    frames[frame].loadOrder = nextLoadOrder++;
+    frames[frame].age = 0;
+    frames[frame].lastUse = kernel->stats->totalTicks;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::FreeFrame
+// 	Give back a frame, when its owner goes away.
+//
+//	"frame" -- a frame returned by AllocateFrame
+//----------------------------------------------------------------------
+
+void
+CoreMap::FreeFrame(int frame)
+{
+    ASSERT(frames[frame].owner != NULL);
+    frames[frame].owner = NULL;
+    frames[frame].entry = NULL;
+    kernel->frameAllocator->Free(frame);
+    numInUse--;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::FindVictim
+// 	Choose a frame to take away from its owner.  There must be
+//	at least one frame in use.
+//----------------------------------------------------------------------
+
+int
+CoreMap::FindVictim()
+{
+    int frame;
+
+    ASSERT(numInUse > 0);
+    switch (policy) {
+      case FifoReplacement:
+	frame = FindFifo();
+	break;
+      case ClockReplacement:
+	frame = FindClock();
+	break;
+      case LruReplacement:
+	frame = FindLru();
+	break;
+      case WsClockReplacement:
+	frame = FindWsClock();
+	break;
+      default:
+	ASSERTNOTREACHED();
+    }
+    kernel->machine->FlushFastTlb();	// we may have cleared use bits
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::FindFifo
+// 	Choose the page that was brought in the longest time ago.
+//----------------------------------------------------------------------
+
+int
+CoreMap::FindFifo()
+{
+    int oldest = -1;
+
+    for (int i = 0; i < NumPhysPages; i++) {
+	if ((frames[i].owner != NULL) && ((oldest == -1) ||
+		(frames[i].loadOrder - frames[oldest].loadOrder < 0))) {
+	    oldest = i;
+	}
+    }
+    return oldest;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::FindClock
+// 	Sweep the frames starting at "hand", giving each page that has
+//	been used since we last looked a second chance.  This ends
+//	within two sweeps, since the first clears every use bit.
+//----------------------------------------------------------------------
+
+int
+CoreMap::FindClock()
+{
+    int frame;
+
+    for (;;) {
+	frame = hand;
+	hand = (hand + 1) % NumPhysPages;
+	if (frames[frame].owner == NULL) {
+	    continue;
+	}
+	if (!frames[frame].entry->use) {
+	    return frame;
+	}
+	frames[frame].entry->use = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// CoreMap::FindLru
+// 	Choose the page with the smallest age -- the one whose recent
+//	history of use bits (sampled at each page fault) shows it was
+//	used least recently.  Break ties in FIFO order.
+//----------------------------------------------------------------------
+
+int
+CoreMap::FindLru()
+{
+    int best = -1;
+
+    for (int i = 0; i < NumPhysPages; i++) {
+	if (frames[i].owner == NULL) {
+	    continue;
+	}
+	if ((best == -1) || (frames[i].age < frames[best].age) ||
+		((frames[i].age == frames[best].age) &&
+		 (frames[i].loadOrder - frames[best].loadOrder < 0))) {
+	    best = i;
+	}
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::FindWsClock
+// 	Sweep the frames like the clock policy, but a page is only
+//	evicted if it is clean and hasn't been used for WorkingSetWindow
+//	ticks -- i.e., it has dropped out of its owner's working set.
+//	Old dirty pages are written out as we pass them, so they can be
+//	evicted next time around.
+//
+//	If every page is still in a working set after two sweeps, fall
+//	back on the page that was used longest ago.
+//----------------------------------------------------------------------
+
+int
+CoreMap::FindWsClock()
+{
+    int now = kernel->stats->totalTicks;
+    int frame, oldest = -1;
+    CoreMapEntry *e;
+
+    for (int i = 0; i < 2 * NumPhysPages; i++) {
+	frame = hand;
+	hand = (hand + 1) % NumPhysPages;
+	e = &frames[frame];
+	if (e->owner == NULL) {
+	    continue;
+	}
+	if (e->entry->use) {
+	    e->entry->use = FALSE;
+	    e->lastUse = now;
+	} else if (now - e->lastUse > WorkingSetWindow) {
+	    if (!e->entry->dirty) {
+		return frame;
+	    }
+	    e->owner->CleanPage(e->entry->virtualPage);
+	}
+	if ((oldest == -1) || (e->lastUse - frames[oldest].lastUse < 0)) {
+	    oldest = frame;
+	}
+    }
+    return oldest;
+}
@@ -0,0 +1,97 @@
+// coremap.h
+//	Data structures to manage physical page frames when user programs
+//	are demand paged.
+//
+//	The core map records, for each page frame, which address space
+//	and virtual page it holds.  When a page fault finds every frame
+//	in use, the core map picks a frame to take away from its owner,
+//	using one of several page replacement policies.
+//
+//	All of the policies are driven by the use and dirty bits the
+//	hardware keeps in each page table entry.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef COREMAP_H
+#define COREMAP_H
+
+#include "copyright.h"
+#include "translate.h"
+#include "machine.h"
+#include "synch.h"
+
+class AddrSpace;
+
+// The page replacement policies.
+//	FifoReplacement -- evict the page that has been in memory longest
+//	ClockReplacement -- second chance: sweep the frames in order,
+//		skipping (and clearing) pages that have been used
+//	LruReplacement -- approximate LRU with an "aging" counter per
+//		frame, built from the use bit at every page fault
+//	WsClockReplacement -- clock, but keep pages used within the
+//		last WorkingSetWindow ticks, and clean old dirty pages
+//		rather than evicting them straight away
+
+enum ReplacementPolicy { FifoReplacement, ClockReplacement,
+			 LruReplacement, WsClockReplacement };
+
+const int WorkingSetWindow = 10000;	// ticks, for WsClockReplacement
+
+extern bool ParseReplacementPolicy(char *name, ReplacementPolicy *policy);
+					// Convert "fifo", "clock", "lru" or
+					// "wsclock" to a policy; return
+					// FALSE if the name is unknown
+
+// The following class defines the entry for one page frame.
+
+class CoreMapEntry {
+  public:
+    AddrSpace *owner;		// address space using the frame, or NULL
+    TranslationEntry *entry;	// owner's page table entry for the frame
+    int loadOrder;		// when the page was brought in
+    unsigned int age;		// LruReplacement: use bit history,
+				// most recent in the high bit
+    int lastUse;		// WsClockReplacement: last time (in ticks)
+				// the page was seen to be used
+};
+
+// The following class defines the core map.  A caller must hold the
+// core map (Acquire/Release) while it looks at or changes the frames,
+// including while it waits for a page to be read or written.
+
+class CoreMap {
+  public:
+    CoreMap(ReplacementPolicy policy, int maxFrames);
+				// Manage at most "maxFrames" frames
+    ~CoreMap();
+
+    void Acquire() { lock->Acquire(); }
+    void Release() { lock->Release(); }
+
+    int AllocateFrame(AddrSpace *owner, TranslationEntry *entry,
+			bool zeroed);
+				// Return a frame for the page whose page
+				// table entry is "entry", evicting a page
+				// from another frame if need be; if 
+				// "zeroed", it is all zeroes
+    void FreeFrame(int frame);	// Return a frame to the free pool
+
+  private:
+    ReplacementPolicy policy;	// how to pick the page to evict
+    int maxFrames;		// most frames user pages may take up
+    int numInUse;		// how many frames user pages have now
+    CoreMapEntry *frames;	// one entry per physical page frame
+    int hand;			// next frame to look at, for the clocks
+    int nextLoadOrder;		// "loadOrder" for the next page brought in
+    Lock *lock;			// only one page fault at a time
+
+    int FindVictim();		// pick a frame using "policy"
+    int FindFifo();
+    int FindClock();
+    int FindLru();
+    int FindWsClock();
+};
+
+#endif // COREMAP_H
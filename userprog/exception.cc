@@ -29,42 +29,124 @@
 #include "machine.h"
 #include "kernel.h"
 
-void WriteChar(char c, int vaddr) {
+//----------------------------------------------------------------------
+// UserPage
+//      Find where a user virtual address lives in mainMemory, bringing
+//      its page in first if need be, or copying it if it is shared 
+//      copy-on-write.  Returns NULL if the address is bad (or 
+//      read-only, when "writing").
+//
+//      Bringing the page in may wait for the disk, and meanwhile 
+//      another program may take the frame back, so we keep trying
+//      until the page is there.
+//
+//      Since the kernel is about to store into the page directly, 
+//      forget any instructions decoded from it.
+//----------------------------------------------------------------------
+
+static char *UserPage(int vaddr, bool writing) {
+    AddrSpace *space = kernel->currentThread->space;
     int phyAddr;
-    //cout << "kernel->currentThread->space = " << (int) kernel->currentThread->space << endl;
-    kernel->currentThread->space->Translate(vaddr, &phyAddr, TRUE);
-    kernel->machine->mainMemory[phyAddr] = c;
+    ExceptionType exception;
+
+    exception = space->Translate(vaddr, &phyAddr, writing);
+    while (exception == PageFaultException) {
+        space->PageFault(vaddr);
+        exception = space->Translate(vaddr, &phyAddr, writing);
+    }
+    if (exception == ReadOnlyException && space->CopyOnWrite(vaddr))
+        exception = space->Translate(vaddr, &phyAddr, writing);
+    if (exception != NoException)
+        return NULL;
+    if (writing)
+        kernel->machine->InvalidateDecodedPage(phyAddr / PageSize);
+    return &kernel->machine->mainMemory[phyAddr];
 }
 
-void WriteString(int vaddr, char* buff, int buffsize) {
-    int i;
-    for (i = 0; i < buffsize; i++) {
-        WriteChar(buff[i], vaddr + i);
-        if (buff[i] == '\0')
-            break;
+//----------------------------------------------------------------------
+// CopyIn, CopyOut
+//      Copy "length" bytes between user virtual memory at "vaddr" and
+//      the kernel buffer "buff": CopyIn from the user program, CopyOut
+//      to it.  We translate once per page, and copy each page's share
+//      with a single bcopy, rather than going a byte at a time.
+//
+//      Return FALSE if part of the range isn't a legal address; the
+//      pages before it have been copied.
+//----------------------------------------------------------------------
+
+bool CopyIn(int vaddr, char* buff, int length) {
+    while (length > 0) {
+        int count = min(length, PageSize - (int) ((unsigned) vaddr % PageSize));
+        char *from = UserPage(vaddr, FALSE);
+
+        if (from == NULL)
+            return FALSE;
+        bcopy(from, buff, count);
+        vaddr += count;
+        buff += count;
+        length -= count;
     }
+    return TRUE;
 }
 
-void WriteBuffer(int length, int vaddr, char* buff) {
-    int i;
-    for (i = 0; i < length; i++) {
-        WriteChar(buff[i], vaddr + i);
+bool CopyOut(int vaddr, char* buff, int length) {
+    while (length > 0) {
+        int count = min(length, PageSize - (int) ((unsigned) vaddr % PageSize));
+        char *to = UserPage(vaddr, TRUE);
+
+        if (to == NULL)
+            return FALSE;
+        bcopy(buff, to, count);
+        vaddr += count;
+        buff += count;
+        length -= count;
     }
+    return TRUE;
+}
+
+void WriteChar(char c, int vaddr) {
+    CopyOut(vaddr, &c, 1);
+}
+
+void WriteString(int vaddr, char* buff, int buffsize) {
+    int length = 0;
+    while (length < buffsize && buff[length] != '\0')
+        length++;
+    if (length < buffsize)
+        length++;                       // the '\0' too
+    CopyOut(vaddr, buff, length);
+}
+
+void WriteBuffer(int length, int vaddr, char* buff) {
+    CopyOut(vaddr, buff, length);
 }
 
 char ReadChar(int vaddr) {
-   int phyAddr;
-   kernel->currentThread->space->Translate(vaddr, &phyAddr, FALSE);
-   char c = kernel->machine->mainMemory[phyAddr];
-   return c;
+    char c = '\0';
+    CopyIn(vaddr, &c, 1);
+    return c;
 }
 
+// Like CopyIn, but stop after the '\0'; return the length of the string
+// (or "buffsize" if there wasn't a '\0' in the first "buffsize" bytes)
 int ReadString(int vaddr, char* buff, int buffsize) {
-    int size;
-    for (size = 0; size < buffsize; size++) {
-        buff[size] = ReadChar(vaddr + size);
-        if (buff[size] == '\0')
+    int size = 0;
+    while (size < buffsize) {
+        int count = min(buffsize - size, 
+                        PageSize - (int) ((unsigned) vaddr % PageSize));
+        char *from = UserPage(vaddr, FALSE);
+        char *end;
+
+        if (from == NULL)
             break;
+        end = (char *) memchr(from, '\0', count);
+        if (end != NULL) {
+            bcopy(from, buff + size, end - from + 1);
+            return size + (end - from);
+        }
+        bcopy(from, buff + size, count);
+        vaddr += count;
+        size += count;
     }
     return size;
 }
@@ -76,79 +158,189 @@ void ExceptionHalt() {
 int ExceptionAdd(int op1, int op2) {
     return ( op1 + op2 );
 }
-//#if defined(CHANGED) && defined(USER_PROGRAM)
+
+int ExceptionSetTickets(int tickets) {
+    Thread *thread = kernel->currentThread;
+    int old;
+
+    if (tickets <= 0 || tickets > MaxTickets)
+        return -1;
+    old = thread->getTickets();
+    thread->setTickets(tickets);
+    return old;
+}
+//----------------------------------------------------------------------
+// ExitStatus
+//      What Join needs to know about a program started by Exec or Fork:
+//      whether it has exited yet, and with what status.  It is kept
+//      until the program has been joined (or forever, if it never is).
+//----------------------------------------------------------------------
+
+class ExitStatus {
+  public:
+    SpaceId id;                 // the program
+    int status;                 // what it passed to Exit
+    Semaphore *exited;          // V'ed when it exits
+    bool joined;                // someone is waiting for it already
+};
+
+static List<ExitStatus *> *exitStatuses = NULL;
+
+static ExitStatus *FindExitStatus(SpaceId id) {
+    ListIterator<ExitStatus *> iter(exitStatuses);
+
+    for (; !iter.IsDone(); iter.Next()) {
+        if (iter.Item()->id == id)
+            return iter.Item();
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// StartProcess
+//      Run an address space in a new thread, as a program that can be
+//      joined.  If "inherit", the thread starts with the registers the
+//      current thread has now (see ExceptionFork); otherwise, at the
+//      start of the program.
+//----------------------------------------------------------------------
+
+static void ExecThread(int dummy) {
+    kernel->currentThread->space->Execute();
+    ASSERTNOTREACHED();
+}
+
+static void ForkThread(int dummy) {
+    kernel->currentThread->RestoreUserState();
+    kernel->currentThread->space->RestoreState();
+    kernel->machine->Run();             // return from Fork, in the copy
+    ASSERTNOTREACHED();
+}
+
+static SpaceId StartProcess(AddrSpace *space, bool inherit) {
+    Thread *t = new Thread("user program");
+    ExitStatus *exitStatus = new ExitStatus;
+
+    if (exitStatuses == NULL)
+        exitStatuses = new List<ExitStatus *>;
+    exitStatus->id = space->GetId();
+    exitStatus->status = 0;
+    exitStatus->exited = new Semaphore("exit status", 0);
+    exitStatus->joined = FALSE;
+    exitStatuses->Append(exitStatus);
+
+    t->space = space;
+    t->setTickets(kernel->currentThread->getTickets());
+    if (inherit) {
+        t->SaveUserState();             // the registers we have now
+        t->Fork((VoidFunctionPtr) ForkThread, 0);
+    } else {
+        t->Fork((VoidFunctionPtr) ExecThread, 0);
+    }
+    return space->GetId();
+}
+
 void ExceptionExit(int n) {
+  AddrSpace *space = kernel->currentThread->space;
+  ExitStatus *exitStatus = NULL;
+
   printf("Exit(%d)\n", n);
-  //currentThread->Exit(n, kernel->machine->systemLock);
   kernel->systemLock->Release();
+  if (exitStatuses != NULL)
+    exitStatus = FindExitStatus(space->GetId());
+  if (exitStatus != NULL) {             // someone may Join us
+    exitStatus->status = n;
+    exitStatus->exited->V();
+  }
+  kernel->currentThread->space = NULL;
+  delete space;				// give back its memory
+  if (AddrSpace::NumSpaces() == 0) {	// that was the last user program
+    kernel->interrupt->Halt();
+  }
   kernel->currentThread->Finish();
   ASSERTNOTREACHED();
 }
 
-void ForkExec(int dummy) { 
-  AddrSpace *space = kernel->currentThread->space;
-
-  //space->InitRegisters();             // set the initial register values
-  //space->RestoreState();              // load page table register
- 
-  kernel->machine->Run();                     // jump to the user progam
-  ASSERT(FALSE);                      // machine->Run never returns;
-                                        // the address space exits
-                                        // by doing the syscall "exit"
-}
-//#endif
-
 #define SizeExceptionFilename 64
 
+//----------------------------------------------------------------------
+// ExceptionExec
+//      Start a new program running, in an address space of its own,
+//      loaded from the file named at "fn".  Return its SpaceId, or -1
+//      if it can't be loaded.
+//----------------------------------------------------------------------
+
 int 
 ExceptionExec(int fn) { 
-  Thread *t;
-  bool failed;
   char filename[SizeExceptionFilename];
-  int ret;
+  AddrSpace *space;
+  SpaceId ret;
+
   if (!(ReadString(fn, filename, SizeExceptionFilename))) { 
     printf("Exec: Unable to read filename at address %x\n", fn);
-    return(0);
+    return(-1);
   } 
   filename[SizeExceptionFilename - 1] = '\0';
-  OpenFile *executable = kernel->fileSystem->Open(filename);
-  AddrSpace *space;
-  cout << executable << " execute" <<endl;
-  if (executable == NULL) { 
-    printf("Exec: Unable to open file %s\n", filename);
-    return(0);
-  }
+  kernel->systemLock->Release();
   space = new AddrSpace();
-  //space->Load(executable);
-  delete executable;
-  if (failed) { 
+  if (space->Load(filename)) {          // Load says why not
+    ret = StartProcess(space, FALSE);
+  } else {
     delete space;
-    printf("Exec: Unable to read in executable for file %s\n", filename);
-    return(0);
-  } 
-  //t = new Thread("Exec Thread", &ret);
-  t->space = space;
-  //t->Fork(ForkExec, 0);
+    ret = -1;
+  }
+  kernel->systemLock->Acquire();
   return(ret);
 }
 
-int ExceptionJoin(int id) { 
-  return 0;
-  //Thread *t;
-  //t = (Thread *) (threadTable->Lookup(id));
-  //if (t == NULL) { 
-  //  return(0);
-  //}
-  //return(currentThread->Join(t, systemLock));
+//----------------------------------------------------------------------
+// ExceptionFork
+//      Start a copy of the current program, sharing its memory 
+//      copy-on-write (see AddrSpace::Fork).  The copy carries on from
+//      the same place, except that Fork returns 0 in it; here, return
+//      the copy's SpaceId, or -1 if it can't be made.
+//
+//      The program counter must already be past the system call.
+//----------------------------------------------------------------------
+
+int ExceptionFork() {
+  AddrSpace *child = kernel->currentThread->space->Fork();
+
+  if (child == NULL)
+    return -1;
+  kernel->machine->WriteRegister(2, 0); // what Fork returns in the copy
+  return StartProcess(child, TRUE);
 }
 
-//#endif
+//----------------------------------------------------------------------
+// ExceptionJoin
+//      Wait for a program started by Exec or Fork to exit, and return
+//      the status it passed to Exit.  Return -1 if there is no such
+//      program, or it has already been joined.
+//----------------------------------------------------------------------
+
+int ExceptionJoin(SpaceId id) { 
+  ExitStatus *exitStatus = NULL;
+  int ret;
+
+  if (exitStatuses != NULL)
+    exitStatus = FindExitStatus(id);
+  if (exitStatus == NULL || exitStatus->joined)
+    return(-1);
+  exitStatus->joined = TRUE;            // no one else can Join it
+  kernel->systemLock->Release();
+  exitStatus->exited->P();
+  kernel->systemLock->Acquire();
+  exitStatuses->Remove(exitStatus);
+  ret = exitStatus->status;
+  delete exitStatus->exited;
+  delete exitStatus;
+  return(ret);
+}
 
 int ExceptionWrite(int b, int size, int fd) {
     int ret;
     kernel->systemLock->Release();
     //DEBUG('e', "Write(%d, %d, %d)\n", b, size, fd);
-    cout << "Debug Write" << b << " " << size << " " << fd <<endl;
     if (fd == ConsoleOutput) {
         ret = kernel->currentThread->WriteConsole(b, size);
     } else {
@@ -161,15 +353,13 @@ int ExceptionWrite(int b, int size, int fd) {
 int ExceptionOpen(int fn) {
     int ret;
     char filename[SizeExceptionFilename];
-    printf("Open(%d)\n", fn);
     if (!(ReadString(fn, filename, SizeExceptionFilename))) {
         printf("Open: Unable to read filename at address %x\n", fn);
-        return(0);
+        return(-1);
     }
     filename[SizeExceptionFilename - 1] = '\0';
     kernel->systemLock->Release();
-    // fix this! 
-    ret = currentThread->OpenReadWriteFile(filename);
+    ret = kernel->currentThread->OpenReadWriteFile(filename);
     kernel->systemLock->Acquire();
     return(ret);
 }
@@ -177,14 +367,27 @@ int ExceptionOpen(int fn) {
 int ExceptionCreate(int fp) {
     int ret;
     char filename[SizeExceptionFilename];
-    printf("Create: %x\n", fp);
     if (!(ReadString(fp, filename, SizeExceptionFilename))) {
         printf("Create: Unable to read filename at address %x\n", fp);
-	return 0;
+	return -1;
+    }
+    filename[SizeExceptionFilename - 1] = '\0';
+    kernel->systemLock->Release();
+    ret = kernel->currentThread->CreateFile(filename) ? 1 : -1;
+    kernel->systemLock->Acquire();
+    return ret;
+}
+
+int ExceptionRemove(int fp) {
+    int ret;
+    char filename[SizeExceptionFilename];
+    if (!(ReadString(fp, filename, SizeExceptionFilename))) {
+        printf("Remove: Unable to read filename at address %x\n", fp);
+	return -1;
     }
     filename[SizeExceptionFilename - 1] = '\0';
     kernel->systemLock->Release();
-    ret = currentThread->CreateFile(filename);
+    ret = kernel->currentThread->RemoveFile(filename) ? 1 : -1;
     kernel->systemLock->Acquire();
     return ret;
 }
@@ -201,12 +404,42 @@ int ExceptionRead(int b, int size, int fd) {
     return(ret);
 }
 
+int ExceptionSeek(int position, int fd) {
+    int ret;
+    kernel->systemLock->Release();
+    ret = kernel->currentThread->SeekOpenFile(fd, position) ? 1 : -1;
+    kernel->systemLock->Acquire();
+    return ret;
+}
+
 int ExceptionClose(int fp) {
-    printf("Close: %x\n", fp);
+    int ret;
     kernel->systemLock->Release();
-    currentThread->CloseOpenFile(fp);
+    ret = kernel->currentThread->CloseOpenFile(fp) ? 1 : -1;
     kernel->systemLock->Acquire();
-    return 0;
+    return ret;
+}
+
+//----------------------------------------------------------------------
+// AdvancePC
+//      Move the program counter past a system call, so that the user
+//      program carries on after it rather than making it again.
+//----------------------------------------------------------------------
+
+static void AdvancePC() {
+    /* set previous programm counter (debugging only)*/
+    kernel->machine->WriteRegister(
+        PrevPCReg,
+        kernel->machine->ReadRegister(PCReg));
+    /* set programm counter to next instruction
+       (all Instructions are 4 byte wide)*/
+    kernel->machine->WriteRegister(
+        PCReg,
+        kernel->machine->ReadRegister(PCReg) + 4);
+    /* set next programm counter for brach execution */
+    kernel->machine->WriteRegister(
+        NextPCReg,
+        kernel->machine->ReadRegister(PCReg) + 4);
 }
 
 //----------------------------------------------------------------------
@@ -247,6 +480,8 @@ int ExceptionClose(int fp) {
 //#define SC_ExecV        13
 //#define SC_ThreadExit   14
 //#define SC_ThreadJoin   15
+//#define SC_SetTickets   16
+//#define SC_Fork         17
 //
 //#define SC_Add          42
 //
@@ -300,14 +535,47 @@ ExceptionHandler(ExceptionType which)
 
                     break;
 
+                case SC_SetTickets:
+		    {
+                    int ticketsret = ExceptionSetTickets(
+                        kernel->machine->ReadRegister(4));
+                    kernel->machine->WriteRegister(2, ticketsret);
+                    AdvancePC();
+		    return;
+                    break;
+		    }
+
                 case SC_Exit:
                     ExceptionExit(kernel->machine->ReadRegister(4));
 		    return;
                     break;
-		case SC_Exec:
+                case SC_Exec:
+		    {
+                    int execfn = kernel->machine->ReadRegister(4);
+                    int execret = ExceptionExec(execfn);
+                    kernel->machine->WriteRegister(2, execret);
+                    AdvancePC();
+		    return;
+                    break;
+		    }
+
+                case SC_Join:
+		    {
+                    int joinret = ExceptionJoin(
+                        kernel->machine->ReadRegister(4));
+                    kernel->machine->WriteRegister(2, joinret);
+                    AdvancePC();
+		    return;
+                    break;
+		    }
+
+                case SC_Fork:
 		    {
-			return;
-			break;	
+                    AdvancePC();        // the copy starts after the call
+                    int forkret = ExceptionFork();
+                    kernel->machine->WriteRegister(2, forkret);
+		    return;
+                    break;
 		    }
 
                 case SC_Create:
@@ -315,6 +583,17 @@ ExceptionHandler(ExceptionType which)
                     int createfnpointer = kernel->machine->ReadRegister(4);
                     int createret = ExceptionCreate(createfnpointer);
                     kernel->machine->WriteRegister(2, createret);
+                    AdvancePC();
+		    return;
+                    break;
+		    }
+
+                case SC_Remove:
+		    {
+                    int removefnpointer = kernel->machine->ReadRegister(4);
+                    int removeret = ExceptionRemove(removefnpointer);
+                    kernel->machine->WriteRegister(2, removeret);
+                    AdvancePC();
 		    return;
                     break;
 		    }
@@ -324,6 +603,7 @@ ExceptionHandler(ExceptionType which)
                     int openfn = kernel->machine->ReadRegister(4);
                     int openret = ExceptionOpen(openfn);
                     kernel->machine->WriteRegister(2, openret);
+                    AdvancePC();
 		    return;
                     break;
 		    }
@@ -335,6 +615,7 @@ ExceptionHandler(ExceptionType which)
                     int readfd = kernel->machine->ReadRegister(6);
                     int readret = ExceptionRead(readfnpointer, readsize, readfd);
                     kernel->machine->WriteRegister(2, readret);
+                    AdvancePC();
 		    return;
                     break;
 		    }
@@ -346,6 +627,18 @@ ExceptionHandler(ExceptionType which)
                     int writefd = kernel->machine->ReadRegister(6);
                     int writeret = ExceptionWrite(writeb, writesize, writefd);
                     kernel->machine->WriteRegister(2, writeret);
+                    AdvancePC();
+		    return;
+                    break;
+		    }
+
+                case SC_Seek:
+		    {
+                    int seekposition = kernel->machine->ReadRegister(4);
+                    int seekfd = kernel->machine->ReadRegister(5);
+                    int seekret = ExceptionSeek(seekposition, seekfd);
+                    kernel->machine->WriteRegister(2, seekret);
+                    AdvancePC();
 		    return;
                     break;
 		    }
@@ -355,6 +648,7 @@ ExceptionHandler(ExceptionType which)
                     int closefd = kernel->machine->ReadRegister(4);
                     int closeret = ExceptionClose(closefd);
                     kernel->machine->WriteRegister(2, closeret);
+                    AdvancePC();
 		    return;
                     break;
 		    }
@@ -365,6 +659,32 @@ ExceptionHandler(ExceptionType which)
                     break;
             }
             break;
+        case PageFaultException:
+            if (kernel->tlbManager == NULL) {
+                kernel->currentThread->space->PageFault(
+                    kernel->machine->ReadRegister(BadVAddrReg));
+                return;
+            }
+            if (kernel->currentThread->space->TlbFault(
+                    kernel->machine->ReadRegister(BadVAddrReg)))
+                return;
+            cerr << "Bad virtual address "
+                 << kernel->machine->ReadRegister(BadVAddrReg) << "\n";
+            break;
+        case ReadOnlyException:
+            if (kernel->currentThread->space->CopyOnWrite(
+                    kernel->machine->ReadRegister(BadVAddrReg)))
+                return;
+            if (kernel->currentThread->space->IsCopyOnWrite(
+                    kernel->machine->ReadRegister(BadVAddrReg))) {
+                // no frame for the copy; just this program has to go
+                cerr << "Not enough memory to copy page at address "
+                     << kernel->machine->ReadRegister(BadVAddrReg) << "\n";
+                ExceptionExit(-1);
+            }
+            cerr << "Write to read-only address "
+                 << kernel->machine->ReadRegister(BadVAddrReg) << "\n";
+            break;
         default:
             cerr << "Unexpected user mode exception" << (int)which << "\n";
             break;
@@ -24,6 +24,8 @@
 #ifndef EXCEPTION_H
 #define EXCEPTION_H
 #include "copyright.h"
+bool CopyIn(int vaddr, char* buff, int length);
+bool CopyOut(int vaddr, char* buff, int length);
 void WriteChar(char c, int vaddr);
 void WriteString(int vaddr, char* buff, int buffsize);
 void WriteBuffer(int length, int vaddr, char* buff);
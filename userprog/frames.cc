@@ -0,0 +1,333 @@
+// frames.cc
+//	Routines to allocate physical page frames, and keep track of how
+//	many users each one has.
+//
+//	Blocks of free frames are found through their first frame:
+//	"freeOrder" says whether a frame starts a free block, and the
+//	free list of each order is a doubly linked list threaded through
+//	"nextFree" and "prevFree", so that a block can be taken off its
+//	list when its buddy is freed, without searching for it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "frames.h"
+
+//----------------------------------------------------------------------
+// FrameAllocator::OrderOf
+// 	Return the order of the largest block of frames that fits in
+//	"numFrames" frames: the log, base 2, rounded down.
+//----------------------------------------------------------------------
+
+int
+FrameAllocator::OrderOf(int numFrames)
+{
+    int order = 0;
+
+    while ((2 << order) <= numFrames) {
+	order++;
+    }
+    return order;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::FrameAllocator
+// 	Initialize the frame allocator; all frames start out free, and
+//	none of them zeroed.
+//
+//	"numFrames" -- how many page frames there are
+//	"poolFrames" -- how many free frames to keep zeroed; 0 for none
+//----------------------------------------------------------------------
+
+FrameAllocator::FrameAllocator(int numFrames, int poolFrames)
+{
+    this->numFrames = numFrames;
+    this->poolFrames = poolFrames;
+    numOrders = OrderOf(numFrames) + 1;
+    refCount = new int[numFrames];
+    freeOrder = new int[numFrames];
+    nextFree = new int[numFrames];
+    prevFree = new int[numFrames];
+    freeList = new int[numOrders];
+    pool = new int[poolFrames + 1];
+    poolSize = 0;
+    numFree = 0;
+    for (int order = 0; order < numOrders; order++) {
+	freeList[order] = -1;
+    }
+    for (int i = 0; i < numFrames; i++) {
+	refCount[i] = 0;
+	freeOrder[i] = -1;
+    }
+    for (int i = 0; i < numFrames; i++) {
+	FreeFrame(i);			// merging them into big blocks
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::~FrameAllocator
+// 	De-allocate the frame allocator.
+//----------------------------------------------------------------------
+
+FrameAllocator::~FrameAllocator()
+{
+    delete [] refCount;
+    delete [] freeOrder;
+    delete [] nextFree;
+    delete [] prevFree;
+    delete [] freeList;
+    delete [] pool;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::AddBlock
+// 	Put a free block at the front of the free list for its order.
+//
+//	"frame" -- the block's first frame
+//	"order" -- the block holds 2^order frames
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::AddBlock(int frame, int order)
+{
+    freeOrder[frame] = order;
+    prevFree[frame] = -1;
+    nextFree[frame] = freeList[order];
+    if (freeList[order] != -1) {
+	prevFree[freeList[order]] = frame;
+    }
+    freeList[order] = frame;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::RemoveBlock
+// 	Take a free block off the free list for its order.
+//
+//	"frame" -- the block's first frame
+//	"order" -- the block holds 2^order frames
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::RemoveBlock(int frame, int order)
+{
+    ASSERT(freeOrder[frame] == order);
+    if (prevFree[frame] != -1) {
+	nextFree[prevFree[frame]] = nextFree[frame];
+    } else {
+	freeList[order] = nextFree[frame];
+    }
+    if (nextFree[frame] != -1) {
+	prevFree[nextFree[frame]] = prevFree[frame];
+    }
+    freeOrder[frame] = -1;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::TakeBlock
+// 	Find a free block of 2^order frames, and take it out of the
+//	buddy system.  If there is none that size, split the smallest
+//	bigger one, keeping the first half and freeing the rest.
+//	Return the block's first frame, or -1 if there is no block
+//	big enough.
+//----------------------------------------------------------------------
+
+int
+FrameAllocator::TakeBlock(int order)
+{
+    int bigger = order, frame;
+
+    while ((bigger < numOrders) && (freeList[bigger] == -1)) {
+	bigger++;
+    }
+    if (bigger == numOrders) {
+	return -1;
+    }
+    frame = freeList[bigger];
+    RemoveBlock(frame, bigger);
+    while (bigger > order) {		// split off the second halves
+	bigger--;
+	AddBlock(frame + (1 << bigger), bigger);
+    }
+    numFree -= 1 << order;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::FreeFrame
+// 	Return a frame to the buddy system.  As long as the block it
+//	ends up in has a free buddy -- the other half of the block
+//	twice its size -- merge the two.
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::FreeFrame(int frame)
+{
+    int order = 0, buddy;
+
+    while (order < numOrders - 1) {
+	buddy = frame ^ (1 << order);
+	if ((buddy >= numFrames) || (freeOrder[buddy] != order)) {
+	    break;
+	}
+	RemoveBlock(buddy, order);
+	frame = min(frame, buddy);
+	order++;
+    }
+    AddBlock(frame, order);
+    numFree++;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Allocated
+// 	Give "count" frames in a row, starting with "frame", their first
+//	user, and count them as in use.
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::Allocated(int frame, int count)
+{
+    for (int i = frame; i < frame + count; i++) {
+	ASSERT(refCount[i] == 0);
+	refCount[i] = 1;
+    }
+    kernel->stats->numFramesInUse += count;
+    kernel->stats->maxFramesInUse = max(kernel->stats->maxFramesInUse,
+					kernel->stats->numFramesInUse);
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Allocate
+// 	Find a free frame, and give it its first user.  Return -1 if
+//	every frame is in use.
+//
+//	A frame that must start out zero comes from the zeroed pool if
+//	there is one there; if not, it is zeroed now.  Other frames come
+//	from the pool only when there is nothing else.
+//
+//	"zeroed" -- must the frame be all zeroes?
+//----------------------------------------------------------------------
+
+int
+FrameAllocator::Allocate(bool zeroed)
+{
+    int frame = -1;
+
+    if (zeroed && (poolSize > 0)) {
+	frame = pool[--poolSize];
+	kernel->stats->numZeroPoolHits++;
+    } else {
+	frame = TakeBlock(0);
+	if (frame == -1 && poolSize > 0) {
+	    frame = pool[--poolSize];
+	} else if (frame != -1 && zeroed) {
+	    bzero(&kernel->machine->mainMemory[frame * PageSize], PageSize);
+	    kernel->stats->numZeroPoolMisses++;
+	}
+    }
+    if (frame != -1) {
+	Allocated(frame, 1);
+    }
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::AllocateBlock
+// 	Find 2^order free frames in a row, and give each of them its
+//	first user; each is freed on its own.  Return the first, or -1
+//	if there is no free block that big (even after giving back the
+//	zeroed frames, which may have been splitting one).
+//
+//	"order" -- how many frames are wanted, as a power of 2
+//----------------------------------------------------------------------
+
+int
+FrameAllocator::AllocateBlock(int order)
+{
+    int frame;
+
+    if (order >= numOrders) {
+	return -1;
+    }
+    frame = TakeBlock(order);
+    if (frame == -1 && poolSize > 0) {
+	DrainPool();
+	frame = TakeBlock(order);
+    }
+    if (frame != -1) {
+	Allocated(frame, 1 << order);
+    }
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Share
+// 	Note that one more address space (or the text cache) is using a
+//	frame that is already in use.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::Share(int frame)
+{
+    ASSERT(refCount[frame] > 0);
+    refCount[frame]++;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Free
+// 	Note that one of a frame's users has stopped using it.  If it
+//	was the last, the frame is free again.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::Free(int frame)
+{
+    ASSERT(refCount[frame] > 0);
+    if (--refCount[frame] == 0) {
+	kernel->stats->numFramesInUse--;
+	FreeFrame(frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::ZeroIdleFrames
+// 	Zero free frames until the pool has as many as it should, or
+//	there are no more free frames.  Called when the machine is idle,
+//	so the time it takes costs nothing.
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::ZeroIdleFrames()
+{
+    int frame;
+
+    while (poolSize < poolFrames) {
+	frame = TakeBlock(0);
+	if (frame == -1) {
+	    return;
+	}
+	bzero(&kernel->machine->mainMemory[frame * PageSize], PageSize);
+	pool[poolSize++] = frame;
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::DrainPool
+// 	Give all the zeroed frames back to the buddy system, so that
+//	they can be merged into bigger blocks.  The idle loop will zero
+//	some more later.
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::DrainPool()
+{
+    while (poolSize > 0) {
+	FreeFrame(pool[--poolSize]);
+    }
+}
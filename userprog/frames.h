@@ -0,0 +1,88 @@
+// frames.h
+//	Data structures to allocate physical page frames to user programs.
+//
+//	A frame can be mapped into more than one address space at once:
+//	the code of a program running more than once (see textcache.h),
+//	and the pages a forked address space shares with its parent
+//	until one of them writes to them (see AddrSpace::Fork).  So each
+//	frame has a reference count, and is free once nobody is using it.
+//
+//	Free frames are kept as a buddy system: blocks of 2^order frames,
+//	starting at a multiple of their size, on one free list per order.
+//	A block is split in half to satisfy a smaller request, and freed
+//	halves are merged again with their buddy.  So finding a frame
+//	takes constant time, and a program can be given frames next to
+//	each other, which it can read in with one disk request.
+//
+//	Apart from those, a pool of free frames is kept already zeroed,
+//	filled while the machine is idle (see Thread::Sleep), so that
+//	pages that start out zero -- uninitialized data and the stack --
+//	don't have to be zeroed when they are given out.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include "copyright.h"
+
+const int DefaultZeroPoolFrames = 16;	// zeroed frames to keep ready
+
+// The following class defines the frame allocator.  Its routines
+// don't wait for anything, so no lock is needed.
+
+class FrameAllocator {
+  public:
+    FrameAllocator(int numFrames, int poolFrames);
+					// All frames start out free; up to
+					// "poolFrames" are kept zeroed
+    ~FrameAllocator();
+
+    int Allocate(bool zeroed = FALSE);	// Return a free frame, used once,
+					// or -1 if there is none; if
+					// "zeroed", it is all zeroes
+    int AllocateBlock(int order);	// Return the first of 2^order free
+					// frames in a row, or -1
+    void Share(int frame);		// Someone else is using the frame
+    void Free(int frame);		// Someone has stopped using it;
+					// if it was the last, it is free
+
+    void ZeroIdleFrames();		// Fill the zeroed pool, while
+					// there's nothing else to do
+
+    int RefCount(int frame) { return refCount[frame]; }
+    int NumFree() { return numFree + poolSize; }
+    static int OrderOf(int numFrames);	// The largest block order that
+					// fits in "numFrames"
+
+  private:
+    void AddBlock(int frame, int order);	// Put a block on its list
+    void RemoveBlock(int frame, int order);	// Take it off again
+    int TakeBlock(int order);		// Find a block, splitting a bigger
+					// one if need be; -1 if none
+    void FreeFrame(int frame);		// Return a frame to the buddy
+					// system, merging it with its buddies
+    void Allocated(int frame, int count);	// Count frames as in use
+    void DrainPool();			// Give the zeroed frames back to
+					// the buddy system
+
+    int numFrames;			// how many frames there are
+    int numOrders;			// orders 0 .. numOrders-1
+    int *refCount;			// how many users each frame has
+    int *freeOrder;			// if a frame starts a free block,
+					// the block's order, else -1
+    int *nextFree, *prevFree;		// the free lists, threaded
+					// through the first frame of
+					// each block
+    int *freeList;			// the first free block of each
+					// order, or -1
+    int numFree;			// frames in the buddy system
+
+    int *pool;				// the zeroed frames
+    int poolSize;			// how many there are
+    int poolFrames;			// how many we want
+};
+
+#endif // FRAMES_H
@@ -0,0 +1,130 @@
+// swap.cc
+//	Routines to manage the backing store for virtual memory.
+//
+//	Each slot holds one page.  Since a page is a whole number of disk
+//	sectors, a page read or write is just that many sector reads or
+//	writes, one after the other.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "swap.h"
+#include "synchdisk.h"
+
+#ifdef FILESYS_STUB
+#define SectorsPerPage	(PageSize / SectorSize)
+#endif
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Initialize the backing store.  All slots start out free.
+//
+//	With the real file system, create the "SWAP" file big enough
+//	to hold every slot; any old one is thrown away first.
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace()
+{
+    ASSERT(PageSize % SectorSize == 0);
+    freeMap = new Bitmap(NumSwapPages);
+#ifndef FILESYS_STUB
+    kernel->fileSystem->Remove("SWAP");
+    if (!kernel->fileSystem->Create("SWAP", NumSwapPages * PageSize)) {
+	cerr << "Unable to create swap file\n";
+	ASSERT(FALSE);
+    }
+    file = kernel->fileSystem->Open("SWAP");
+    ASSERT(file != NULL);
+#endif
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	De-allocate the backing store.  We're called as Nachos halts,
+//	when it's too late to use the disk, so the "SWAP" file is left
+//	behind; the next SwapSpace will replace it.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    delete freeMap;
+#ifndef FILESYS_STUB
+    delete file;
+#endif
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate
+// 	Return the number of a free slot, after marking it in use.
+//	We don't have anywhere to put a page if the backing store is
+//	full, so that's fatal.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate()
+{
+    int slot = freeMap->FindAndSet();
+
+    if (slot == -1) {
+	cerr << "Out of swap space\n";
+	ASSERT(FALSE);
+    }
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Free
+// 	Return a slot to the pool of free slots.
+//
+//	"slot" -- a slot returned by Allocate
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Free(int slot)
+{
+    ASSERT(freeMap->Test(slot));
+    freeMap->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage
+// 	Read the contents of a slot into a page of memory.
+//
+//	"slot" -- the slot to read
+//	"into" -- where to put the page (usually, a frame of mainMemory)
+//----------------------------------------------------------------------
+
+void
+SwapSpace::ReadPage(int slot, char *into)
+{
+    ASSERT((slot >= 0) && (slot < NumSwapPages));
+#ifdef FILESYS_STUB
+    kernel->synchDisk->ReadSectors(slot * SectorsPerPage, SectorsPerPage,
+					into);
+#else
+    file->ReadAt(into, PageSize, slot * PageSize);
+#endif
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::WritePage
+// 	Write a page of memory out to a slot.
+//
+//	"slot" -- the slot to write
+//	"from" -- the page to be written
+//----------------------------------------------------------------------
+
+void
+SwapSpace::WritePage(int slot, char *from)
+{
+    ASSERT((slot >= 0) && (slot < NumSwapPages));
+#ifdef FILESYS_STUB
+    kernel->synchDisk->WriteSectors(slot * SectorsPerPage, SectorsPerPage,
+					from);
+#else
+    file->WriteAt(from, PageSize, slot * PageSize);
+#endif
+}
@@ -0,0 +1,63 @@
+// swap.h
+//	Data structures to manage the backing store for virtual memory:
+//	the place on the simulated disk where pages go when they are
+//	evicted from physical memory.
+//
+//	The backing store is divided into page-sized "slots".  An address
+//	space gets a slot for a page the first time the page is evicted
+//	dirty, and keeps it until the address space is deleted.
+//
+//	With the stub file system, the disk isn't otherwise in use, so
+//	we use it directly, one slot per PageSize bytes of sectors.  With
+//	the real file system, the backing store is a Nachos file, "SWAP".
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "disk.h"
+#include "machine.h"
+#include "openfile.h"
+#ifndef FILESYS_STUB
+#include "filehdr.h"
+#endif
+
+#ifdef FILESYS_STUB
+#define NumSwapPages	(NumSectors * SectorSize / PageSize)
+					// the whole disk
+#else
+#define NumSwapPages	(NumSectors * SectorSize / PageSize / 4)
+					// a quarter of the disk
+#endif
+
+// The following class defines the backing store.  All of the
+// routines wait until the disk operation has finished.
+
+class SwapSpace {
+  public:
+    SwapSpace();			// Create the backing store
+    ~SwapSpace();			// De-allocate it
+
+    int Allocate();			// Find a free slot, and mark it in
+					// use.  The swap space must not
+					// be full.
+    void Free(int slot);		// Return a slot to the free pool
+
+    void ReadPage(int slot, char *into);
+					// Read a page in from a slot
+    void WritePage(int slot, char *from);
+					// Write a page out to a slot
+
+  private:
+    Bitmap *freeMap;			// which slots are in use?
+#ifndef FILESYS_STUB
+    OpenFile *file;			// the "SWAP" file
+#endif
+};
+
+#endif // SWAP_H
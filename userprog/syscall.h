@@ -34,6 +34,8 @@
 #define SC_ExecV	13
 #define SC_ThreadExit   14
 #define SC_ThreadJoin   15
+#define SC_SetTickets   16
+#define SC_Fork         17
 
 #define SC_Add		42
 
@@ -85,6 +87,12 @@ SpaceId ExecV(int argc, char* argv[]);
  * Return the exit status.
  */
 int Join(SpaceId id); 	
+
+/* Start a copy of this user program, with a copy of its memory, 
+ * carrying on from the same place.  Return the copy's identifier, or
+ * 0 in the copy itself, or -1 if it can't be made.
+ */
+SpaceId Fork();
  
 
 /* File system operations: Create, Remove, Open, Read, Write, Close
@@ -174,6 +182,14 @@ int ThreadJoin(ThreadId id);
  */
 void ThreadExit(int ExitCode);	
 
+/*
+ * Give the current thread "tickets" shares of the CPU, for stride and
+ * lottery scheduling (see "-sc" in main.cc); a thread starts out with
+ * 100.  "tickets" must be from 1 to 10000.  Returns the thread's old
+ * number of tickets, or -1 if "tickets" isn't valid.
+ */
+int SetTickets(int tickets);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
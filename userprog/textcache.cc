@@ -0,0 +1,158 @@
+// textcache.cc
+//	Routines to share the code of a program between the address
+//	spaces running it.
+//
+//	The first address space to load a program reads its code into
+//	frames of its own, as usual, then hands them over to the text
+//	cache (Insert); later ones just map them (Find).  The cache is 
+//	one of the users of each frame (see frames.h), until the last 
+//	address space running the program is deleted.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "frames.h"
+#include "textcache.h"
+
+//----------------------------------------------------------------------
+// TextCache::TextCache
+// 	Initialize an empty text cache.
+//----------------------------------------------------------------------
+
+TextCache::TextCache()
+{
+    texts = new List<SharedText *>;
+    numShared = 0;
+}
+
+//----------------------------------------------------------------------
+// TextCache::~TextCache
+// 	De-allocate the text cache.  Address spaces still running when
+//	Nachos halts are never deleted, so their code may still be here.
+//	Must be done before the file system is.
+//----------------------------------------------------------------------
+
+TextCache::~TextCache()
+{
+    while (!texts->IsEmpty()) {
+	SharedText *text = texts->RemoveFront();
+
+	delete text->executable;
+	delete [] text->frames;
+	delete text;
+    }
+    delete texts;
+}
+
+//----------------------------------------------------------------------
+// TextCache::IsShared
+// 	Return TRUE if a virtual page holds nothing but code, so that
+//	it can be shared.
+//
+//	"code" -- where the program's code is, in its address space
+//	"vpn" -- the virtual page
+//----------------------------------------------------------------------
+
+bool
+TextCache::IsShared(Segment *code, int vpn)
+{
+    return (vpn * PageSize >= code->virtualAddr) &&
+	((vpn + 1) * PageSize <= code->virtualAddr + code->size);
+}
+
+//----------------------------------------------------------------------
+// TextCache::Find
+// 	Look for the code of a program in memory.  If it is there, the
+//	caller becomes one more user of it, and must Release it when
+//	done.
+//
+//	"executable" -- the program's file
+//	"code" -- where its code is, in the file and in memory
+//----------------------------------------------------------------------
+
+SharedText *
+TextCache::Find(OpenFile *executable, Segment *code)
+{
+    int fileId = executable->FileId();
+    ListIterator<SharedText *> iter(texts);
+
+    for (; !iter.IsDone(); iter.Next()) {
+	SharedText *text = iter.Item();
+
+	if ((text->fileId == fileId) && (text->codeSize == code->size)) {
+	    text->refCount++;
+	    return text;
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Insert
+// 	Share the code an address space has just loaded, so that other
+//	address spaces running the same program can use it.  The caller
+//	is its first user.  The file becomes the cache's, and is closed
+//	by Release.
+//
+//	"executable" -- the program's file
+//	"code" -- where its code is, in the file and in memory
+//	"pageTable" -- the caller's page table, giving the frames the
+//		code has been read into
+//----------------------------------------------------------------------
+
+SharedText *
+TextCache::Insert(OpenFile *executable, Segment *code,
+			TranslationEntry *pageTable)
+{
+    int firstPage = divRoundUp(code->virtualAddr, PageSize);
+    int endPage = (code->virtualAddr + code->size) / PageSize;
+    SharedText *text;
+
+    if (endPage <= firstPage) {
+	return NULL;			// too little code to share
+    }
+    text = new SharedText;
+    text->executable = executable;
+    text->fileId = executable->FileId();
+    text->codeSize = code->size;
+    text->firstPage = firstPage;
+    text->numPages = endPage - firstPage;
+    text->frames = new int[text->numPages];
+    for (int i = 0; i < text->numPages; i++) {
+	text->frames[i] = pageTable[firstPage + i].physicalPage;
+	kernel->frameAllocator->Share(text->frames[i]);
+    }
+    text->refCount = 1;
+    texts->Append(text);
+    numShared += text->numPages;
+    return text;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Release
+// 	Note that an address space is no longer using some shared code.
+//	If no other address space is, let go of its frames, and close
+//	the program's file.
+//
+//	"text" -- the code, as returned by Find or Insert
+//----------------------------------------------------------------------
+
+void
+TextCache::Release(SharedText *text)
+{
+    ASSERT(text->refCount > 0);
+    if (--text->refCount > 0) {
+	return;
+    }
+    texts->Remove(text);
+    numShared -= text->numPages;
+    for (int i = 0; i < text->numPages; i++) {
+	kernel->frameAllocator->Free(text->frames[i]);
+    }
+    delete text->executable;		// may wait for the file system
+    delete [] text->frames;
+    delete text;
+}
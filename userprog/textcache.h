@@ -0,0 +1,84 @@
+// textcache.h
+//	Data structures to share the code of a program between the
+//	address spaces running it.
+//
+//	Code doesn't change, so every copy of a program running at once
+//	can use the same page frames for it, mapped read-only.  The text
+//	cache remembers which frames hold the code of each program that
+//	is running, so that loading the program again just maps them,
+//	rather than taking new frames and reading the code in again.
+//
+//	Only pages that hold nothing but code are shared; a page that
+//	also holds the start of the data is loaded into each address
+//	space, as before.  Programs that are demand paged ("-vm") don't
+//	share their code, since the core map gives each frame to just
+//	one address space.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "copyright.h"
+#include "list.h"
+#include "noff.h"
+#include "openfile.h"
+#include "translate.h"
+
+// The following class defines the code of one program, as loaded
+// into memory.  A program is known by its file (see OpenFile::FileId)
+// and the size of its code; the file is kept open while the code is
+// in memory, so that it can't be removed and something else put in
+// its place.
+
+class SharedText {
+  public:
+    OpenFile *executable;	// the program's file
+    int fileId;			// which file it is
+    int codeSize;		// how much code it has
+    int firstPage;		// the first virtual page shared
+    int numPages;		// how many pages are shared
+    int *frames;		// the frame holding each of them
+    int refCount;		// address spaces using them
+};
+
+// The following class defines the text cache.  Its routines don't
+// wait for anything, so no lock is needed.
+
+class TextCache {
+  public:
+    TextCache();		// An empty text cache
+    ~TextCache();
+
+    SharedText *Find(OpenFile *executable, Segment *code);
+				// The code of the program in "executable",
+				// if it is in memory, counting the caller
+				// as one more user of it; else NULL
+    SharedText *Insert(OpenFile *executable, Segment *code,
+			TranslationEntry *pageTable);
+				// Share the code an address space has just
+				// loaded, from the frames in its page
+				// table; the file becomes ours.  Return
+				// NULL if no page is all code.
+    void Share(SharedText *text) { text->refCount++; }
+				// One more address space is using the code
+    void Release(SharedText *text);
+				// An address space has stopped using the
+				// code; if it was the last, let go of its
+				// frames
+
+    int NumShared() { return numShared; }
+				// Frames in the cache, for benchmarks
+
+    static bool IsShared(Segment *code, int vpn);
+				// Is a page all code, so that it can be
+				// shared?
+
+  private:
+    List<SharedText *> *texts;	// the programs with code in memory
+    int numShared;		// frames they take up
+};
+
+#endif // TEXTCACHE_H
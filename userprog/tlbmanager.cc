@@ -0,0 +1,281 @@
+// tlbmanager.cc
+//	Routines to fill the machine's TLB from the page tables, and to
+//	choose which entry to replace.
+//
+//	Since the machine caches translations (see Machine::FlushFastTlb),
+//	we flush that cache whenever we drop an entry of the address
+//	space that is running, or clear the bits the machine sets.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "tlbmanager.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// ParseTlbReplacementPolicy
+// 	Look up a TLB replacement policy by name, for the "-tr" flag.
+//
+//	"name" -- "random", "fifo" or "nru"
+//	"policy" -- where to store the policy, if the name is known
+//----------------------------------------------------------------------
+
+bool
+ParseTlbReplacementPolicy(char *name, TlbReplacementPolicy *policy)
+{
+    if (strcmp(name, "random") == 0) {
+	*policy = RandomTlbReplacement;
+    } else if (strcmp(name, "fifo") == 0) {
+	*policy = FifoTlbReplacement;
+    } else if (strcmp(name, "nru") == 0) {
+	*policy = NruTlbReplacement;
+    } else {
+	return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::TlbManager
+// 	Initialize the kernel's view of the TLB, which starts out empty.
+//
+//	"policy" -- how to choose an entry to replace
+//	"flushOnSwitch" -- if TRUE, empty the TLB whenever another
+//		address space runs, as if its entries weren't tagged
+//----------------------------------------------------------------------
+
+TlbManager::TlbManager(TlbReplacementPolicy policy, bool flushOnSwitch)
+{
+    ASSERT(kernel->machine->tlb != NULL);
+    this->policy = policy;
+    this->flushOnSwitch = flushOnSwitch;
+    source = new TranslationEntry *[TLBSize];
+    for (int i = 0; i < TLBSize; i++) {
+	source[i] = NULL;
+    }
+    hand = 0;
+    seed = 1;
+    lastClear = 0;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::~TlbManager
+// 	De-allocate the kernel's view of the TLB.
+//----------------------------------------------------------------------
+
+TlbManager::~TlbManager()
+{
+    delete [] source;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::Drop
+// 	Empty a TLB entry, first copying the use and dirty bits the
+//	machine set in it to the page table entry it came from.
+//
+//	"i" -- which TLB entry
+//----------------------------------------------------------------------
+
+void
+TlbManager::Drop(int i)
+{
+    TranslationEntry *entry = &kernel->machine->tlb[i];
+
+    if (!entry->valid) {
+	return;
+    }
+    if (entry->use) {
+	source[i]->use = TRUE;
+    }
+    if (entry->dirty) {
+	source[i]->dirty = TRUE;
+    }
+    entry->valid = FALSE;
+    source[i] = NULL;
+    if (entry->asid == kernel->machine->asid) {
+	kernel->machine->FlushFastTlb();
+    }
+}
+
+//----------------------------------------------------------------------
+// TlbManager::Refill
+// 	Handle a TLB miss: copy a page table entry into the TLB, replacing
+//	the entry chosen by the replacement policy.  The instruction that
+//	missed is then re-executed.
+//
+//	"space" -- the address space running, whose page table it is
+//	"entry" -- the page table entry for the page that missed
+//----------------------------------------------------------------------
+
+void
+TlbManager::Refill(AddrSpace *space, TranslationEntry *entry)
+{
+    int i = FindVictim();
+    TranslationEntry *tlbEntry = &kernel->machine->tlb[i];
+
+    Drop(i);
+    DEBUG(dbgAddr, "Loading virtual page " << entry->virtualPage
+		<< " into TLB entry " << i);
+    *tlbEntry = *entry;
+    tlbEntry->use = TRUE;		// the miss was a use; otherwise the
+    tlbEntry->dirty = FALSE;		// bits say what has happened since
+    tlbEntry->asid = space->GetId();
+    source[i] = entry;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::Switch
+// 	Get the TLB ready for an address space to run: tell the machine
+//	which entries are its.  If we are pretending they aren't tagged,
+//	empty the TLB instead, unless the same address space is running
+//	again.
+//
+//	"space" -- the address space about to run
+//----------------------------------------------------------------------
+
+void
+TlbManager::Switch(AddrSpace *space)
+{
+    Machine *machine = kernel->machine;
+
+    if (flushOnSwitch && (machine->asid != space->GetId())) {
+	for (int i = 0; i < TLBSize; i++) {
+	    Drop(i);
+	}
+	kernel->stats->numTlbFlushes++;
+    }
+    machine->asid = space->GetId();
+    machine->FlushFastTlb();		// its entries aren't tagged
+}
+
+//----------------------------------------------------------------------
+// TlbManager::Invalidate
+// 	Drop the copy of a page table entry from the TLB, if it is there,
+//	since the kernel is about to change the entry.  The next use of
+//	the page will load it again.
+//
+//	"entry" -- the page table entry
+//----------------------------------------------------------------------
+
+void
+TlbManager::Invalidate(TranslationEntry *entry)
+{
+    for (int i = 0; i < TLBSize; i++) {
+	if (kernel->machine->tlb[i].valid && (source[i] == entry)) {
+	    Drop(i);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// TlbManager::InvalidateSpace
+// 	Drop every TLB entry of an address space, whose page table is
+//	about to change all at once, or be deleted.
+//
+//	"space" -- the address space
+//----------------------------------------------------------------------
+
+void
+TlbManager::InvalidateSpace(AddrSpace *space)
+{
+    for (int i = 0; i < TLBSize; i++) {
+	if (kernel->machine->tlb[i].valid &&
+		(kernel->machine->tlb[i].asid == space->GetId())) {
+	    Drop(i);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// TlbManager::SaveBits
+// 	Copy the use and dirty bits the machine has set in the TLB to
+//	the page tables the entries came from, and clear them in the TLB,
+//	so that the page replacement policies (see coremap.h) can see
+//	which pages have been used.
+//----------------------------------------------------------------------
+
+void
+TlbManager::SaveBits()
+{
+    TranslationEntry *tlb = kernel->machine->tlb;
+
+    for (int i = 0; i < TLBSize; i++) {
+	if (tlb[i].valid) {
+	    if (tlb[i].use) {
+		source[i]->use = TRUE;
+		tlb[i].use = FALSE;
+	    }
+	    if (tlb[i].dirty) {
+		source[i]->dirty = TRUE;
+		tlb[i].dirty = FALSE;
+	    }
+	}
+    }
+    kernel->machine->FlushFastTlb();	// so the machine sets them again
+}
+
+//----------------------------------------------------------------------
+// TlbManager::FindVictim
+// 	Choose a TLB entry to replace: an empty one, if there is one,
+//	otherwise the one "policy" picks.
+//----------------------------------------------------------------------
+
+int
+TlbManager::FindVictim()
+{
+    int i;
+
+    for (i = 0; i < TLBSize; i++) {
+	if (!kernel->machine->tlb[i].valid) {
+	    return i;
+	}
+    }
+    switch (policy) {
+      case RandomTlbReplacement:
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % TLBSize;
+      case FifoTlbReplacement:
+	i = hand;
+	hand = (hand + 1) % TLBSize;
+	return i;
+      case NruTlbReplacement:
+	return FindNru();
+      default:
+	ASSERTNOTREACHED();
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::FindNru
+// 	Choose the first TLB entry, after the last one chosen, that
+//	hasn't been used since the use bits were cleared; if they all
+//	have, just the next one.  (Unlike NRU for pages, we don't prefer
+//	clean entries, since dropping a dirty one costs no more.)
+//
+//	Every NruClearTicks, clear the use bits, so that they say what
+//	has been used lately.
+//----------------------------------------------------------------------
+
+int
+TlbManager::FindNru()
+{
+    TranslationEntry *tlb = kernel->machine->tlb;
+    int victim = hand;
+
+    for (int j = 0; j < TLBSize; j++) {
+	if (!tlb[(hand + j) % TLBSize].use) {
+	    victim = (hand + j) % TLBSize;
+	    break;
+	}
+    }
+    hand = (victim + 1) % TLBSize;
+    if (kernel->stats->totalTicks - lastClear >= NruClearTicks) {
+	SaveBits();
+	lastClear = kernel->stats->totalTicks;
+    }
+    return victim;
+}
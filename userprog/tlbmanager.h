@@ -0,0 +1,97 @@
+// tlbmanager.h
+//	Data structures to manage the machine's TLB, when it has one
+//	(see USE_TLB in build/Makefile).
+//
+//	With a TLB, the machine doesn't look at page tables at all.  A
+//	translation that isn't in the TLB raises a PageFaultException,
+//	and the kernel copies the page's entry from the address space's
+//	page table into the TLB (see AddrSpace::TlbFault), replacing
+//	another entry using one of several policies.
+//
+//	Each TLB entry is tagged with the SpaceId of its address space,
+//	and the machine only matches the entries of the address space
+//	that is running (see Machine::asid).  So switching address spaces
+//	doesn't have to empty the TLB -- unless asked to ("-tf"), to see
+//	what the tags are worth.
+//
+//	The machine sets the use and dirty bits in the TLB, not in the
+//	page table.  So we remember which page table entry each TLB entry
+//	was copied from, and copy the bits back whenever the kernel is
+//	about to look at them (SaveBits), or the entry is replaced.  And
+//	whenever the kernel changes a page table entry, it must first
+//	Invalidate the copy in the TLB, if there is one.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBMANAGER_H
+#define TLBMANAGER_H
+
+#include "copyright.h"
+#include "translate.h"
+
+class AddrSpace;
+
+// The TLB replacement policies.  All of them fill an empty entry
+// first, if there is one.
+//	RandomTlbReplacement -- replace any entry, at random, as the
+//		MIPS R2000/R3000 hardware does
+//	FifoTlbReplacement -- replace the entries in turn
+//	NruTlbReplacement -- not recently used: replace an entry that
+//		hasn't been used since the use bits were last cleared
+//		(every NruClearTicks), if there is one
+
+enum TlbReplacementPolicy { RandomTlbReplacement, FifoTlbReplacement,
+			    NruTlbReplacement };
+
+const int NruClearTicks = 1000;		// ticks, for NruTlbReplacement
+
+extern bool ParseTlbReplacementPolicy(char *name,
+				TlbReplacementPolicy *policy);
+					// Convert "random", "fifo" or "nru"
+					// to a policy; return FALSE if the
+					// name is unknown
+
+// The following class defines the kernel's view of the TLB.  Its
+// routines don't wait for anything, so no lock is needed.
+
+class TlbManager {
+  public:
+    TlbManager(TlbReplacementPolicy policy, bool flushOnSwitch);
+				// The TLB starts out empty; if
+				// "flushOnSwitch", it is emptied again
+				// whenever another address space runs
+    ~TlbManager();
+
+    void Refill(AddrSpace *space, TranslationEntry *entry);
+				// Copy "entry", from the page table of
+				// "space", into the TLB
+    void Switch(AddrSpace *space);
+				// "space" is about to run
+    void Invalidate(TranslationEntry *entry);
+				// The kernel is about to change "entry";
+				// drop its copy from the TLB
+    void InvalidateSpace(AddrSpace *space);
+				// Drop every entry of "space", whose page
+				// table is changing or going away
+    void SaveBits();		// Copy the use and dirty bits the machine
+				// has set in the TLB to the page tables
+
+  private:
+    TlbReplacementPolicy policy;	// how to pick the entry to replace
+    bool flushOnSwitch;		// empty the TLB on every switch?
+    TranslationEntry **source;	// the page table entry each TLB entry
+				// was copied from
+    int hand;			// next entry to look at, for FIFO and NRU
+    unsigned int seed;		// for RandomTlbReplacement; not Random(),
+				// so as not to change "-rs" time slices
+    int lastClear;		// when the use bits were last cleared,
+				// for NruTlbReplacement
+
+    int FindVictim();		// pick an entry using "policy"
+    int FindNru();
+    void Drop(int i);		// Save an entry's bits, and empty it
+};
+
+#endif // TLBMANAGER_H